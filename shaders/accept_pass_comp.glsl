@@ -0,0 +1,50 @@
+#version 450
+
+// decides whether to keep the candidate from displacement_pass_comp.glsl the
+// same way GridWarper::optimize_warp() does, and writes the cost after the
+// decision to history[iter_index]. used by
+// GridWarper::optimize_warp_resident().
+//
+// workgroups: (1, 1, 1)
+
+layout(local_size_x = 1, local_size_y = 1, local_size_z = 1) in;
+
+// push constants
+layout(push_constant, std430) uniform pc {
+    layout(offset = 0) uint iter_index;
+};
+
+// uniforms
+
+// (average, maximum) written by cost_info_pass_comp.glsl
+layout(binding = 0, std430) readonly buffer cost_info_buf {
+    vec2 cost_info;
+};
+
+// same layout as ResidentState in grid_warp.hpp
+layout(binding = 1, std430) buffer state_buf {
+    float last_avg_diff;
+    float max_local_diff_limit;
+    uint accepted;
+    uint n_accepted;
+};
+
+layout(binding = 2, std430) writeonly buffer history_buf {
+    float history[];
+};
+
+void main()
+{
+    if (cost_info.x > last_avg_diff || cost_info.y > max_local_diff_limit)
+    {
+        accepted = 0;
+    }
+    else
+    {
+        last_avg_diff = cost_info.x;
+        accepted = 1;
+        n_accepted++;
+    }
+
+    history[iter_index] = last_avg_diff;
+}
@@ -0,0 +1,69 @@
+#version 450
+
+// finds the average and maximum values in the cost image and writes them to
+// cost_infos[result_index], which has the same layout as the CostInfo struct
+// in grid_warp.hpp. this way only 8 bytes are read back to the CPU regardless
+// of the cost resolution.
+//
+// workgroups: (1, 1, 1)
+
+layout(local_size_x = 256, local_size_y = 1, local_size_z = 1) in;
+
+// push constants
+layout(push_constant, std430) uniform pc {
+    layout(offset = 0) uint result_index;
+};
+
+// uniforms
+layout(binding = 0, r32f) uniform readonly image2D cost_img;
+
+// (average, maximum) pairs
+layout(binding = 1, std430) writeonly buffer cost_info_buf {
+    vec2 cost_infos[];
+};
+
+// sums and maximums from every invocation
+shared vec2 local_results[256];
+
+void main()
+{
+    ivec2 cost_res = imageSize(cost_img);
+    uint n_pixels = uint(cost_res.x * cost_res.y);
+
+    // go through this invocation's share of the pixels
+    vec2 result = vec2(0.);
+    for (uint i = gl_LocalInvocationIndex; i < n_pixels; i += 256)
+    {
+        ivec2 coord = ivec2(i % uint(cost_res.x), i / uint(cost_res.x));
+        float v = imageLoad(cost_img, coord).r;
+
+        result.x += v;
+        result.y = max(result.y, v);
+    }
+
+    // combine the results from all invocations
+    local_results[gl_LocalInvocationIndex] = result;
+    barrier();
+    for (uint stride = 128; stride > 0; stride >>= 1)
+    {
+        if (gl_LocalInvocationIndex < stride)
+        {
+            vec2 other = local_results[gl_LocalInvocationIndex + stride];
+            local_results[gl_LocalInvocationIndex].x += other.x;
+            local_results[gl_LocalInvocationIndex].y = max(
+                local_results[gl_LocalInvocationIndex].y,
+                other.y
+            );
+        }
+        barrier();
+    }
+
+    // output
+    if (gl_LocalInvocationIndex == 0)
+    {
+        cost_infos[result_index] = vec2(
+            local_results[0].x / float(n_pixels),
+            local_results[0].y
+        );
+    }
+}
@@ -0,0 +1,148 @@
+#version 450
+
+// first stage of the cost pass. every cost pixel's footprint in the
+// intermediate resolution is split into n_chunks chunks and every workgroup
+// adds up the area-weighted values in one chunk. the partial sums are then
+// added up in cost_reduction_pass_comp.glsl.
+//
+// if FUSED is defined, the difference values are calculated on the fly from
+// the warped image and the log of the target image like in
+// difference_pass_frag.glsl, otherwise they're read from the difference image.
+// if LUMINANCE is also defined, the warped image and the log of the target
+// image only have a single channel with the luminance.
+//
+// only the cost pixels in the region starting at cost_offset are updated.
+//
+// workgroups: (cost_extent.x, cost_extent.y, n_chunks)
+
+layout(local_size_x = 256, local_size_y = 1, local_size_z = 1) in;
+
+// push constants
+layout(push_constant, std430) uniform pc {
+    layout(offset = 0) uvec2 cost_res;
+    layout(offset = 8) uvec2 cost_offset;
+    layout(offset = 16) uvec2 cost_extent;
+    layout(offset = 24) uint n_chunks;
+};
+
+// uniforms
+#ifdef FUSED
+layout(binding = 0) uniform sampler2D warped_img;
+layout(binding = 1) uniform sampler2D target_log_img;
+#else
+layout(binding = 0) uniform sampler2D difference_img;
+#endif
+
+// weighted sums and sums of weights, n_chunks per cost pixel
+layout(binding = 2, std430) writeonly buffer partial_sums_buf {
+    vec2 partial_sums[];
+};
+
+// sums from every invocation in the workgroup
+shared vec2 local_sums[256];
+
+#ifdef FUSED
+// unsigned logarithmic difference between two RGB triplets, preferably in
+// Linear BT.709 I-D65. the log of the second triplet is precomputed. same as
+// in difference_pass_frag.glsl.
+float rgb_log_diff_unsigned(vec3 a, vec3 log_b)
+{
+    // clip negative values and add a small offset to avoid infinity
+    a = max(a, 0.) + .01;
+
+    // logarithmic difference per channel
+    vec3 d = log(a) - log_b;
+
+    // take to the power of 2 and average for all channels
+    return dot(d * d, vec3(1. / 3.));
+}
+
+// unsigned logarithmic difference between two luminance values. the log of
+// the second value is precomputed. same as in difference_pass_frag.glsl.
+float lum_log_diff_unsigned(float a, float log_b)
+{
+    float d = log(max(a, 0.) + .01) - log_b;
+    return d * d;
+}
+#endif
+
+void main()
+{
+    uvec2 cost_coord = cost_offset + gl_WorkGroupID.xy;
+    uint chunk = gl_WorkGroupID.z;
+
+#ifdef FUSED
+    ivec2 intermediate_res = textureSize(warped_img, 0);
+#else
+    ivec2 intermediate_res = textureSize(difference_img, 0);
+#endif
+
+    // bottom left and top right corners of the current cost pixel in the
+    // pixel space of the intermediate resolution
+    vec2 scale = vec2(intermediate_res) / vec2(cost_res);
+    vec2 bl = vec2(cost_coord) * scale;
+    vec2 tr = bl + scale;
+
+    // pixels in the AABB (axis-aligned bounding box) formed by the corner
+    // points. the pixels past the top right corner would have a weight of 0
+    // anyway.
+    ivec2 start = ivec2(floor(bl));
+    ivec2 end = min(ivec2(floor(tr)), intermediate_res - 1);
+    ivec2 size = end - start + 1;
+
+    // go through this workgroup's share of the pixels
+    vec2 sums = vec2(0.);
+    for (uint i = chunk * 256 + gl_LocalInvocationIndex;
+        i < uint(size.x * size.y);
+        i += n_chunks * 256)
+    {
+        ivec2 icoord = start + ivec2(i % uint(size.x), i / uint(size.x));
+
+        // corners of the current pixel
+        vec2 curr_bl = vec2(icoord);
+        vec2 curr_tr = curr_bl + 1.;
+
+        // sample weight = area of intersection / area of the pixel (1)
+        vec2 intr_diagonal = max(min(tr, curr_tr) - max(bl, curr_bl), 0.);
+        float intr_area = intr_diagonal.x * intr_diagonal.y;
+
+#ifdef FUSED
+#ifdef LUMINANCE
+        float diff = lum_log_diff_unsigned(
+            texelFetch(warped_img, icoord, 0).r,
+            texelFetch(target_log_img, icoord, 0).r
+        );
+#else
+        float diff = rgb_log_diff_unsigned(
+            texelFetch(warped_img, icoord, 0).rgb,
+            texelFetch(target_log_img, icoord, 0).rgb
+        );
+#endif
+#else
+        float diff = texelFetch(difference_img, icoord, 0).r;
+#endif
+
+        // accumulate
+        sums += vec2(intr_area * diff, intr_area);
+    }
+
+    // add up the sums from all invocations
+    local_sums[gl_LocalInvocationIndex] = sums;
+    barrier();
+    for (uint stride = 128; stride > 0; stride >>= 1)
+    {
+        if (gl_LocalInvocationIndex < stride)
+        {
+            local_sums[gl_LocalInvocationIndex] +=
+                local_sums[gl_LocalInvocationIndex + stride];
+        }
+        barrier();
+    }
+
+    // output
+    if (gl_LocalInvocationIndex == 0)
+    {
+        uint cost_idx = cost_coord.x + cost_coord.y * cost_res.x;
+        partial_sums[cost_idx * n_chunks + chunk] = local_sums[0];
+    }
+}
@@ -0,0 +1,43 @@
+#version 450
+
+// second stage of the cost pass, adds up the partial sums from
+// cost_pass_comp.glsl and writes the final values to the cost image.
+//
+// only the cost pixels in the region starting at cost_offset are updated.
+//
+// invocations: one per cost pixel in the region
+
+layout(local_size_x = 8, local_size_y = 8, local_size_z = 1) in;
+
+// push constants
+layout(push_constant, std430) uniform pc {
+    layout(offset = 0) uvec2 cost_res;
+    layout(offset = 8) uvec2 cost_offset;
+    layout(offset = 16) uvec2 cost_extent;
+    layout(offset = 24) uint n_chunks;
+};
+
+// uniforms
+layout(binding = 0, std430) readonly buffer partial_sums_buf {
+    vec2 partial_sums[];
+};
+layout(binding = 1, r32f) uniform writeonly image2D cost_img;
+
+void main()
+{
+    if (any(greaterThanEqual(gl_GlobalInvocationID.xy, cost_extent)))
+    {
+        return;
+    }
+    uvec2 cost_coord = cost_offset + gl_GlobalInvocationID.xy;
+
+    uint cost_idx = cost_coord.x + cost_coord.y * cost_res.x;
+    vec2 sums = vec2(0.);
+    for (uint i = 0; i < n_chunks; i++)
+    {
+        sums += partial_sums[cost_idx * n_chunks + i];
+    }
+
+    // normalize by the sum of the weights, same as the box filter
+    imageStore(cost_img, ivec2(cost_coord), vec4(sums.x / sums.y));
+}
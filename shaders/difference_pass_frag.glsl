@@ -1,32 +1,40 @@
 #version 450
 
-// push constants
-layout(push_constant, std430) uniform pc {
-    layout(offset = 0) float target_img_mul;
-};
+// if LUMINANCE is defined, warped_img and target_log_img only have a single
+// channel with the luminance, see Params::luminance in grid_warp.hpp.
 
 // uniforms
 layout(binding = 0) uniform sampler2D warped_img;
-layout(binding = 1) uniform sampler2D target_img;
+
+// log of the target image at the intermediate resolution (with the multiplier
+// applied), see resample_pass_comp.glsl
+layout(binding = 1) uniform sampler2D target_log_img;
 
 // output from fragment shader
 layout(location = 0) out vec4 out_col;
 
 // unsigned logarithmic difference between two RGB triplets, preferably in
-// Linear BT.709 I-D65.
-float rgb_log_diff_unsigned(vec3 a, vec3 b)
+// Linear BT.709 I-D65. the log of the second triplet is precomputed.
+float rgb_log_diff_unsigned(vec3 a, vec3 log_b)
 {
     // clip negative values and add a small offset to avoid infinity
     a = max(a, 0.) + .01;
-    b = max(b, 0.) + .01;
     
     // logarithmic difference per channel
-    vec3 d = log(a / b);
+    vec3 d = log(a) - log_b;
     
     // take to the power of 2 and average for all channels
     return dot(d * d, vec3(1. / 3.));
 }
 
+// unsigned logarithmic difference between two luminance values. the log of
+// the second value is precomputed.
+float lum_log_diff_unsigned(float a, float log_b)
+{
+    float d = log(max(a, 0.) + .01) - log_b;
+    return d * d;
+}
+
 // signed logarithmic difference between two RGB triplets, preferably in Linear
 // BT.709 I-D65.
 float rgb_log_diff(vec3 a, vec3 b)
@@ -67,14 +75,22 @@ void main()
     {
         vec2 texcoord = gl_FragCoord.xy / vec2(intermediate_res);
 
-        vec3 warped_col = texture(warped_img, texcoord).rgb;
-        vec3 target_col = texture(target_img, texcoord).rgb;
+        ivec2 icoord = ivec2(gl_FragCoord.xy);
 
-        // apply multiplier to the RGB channels in the target image
-        target_col *= target_img_mul;
+#ifdef LUMINANCE
+        float diff = lum_log_diff_unsigned(
+            texture(warped_img, texcoord).r,
+            texelFetch(target_log_img, icoord, 0).r
+        );
+#else
+        float diff = rgb_log_diff_unsigned(
+            texture(warped_img, texcoord).rgb,
+            texelFetch(target_log_img, icoord, 0).rgb
+        );
+#endif
 
         // remember that the difference image has a single channel so the other
         // ones don't matter.
-        out_col = vec4(rgb_log_diff_unsigned(warped_col, target_col));
+        out_col = vec4(diff);
     }
 }
@@ -0,0 +1,96 @@
+#version 450
+
+// the GPU version of GridWarper::displace_vertices(), used by
+// GridWarper::optimize_warp_resident(). applies the random gaussian
+// displacement in warps[warp_index] to the accepted vertices and writes the
+// result to the candidate vertices.
+//
+// if accept_pass_comp.glsl kept the previous candidate, it's copied to the
+// accepted vertices first. with apply_only, that's all we do.
+//
+// invocations: one per vertex
+
+layout(local_size_x = 64, local_size_y = 1, local_size_z = 1) in;
+
+// must match MIN_VERTEX_DISPLACEMENT in grid_warp.hpp
+#define MIN_VERTEX_DISPLACEMENT 1e-4
+
+// push constants
+layout(push_constant, std430) uniform pc {
+    layout(offset = 0) uvec2 padded_grid_res;
+    layout(offset = 8) vec2 intermediate_res;
+    layout(offset = 16) uint n_vertices;
+    layout(offset = 20) uint warp_index;
+    layout(offset = 24) uint apply_only;
+};
+
+// same layout as WarpParams in grid_warp.hpp
+struct WarpParams
+{
+    vec2 center;
+    vec2 direction;
+    float radius;
+    float strength;
+};
+
+// uniforms
+// warped positions of the vertices
+layout(binding = 0, std430) buffer vertex_buf {
+    vec2 warped_positions[];
+};
+layout(binding = 1, std430) buffer candidate_vertex_buf {
+    vec2 candidate_warped_positions[];
+};
+layout(binding = 2, std430) readonly buffer warp_buf {
+    WarpParams warps[];
+};
+
+// same layout as ResidentState in grid_warp.hpp
+layout(binding = 3, std430) readonly buffer state_buf {
+    float last_avg_diff;
+    float max_local_diff_limit;
+    uint accepted;
+    uint n_accepted;
+};
+
+void main()
+{
+    uint idx = gl_GlobalInvocationID.x;
+    if (idx >= n_vertices)
+    {
+        return;
+    }
+
+    if (accepted != 0)
+    {
+        warped_positions[idx] = candidate_warped_positions[idx];
+    }
+    if (apply_only != 0)
+    {
+        return;
+    }
+
+    vec2 warped_pos = warped_positions[idx];
+
+    // the last row and column aren't moved, same as on the CPU
+    uint stride_y = padded_grid_res.x + 1;
+    uvec2 grid_coord = uvec2(idx % stride_y, idx / stride_y);
+    if (all(lessThan(grid_coord, padded_grid_res)))
+    {
+        WarpParams warp = warps[warp_index];
+
+        // position in pixel space
+        vec2 pos = warped_pos * intermediate_res;
+
+        // displace (warp)
+        float a = distance(pos, warp.center) / warp.radius;
+        float displacement = warp.strength * exp(-.5 * a * a);
+        if (abs(displacement) >= MIN_VERTEX_DISPLACEMENT)
+        {
+            pos += displacement * warp.direction;
+            warped_pos = pos / intermediate_res;
+        }
+    }
+
+    candidate_warped_positions[idx] = warped_pos;
+}
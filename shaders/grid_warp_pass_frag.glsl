@@ -1,8 +1,19 @@
 #version 450
 
-// push constants
+// push constants (after the ones in grid_warp_pass_vert.glsl)
 layout(push_constant, std430) uniform pc {
-    layout(offset = 0) float base_img_mul;
+    // only used if the base image is split into tiles (see TiledImage), in
+    // which case there's one draw per tile and base_img is that tile. the
+    // fragments with texture coordinates outside [tile_min, tile_max) are
+    // left to the other tiles, and tile_uv_scale and tile_uv_offset map the
+    // texture coordinates of the whole image to the tile.
+    layout(offset = 24) vec2 tile_min;
+    layout(offset = 32) vec2 tile_max;
+    layout(offset = 40) vec2 tile_uv_scale;
+    layout(offset = 48) vec2 tile_uv_offset;
+
+    layout(offset = 56) float base_img_mul;
+    layout(offset = 60) uint tiled;
 };
 
 // uniforms
@@ -16,8 +27,23 @@ layout(location = 0) out vec4 out_col;
 
 void main()
 {
+    vec2 texcoord = v_texcoord;
+    if (tiled != 0u)
+    {
+        // mirror like the sampler does with the whole image, since the
+        // sampler only sees the tile
+        texcoord = 1. - abs(mod(texcoord, 2.) - 1.);
+
+        if (any(lessThan(texcoord, tile_min))
+            || any(greaterThanEqual(texcoord, tile_max)))
+        {
+            discard;
+        }
+        texcoord = texcoord * tile_uv_scale + tile_uv_offset;
+    }
+
     // sample the image
-    out_col = texture(base_img, v_texcoord);
+    out_col = texture(base_img, texcoord);
 
     // apply multiplier to the RGB channels in the base image
     out_col.rgb *= base_img_mul;
@@ -1,5 +1,13 @@
 #version 450
 
+// push constants
+layout(push_constant, std430) uniform pc {
+    // affine transform applied to the warped positions, only used during
+    // transform optimization. identity otherwise.
+    layout(offset = 0) mat2 transform_mat;
+    layout(offset = 16) vec2 transform_offset;
+};
+
 // input from vertex buffer
 layout(location = 0) in vec2 warped_pos;
 layout(location = 1) in vec2 orig_pos;
@@ -9,6 +17,7 @@ layout(location = 0) out vec2 v_texcoord;
 
 void main()
 {
-    gl_Position = vec4(warped_pos * 2. - 1., 0, 1);
+    vec2 pos = transform_mat * warped_pos + transform_offset;
+    gl_Position = vec4(pos * 2. - 1., 0, 1);
     v_texcoord = orig_pos;
 }
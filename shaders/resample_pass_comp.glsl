@@ -0,0 +1,130 @@
+#version 450
+
+// runs once when GridWarper is created. resamples the first mip level of
+// src_img to the resolution of dst_img (the intermediate resolution) with a
+// box filter, so the passes that run in every iteration can read from a small
+// image without aliasing.
+//
+// if LUMINANCE is defined, only the luminance is written to a single-channel
+// image. if LOG is defined, the log of the clipped and offset values is
+// written instead, see rgb_log_diff_unsigned() in difference_pass_frag.glsl.
+// this is used for the target image so the difference pass and the fused cost
+// pass only need to take the log of the warped image in every iteration.
+//
+// tiled source images (see TiledImage) are resampled with one MODE_TILE run per
+// tile, each adding its share to dst_img (which starts at zero), followed by a
+// MODE_FINALIZE run which takes the log if LOG is defined.
+//
+// invocations: one per pixel in dst_img, starting at dst_offset
+
+layout(local_size_x = 8, local_size_y = 8, local_size_z = 1) in;
+
+// push constants
+layout(push_constant, std430) uniform pc {
+    layout(offset = 0) float mul;
+    layout(offset = 4) uint mode;
+
+    // resolution of the whole source image
+    layout(offset = 8) ivec2 src_res;
+
+    // where src_img starts in the whole source image, and the pixels that
+    // are read from it (core_max is exclusive)
+    layout(offset = 16) ivec2 src_offset;
+    layout(offset = 24) ivec2 core_min;
+    layout(offset = 32) ivec2 core_max;
+
+    layout(offset = 40) ivec2 dst_offset;
+};
+
+// uniforms
+layout(binding = 0) uniform sampler2D src_img;
+#ifdef LUMINANCE
+layout(binding = 1, r32f) uniform image2D dst_img;
+#else
+layout(binding = 1, rgba32f) uniform image2D dst_img;
+#endif
+
+// values for mode
+const uint MODE_WHOLE = 0u;
+const uint MODE_TILE = 1u;
+const uint MODE_FINALIZE = 2u;
+
+// luminance weights for Linear BT.709 I-D65
+const vec3 LUMINANCE_WEIGHTS = vec3(.2126, .7152, .0722);
+
+void main()
+{
+    ivec2 dst_res = imageSize(dst_img);
+    ivec2 icoord = ivec2(gl_GlobalInvocationID.xy) + dst_offset;
+    if (any(greaterThanEqual(icoord, dst_res)))
+    {
+        return;
+    }
+
+    if (mode == MODE_FINALIZE)
+    {
+#ifdef LOG
+        vec4 sum = imageLoad(dst_img, icoord);
+        sum.rgb = log(max(sum.rgb, 0.) + .01);
+        imageStore(dst_img, icoord, sum);
+#endif
+        return;
+    }
+
+    // bottom left and top right corners of the current pixel in the pixel
+    // space of the source image
+    vec2 scale = vec2(src_res) / vec2(dst_res);
+    vec2 bl = vec2(icoord) * scale;
+    vec2 tr = bl + scale;
+
+    // source pixels in the AABB formed by the corner points, weighted by the
+    // area of intersection like in cost_pass_comp.glsl
+    ivec2 start = max(ivec2(floor(bl)), core_min);
+    ivec2 end = min(ivec2(floor(tr)), core_max - 1);
+
+    vec4 sum = vec4(0.);
+    float weight_sum = 0.;
+    for (int y = start.y; y <= end.y; y++)
+    {
+        for (int x = start.x; x <= end.x; x++)
+        {
+            vec2 curr_bl = vec2(x, y);
+            vec2 curr_tr = curr_bl + 1.;
+
+            vec2 intr_diagonal = max(min(tr, curr_tr) - max(bl, curr_bl), 0.);
+            float intr_area = intr_diagonal.x * intr_diagonal.y;
+
+            sum += intr_area
+                * texelFetch(src_img, ivec2(x, y) - src_offset, 0);
+            weight_sum += intr_area;
+        }
+    }
+
+    // a tile only sees part of the pixels, so divide by the area the whole
+    // image would cover instead
+    if (mode == MODE_TILE)
+    {
+        vec2 footprint = min(tr, vec2(src_res)) - bl;
+        weight_sum = footprint.x * footprint.y;
+    }
+    vec4 col = sum / max(weight_sum, 1e-6);
+    col.rgb *= mul;
+
+#ifdef LUMINANCE
+    col = vec4(dot(col.rgb, LUMINANCE_WEIGHTS));
+#endif
+
+    // everything up to here is linear so the shares of the tiles add up
+    if (mode == MODE_TILE)
+    {
+        imageStore(dst_img, icoord, imageLoad(dst_img, icoord) + col);
+        return;
+    }
+
+#ifdef LOG
+    // clip negative values and add a small offset to avoid infinity
+    col.rgb = log(max(col.rgb, 0.) + .01);
+#endif
+
+    imageStore(dst_img, icoord, col);
+}
@@ -100,6 +100,8 @@ namespace img_aligner
             "done initializing ({} s)\n"
         );
 
+        set_exr_thread_count(exr_n_threads);
+
         if (state.cli_mode)
         {
             init_context();
@@ -194,6 +196,17 @@ namespace img_aligner
                 update_ui_scale_reload_fonts_and_style();
             }
 
+            // show the warped hires image once the optimization thread has
+            // rendered it
+            if (need_to_show_warped_hires_img
+                && !is_optimizing
+                && ui_pass != nullptr)
+            {
+                need_to_show_warped_hires_img = false;
+                recreate_ui_pass();
+                select_ui_pass_image(grid_warp::WARPED_HIRES_IMAGE_NAME);
+            }
+
             // start the Dear ImGui frame
             ImGui_ImplVulkan_NewFrame();
             ImGui_ImplGlfw_NewFrame();
@@ -314,6 +327,9 @@ namespace img_aligner
         target_img_mem = nullptr;
         target_imgview = nullptr;
 
+        base_tiled_img = nullptr;
+        target_tiled_img = nullptr;
+
         if (state.device != nullptr)
         {
             state.device->wait_idle();
@@ -337,7 +353,12 @@ namespace img_aligner
         }
 
         state.cmd_pools.clear();
-        state.transient_cmd_pools.clear();
+
+        state.upload_staging_rings.clear();
+        state.readback_staging_rings.clear();
+
+        // after the staging rings because they hold on to submit tickets
+        state.single_time_cmd_pools.clear();
 
         state.mem_bank = nullptr;
 
@@ -894,6 +915,64 @@ namespace img_aligner
             "target image multiplier"
         )->capture_default_str();
 
+        cli_app->add_option(
+            "-I,--input-tile",
+            input_img_tile_size,
+            "keep the tiles of the base and target images in temporary files "
+            "and upload them to the GPU in tiles of this size when they're "
+            "used, for images that don't fit in memory. the warped image is "
+            "then exported in tiles too (OpenEXR only). use 0 to disable."
+        )->capture_default_str();
+
+        cli_app->add_option(
+            "-e,--export-tile",
+            export_warped_img_tile_size,
+            "render and export the warped image in tiles of this size so it "
+            "never has to fit in GPU memory as a whole (OpenEXR only). use 0 "
+            "to disable."
+        )->capture_default_str();
+
+        cli_app->add_option(
+            "--exr-threads",
+            exr_n_threads,
+            "number of threads OpenEXR uses to decode and encode images. use 0 "
+            "to disable threading."
+        )->capture_default_str();
+
+        cli_app->add_option(
+            "--exr-compression",
+            exr_options.compression,
+            fmt::format(
+                "compression of exported OpenEXR images (default: {})",
+                ExrCompression_to_str(exr_options.compression)
+            )
+        )->transform(CLI::CheckedTransformer(
+            std::map<std::string, ExrCompression>{
+                { "none", ExrCompression::None },
+                { "zip", ExrCompression::Zip },
+                { "zips", ExrCompression::Zips },
+                { "piz", ExrCompression::Piz },
+                { "dwaa", ExrCompression::Dwaa },
+                { "dwab", ExrCompression::Dwab }
+            },
+            CLI::ignore_case
+        ));
+
+        cli_app->add_option(
+            "--exr-pixel-type",
+            exr_options.pixel_type,
+            fmt::format(
+                "pixel type of exported OpenEXR images (default: {})",
+                ExrPixelType_to_str(exr_options.pixel_type)
+            )
+        )->transform(CLI::CheckedTransformer(
+            std::map<std::string, ExrPixelType>{
+                { "half", ExrPixelType::Half },
+                { "float", ExrPixelType::Float }
+            },
+            CLI::ignore_case
+        ));
+
         cli_add_toggle(
             *cli_app,
             "-U,--undo-base-mul",
@@ -932,6 +1011,51 @@ namespace img_aligner
             "seed number to use for pseudo-random number generators"
         )->capture_default_str();
 
+        cli_app->add_option(
+            "-j,--pipeline-depth",
+            grid_warp_params.pipeline_depth,
+            "max. number of warp candidates evaluated in parallel with "
+            "building the next ones. 1 disables pipelining. ignored if "
+            "batching or resident iterations are enabled."
+        )->capture_default_str();
+
+        cli_app->add_option(
+            "-k,--batch-size",
+            grid_warp_params.batch_size,
+            "number of warp candidates evaluated together in every iteration, "
+            "the best one is kept. 1 disables batching. if more than 1, "
+            "pipelining is disabled."
+        )->capture_default_str();
+
+        cli_app->add_option(
+            "-L,--resident-iters",
+            grid_warp_params.resident_iters,
+            "number of warp iterations run entirely on the GPU in a single "
+            "submission. 1 disables it. if more than 1 (and batching is "
+            "disabled), pipelining is disabled."
+        )->capture_default_str();
+
+        cli_app->add_flag(
+            "-H,--half",
+            grid_warp_params.half_precision,
+            "use 16-bit floats for the intermediate warped and difference "
+            "images. the output is still 32-bit."
+        );
+
+        cli_app->add_flag(
+            "-l,--luminance",
+            grid_warp_params.luminance,
+            "only compare the luminance of the images during optimization. "
+            "the output still has all channels."
+        );
+
+        cli_app->add_flag(
+            "-E,--half-textures",
+            half_precision_textures,
+            "keep the base and target images in 16-bit floats on the GPU. "
+            "half float OpenEXR images are uploaded as-is."
+        );
+
         cli_app->add_option(
             "-X,--scalex",
             grid_transform.scale.x,
@@ -1132,42 +1256,58 @@ namespace img_aligner
             throw std::invalid_argument("target image path is required");
         }
 
-        try
         {
-            ScopedTimer timer(!cli_params.flag_silent, "loading base image");
-            load_image(
+            ScopedTimer timer(!cli_params.flag_silent, "loading images");
+
+            // decode and upload both images at the same time. the target
+            // image uses the optimization queue because a queue can't be used
+            // by two threads at once and the optimization hasn't started yet.
+            auto base_img_future = load_image_async(
                 state,
+                state.queue_main,
                 cli_params.base_img_path,
-                base_img,
-                base_img_mem,
-                base_imgview
+                half_precision_textures,
+                input_img_tile_size
             );
-        }
-        catch (const std::exception& e)
-        {
-            throw std::runtime_error(fmt::format(
-                "failed to load base image: {}",
-                e.what()
-            ).c_str());
-        }
-
-        try
-        {
-            ScopedTimer timer(!cli_params.flag_silent, "loading target image");
-            load_image(
+            auto target_img_future = load_image_async(
                 state,
+                state.queue_grid_warp_optimize,
                 cli_params.target_img_path,
-                target_img,
-                target_img_mem,
-                target_imgview
+                half_precision_textures,
+                input_img_tile_size
             );
-        }
-        catch (const std::exception& e)
-        {
-            throw std::runtime_error(fmt::format(
-                "failed to load target image: {}",
-                e.what()
-            ).c_str());
+
+            try
+            {
+                LoadedImage loaded = base_img_future.get();
+                base_img = loaded.img;
+                base_img_mem = loaded.img_mem;
+                base_imgview = loaded.imgview;
+                base_tiled_img = loaded.tiled_img;
+            }
+            catch (const std::exception& e)
+            {
+                throw std::runtime_error(fmt::format(
+                    "failed to load base image: {}",
+                    e.what()
+                ).c_str());
+            }
+
+            try
+            {
+                LoadedImage loaded = target_img_future.get();
+                target_img = loaded.img;
+                target_img_mem = loaded.img_mem;
+                target_imgview = loaded.imgview;
+                target_tiled_img = loaded.tiled_img;
+            }
+            catch (const std::exception& e)
+            {
+                throw std::runtime_error(fmt::format(
+                    "failed to load target image: {}",
+                    e.what()
+                ).c_str());
+            }
         }
 
         try
@@ -1194,7 +1334,9 @@ namespace img_aligner
                 save_image(
                     state,
                     grid_warper->get_difference_img(),
-                    cli_params.difference_img_before_opt_path
+                    cli_params.difference_img_before_opt_path,
+                    1.f,
+                    exr_options
                 );
             }
         }
@@ -1259,15 +1401,7 @@ namespace img_aligner
                     !cli_params.flag_silent,
                     "exporting warped image"
                 );
-                save_image(
-                    state,
-                    grid_warper->get_warped_hires_img(),
-                    cli_params.output_img_path,
-
-                    export_warped_img_undo_base_img_mul
-                    ? 1.f / grid_warp_params.base_img_mul
-                    : 1.f
-                );
+                save_warped_img(cli_params.output_img_path);
             }
         }
         catch (const std::exception& e)
@@ -1289,7 +1423,9 @@ namespace img_aligner
                 save_image(
                     state,
                     grid_warper->get_difference_img(),
-                    cli_params.difference_img_after_opt_path
+                    cli_params.difference_img_after_opt_path,
+                    1.f,
+                    exr_options
                 );
             }
         }
@@ -1370,6 +1506,12 @@ namespace img_aligner
 
             j2["rng_seed"] = to_str_hp(grid_warp_params.rng_seed);
 
+            j2["pipeline_depth"] = to_str_hp(grid_warp_params.pipeline_depth);
+            j2["batch_size"] = to_str_hp(grid_warp_params.batch_size);
+            j2["resident_iters"] = to_str_hp(grid_warp_params.resident_iters);
+            j2["half_precision"] = grid_warp_params.half_precision;
+            j2["luminance"] = grid_warp_params.luminance;
+
             j["grid_warp_params"] = j2;
         }
 
@@ -1529,8 +1671,9 @@ namespace img_aligner
             );
             j2["count"] = to_str_hp(grid_warper->get_n_vertices());
 
-            const auto vertices = grid_warper->get_vertices();
-            for (size_t i = 0; i < grid_warper->get_n_vertices(); i++)
+            std::vector<grid_warp::GridVertex> vertices;
+            grid_warper->get_vertices(vertices);
+            for (size_t i = 0; i < vertices.size(); i++)
             {
                 const auto& vert = vertices[i];
 
@@ -1567,19 +1710,27 @@ namespace img_aligner
         std::optional<std::string> error;
         try
         {
-            if (!base_img)
+            if (!base_img && !base_tiled_img)
             {
                 throw std::string("there's no base image");
             }
-            if (!target_img)
+            if (!target_img && !target_tiled_img)
             {
                 throw std::string("there's no target image");
             }
 
-            uint32_t base_img_width = base_img->config().extent.width;
-            uint32_t base_img_height = base_img->config().extent.height;
-            uint32_t target_img_width = target_img->config().extent.width;
-            uint32_t target_img_height = target_img->config().extent.height;
+            uint32_t base_img_width = base_tiled_img
+                ? base_tiled_img->width()
+                : base_img->config().extent.width;
+            uint32_t base_img_height = base_tiled_img
+                ? base_tiled_img->height()
+                : base_img->config().extent.height;
+            uint32_t target_img_width = target_tiled_img
+                ? target_tiled_img->width()
+                : target_img->config().extent.width;
+            uint32_t target_img_height = target_tiled_img
+                ? target_tiled_img->height()
+                : target_img->config().extent.height;
 
             if (base_img_width != target_img_width
                 || base_img_height != target_img_height)
@@ -1592,15 +1743,19 @@ namespace img_aligner
             grid_warp_params.base_imgview = base_imgview;
             grid_warp_params.target_imgview = target_imgview;
 
+            // only the grid warper keeps the tiled images alive
+            grid_warp::Params params = grid_warp_params;
+            params.base_tiled_img = base_tiled_img;
+            params.target_tiled_img = target_tiled_img;
+
             grid_warper = std::make_unique<grid_warp::GridWarper>(
                 state,
-                grid_warp_params,
+                params,
                 grid_transform,
                 state.queue_main
             );
 
-            grid_warper->run_grid_warp_pass(false, state.queue_main);
-            grid_warper->run_difference_and_cost_pass(state.queue_main);
+            grid_warper->evaluate(state.queue_main);
         }
         catch (std::string s)
         {
@@ -1654,6 +1809,17 @@ namespace img_aligner
             );
         }
 
+        // the high-resolution warped image will be rendered again when the
+        // optimization stops so we don't keep it around in the meantime.
+        if (grid_warper->get_warped_hires_img() != nullptr)
+        {
+            grid_warper->release_warped_hires_img();
+            if (!state.cli_mode && ui_pass != nullptr)
+            {
+                recreate_ui_pass();
+            }
+        }
+
         is_optimizing = true;
         optimization_info.last_jittered_transform = grid_transform;
         optimization_info.start_time =
@@ -1677,6 +1843,7 @@ namespace img_aligner
                     optimization_info.stop_reason =
                         GridWarpOptimizationStopReason::Error;
 
+                    state.release_single_time_cmd_pool();
                     is_optimizing = false;
                 }
             }
@@ -1716,6 +1883,9 @@ namespace img_aligner
             optimization_mutex.lock();
 
             bool cost_decreased = false;
+            size_t n_new_iters = 1;
+            size_t n_new_good_iters = 0;
+            std::vector<float> new_cost_history;
             if (optimization_info.n_iters <
                 optimization_params.n_transform_optimization_iters)
             {
@@ -1730,6 +1900,54 @@ namespace img_aligner
                     optimization_info.last_jittered_transform
                 );
             }
+            else if (grid_warper->get_batch_size() > 1)
+            {
+                // optimize by warping, evaluating multiple candidates at once.
+                // every candidate counts as an iteration.
+                cost_decreased = grid_warper->optimize_warp_batched(
+                    (uint32_t)optimization_info.n_iters,
+                    [this](uint32_t hash_index)
+                    {
+                        return optimization_params.calc_warp_strength(
+                            hash_index
+                        );
+                    },
+                    state.queue_grid_warp_optimize
+                );
+                n_new_iters = grid_warper->get_batch_size();
+            }
+            else if (grid_warper->get_resident_iters() > 1)
+            {
+                // optimize by warping, running multiple iterations on the GPU
+                // in a single submission. we get the cost after every one.
+                n_new_good_iters = grid_warper->optimize_warp_resident(
+                    (uint32_t)optimization_info.n_iters,
+                    [this](uint32_t hash_index)
+                    {
+                        return optimization_params.calc_warp_strength(
+                            hash_index
+                        );
+                    },
+                    state.queue_grid_warp_optimize,
+                    new_cost_history
+                );
+                n_new_iters = grid_warper->get_resident_iters();
+            }
+            else if (grid_warper->get_pipeline_depth() > 1)
+            {
+                // optimize by warping, with the next candidates being built
+                // while the GPU is busy.
+                cost_decreased = grid_warper->optimize_warp_pipelined(
+                    (uint32_t)optimization_info.n_iters,
+                    [this](uint32_t hash_index)
+                    {
+                        return optimization_params.calc_warp_strength(
+                            hash_index
+                        );
+                    },
+                    state.queue_grid_warp_optimize
+                );
+            }
             else
             {
                 // optimize by warping
@@ -1775,18 +1993,29 @@ namespace img_aligner
             else
             {
                 // update number of iterations
-                optimization_info.n_iters++;
+                optimization_info.n_iters += n_new_iters;
                 if (cost_decreased)
                 {
-                    optimization_info.n_good_iters++;
+                    n_new_good_iters++;
                 }
+                optimization_info.n_good_iters += n_new_good_iters;
 
                 // update cost history
-                if (grid_warper->get_last_avg_diff().has_value())
+                if (!new_cost_history.empty())
                 {
-                    optimization_info.cost_history.push_back(
-                        *grid_warper->get_last_avg_diff()
-                    );
+                    for (float cost : new_cost_history)
+                    {
+                        optimization_info.cost_history.push_back(cost);
+                    }
+                }
+                else if (grid_warper->get_last_avg_diff().has_value())
+                {
+                    for (size_t i = 0; i < n_new_iters; i++)
+                    {
+                        optimization_info.cost_history.push_back(
+                            *grid_warper->get_last_avg_diff()
+                        );
+                    }
                 }
             }
 
@@ -1845,12 +2074,22 @@ namespace img_aligner
 
             optimization_info_mutex.unlock();
 
+            // the optimization functions don't update the difference image,
+            // and with pipelining or batching, the other images might have a
+            // rejected candidate or nothing new at all. if another thread is
+            // about to read them, render the accepted state.
+            if (need_the_optimization_mutex)
+            {
+                grid_warper->evaluate(state.queue_grid_warp_optimize);
+            }
+
             // let other threads use the lock if they need to
             optimization_mutex.unlock();
             need_the_optimization_mutex.wait(true);
         }
 
         // finalize
+        bool render_warped_hires_img = false;
         {
             std::scoped_lock lock(optimization_mutex);
             std::scoped_lock lock2(optimization_info_mutex);
@@ -1867,27 +2106,34 @@ namespace img_aligner
                 optimization_info.start_time
             );
 
-            // run the different passes one last time
-            grid_warper->run_grid_warp_pass(
-                false,
-                state.queue_grid_warp_optimize
-            );
-            grid_warper->run_grid_warp_pass(
-                true,
-                state.queue_grid_warp_optimize
-            );
-            grid_warper->run_difference_and_cost_pass(
-                state.queue_grid_warp_optimize
-            );
+            // run the different passes one last time. in command line mode
+            // with tiled export, or with a tiled base image, the warped image
+            // is rendered tile by tile when it's exported instead.
+            render_warped_hires_img =
+                !grid_warper->has_tiled_base_img()
+                && (!state.cli_mode || export_warped_img_tile_size < 1);
+            if (render_warped_hires_img)
+            {
+                grid_warper->run_grid_warp_pass(
+                    true,
+                    state.queue_grid_warp_optimize
+                );
+            }
+            grid_warper->evaluate(state.queue_grid_warp_optimize);
+
+            // this thread is about to exit. do it before is_optimizing is
+            // cleared so the main thread can't be cleaning up the pools.
+            state.release_single_time_cmd_pool();
 
             is_optimizing = false;
         }
 
-        // switch to warped hires image in ui pass
-        if (!state.cli_mode && ui_pass != nullptr)
+        // switch to warped hires image in ui pass. the image was just
+        // allocated so the UI pass needs to be recreated, which has to happen
+        // on the main thread.
+        if (!state.cli_mode && render_warped_hires_img)
         {
-            select_ui_pass_image(grid_warp::WARPED_HIRES_IMAGE_NAME);
-            need_to_run_ui_pass = true;
+            need_to_show_warped_hires_img = true;
         }
     }
 
@@ -1952,6 +2198,20 @@ namespace img_aligner
             );
         }
 
+        // tiled images aren't shown but the intermediate images from the grid
+        // warper are
+        if (grid_warper != nullptr && (base_tiled_img || target_tiled_img))
+        {
+            max_width = std::max(
+                max_width,
+                grid_warper->get_intermediate_res_x()
+            );
+            max_height = std::max(
+                max_height,
+                grid_warper->get_intermediate_res_y()
+            );
+        }
+
         ui_pass = std::make_unique<UiPass>(
             state,
             max_width,
@@ -2015,12 +2275,7 @@ namespace img_aligner
             optimization_mutex.lock_shared();
         }
 
-        grid_vertices_copy_for_ui_preview.resize(grid_warper->get_n_vertices());
-        std::copy(
-            grid_warper->get_vertices(),
-            grid_warper->get_vertices() + grid_warper->get_n_vertices(),
-            grid_vertices_copy_for_ui_preview.data()
-        );
+        grid_warper->get_vertices(grid_vertices_copy_for_ui_preview);
 
         if (should_lock)
         {
@@ -2049,7 +2304,8 @@ namespace img_aligner
             if (browse_and_load_image(
                 base_img,
                 base_img_mem,
-                base_imgview
+                base_imgview,
+                base_tiled_img
             ))
             {
                 destroy_grid_warper(false);
@@ -2065,7 +2321,8 @@ namespace img_aligner
             if (browse_and_load_image(
                 target_img,
                 target_img_mem,
-                target_imgview
+                target_imgview,
+                target_tiled_img
             ))
             {
                 destroy_grid_warper(false);
@@ -2075,6 +2332,43 @@ namespace img_aligner
             }
         }
 
+        ImGui::Checkbox("Half Precision Textures", &half_precision_textures);
+        imgui_tooltip(
+            "Keep the base and target images in 16-bit floats on the GPU. "
+            "Half float OpenEXR images are uploaded as-is. Only affects images "
+            "loaded afterwards."
+        );
+
+        // tile size for loading the base and target images
+        imgui_small_div();
+        imgui_slider_or_drag(
+            "Input Tile Size",
+            "##input_tile_size",
+            "Keep the tiles of the base and target images in temporary files "
+            "and upload them to the GPU in tiles of this size when they're "
+            "used, for images that don't fit in memory. They can't be shown "
+            "then, and the warped image is always exported in tiles. Only "
+            "affects images loaded afterwards. Use 0 to disable.",
+            &input_img_tile_size,
+            (uint32_t)0,
+            (uint32_t)8192
+        );
+
+        // OpenEXR threads, used for loading too
+        imgui_small_div();
+        if (imgui_slider_or_drag(
+            "OpenEXR Threads",
+            "##exr_n_threads",
+            "Number of threads OpenEXR uses to decode and encode images. Use 0 "
+            "to disable threading.",
+            &exr_n_threads,
+            (uint32_t)0,
+            (uint32_t)std::max(std::thread::hardware_concurrency(), 64u)
+        ))
+        {
+            set_exr_thread_count(exr_n_threads);
+        }
+
         // base image multiplier
         imgui_small_div();
         if (imgui_slider_or_drag(
@@ -2240,6 +2534,81 @@ namespace img_aligner
             destroy_grid_warper(true);
         }
 
+        // pipeline depth
+        imgui_small_div();
+        if (imgui_slider_or_drag(
+            "Pipeline Depth",
+            "##pipeline_depth",
+            "Max. number of warp candidates that can be in flight at once "
+            "during warp optimization. While the GPU evaluates a candidate, "
+            "the CPU builds the next ones. 1 disables pipelining. Ignored if "
+            "batching or resident iterations are enabled.",
+            &grid_warp_params.pipeline_depth,
+            (uint32_t)1,
+            (uint32_t)8
+        ))
+        {
+            destroy_grid_warper(true);
+        }
+
+        // batch size
+        imgui_small_div();
+        if (imgui_slider_or_drag(
+            "Batch Size",
+            "##batch_size",
+            "Number of warp candidates rendered and evaluated together in a "
+            "single submission during warp optimization. The best one is kept. "
+            "1 disables batching. If more than 1, pipelining is disabled.",
+            &grid_warp_params.batch_size,
+            (uint32_t)1,
+            (uint32_t)16
+        ))
+        {
+            destroy_grid_warper(true);
+        }
+
+        // resident iterations
+        imgui_small_div();
+        if (imgui_slider_or_drag(
+            "Resident Iterations",
+            "##resident_iters",
+            "Number of warp iterations run entirely on the GPU in a single "
+            "submission during warp optimization, including the decision to "
+            "keep or undo every candidate. 1 disables it. If more than 1 (and "
+            "batching is disabled), pipelining is disabled.",
+            &grid_warp_params.resident_iters,
+            (uint32_t)1,
+            (uint32_t)256
+        ))
+        {
+            destroy_grid_warper(true);
+        }
+
+        // half precision
+        imgui_small_div();
+        if (ImGui::Checkbox("Half Precision", &grid_warp_params.half_precision))
+        {
+            destroy_grid_warper(true);
+        }
+        imgui_tooltip(
+            "Use 16-bit floats for the intermediate warped and difference "
+            "images during optimization to save memory bandwidth. The exported "
+            "warped image is still 32-bit."
+        );
+
+        // luminance
+        imgui_small_div();
+        if (ImGui::Checkbox("Luminance Only", &grid_warp_params.luminance))
+        {
+            destroy_grid_warper(true);
+        }
+        imgui_tooltip(
+            "Only compare the luminance of the base and target images during "
+            "optimization. This is usually enough for exposure brackets and "
+            "reduces memory bandwidth. The exported warped image still has "
+            "all channels."
+        );
+
         // create grid warper
         imgui_small_div();
         if (!grid_warper && imgui_button_full_width("Recreate Grid Warper"))
@@ -2354,8 +2723,7 @@ namespace img_aligner
             {
                 grid_warper->regenerate_grid_vertices(grid_transform);
 
-                grid_warper->run_grid_warp_pass(false, state.queue_main);
-                grid_warper->run_difference_and_cost_pass(state.queue_main);
+                grid_warper->evaluate(state.queue_main);
 
                 if (ui_pass != nullptr)
                 {
@@ -2709,15 +3077,77 @@ namespace img_aligner
             "warped image"
         );
 
+        // tile size for exporting the warped image
+        imgui_small_div();
+        imgui_slider_or_drag(
+            "Export Tile Size",
+            "##export_tile_size",
+            "Render and export the warped image in tiles of this size so it "
+            "never has to fit in GPU memory as a whole. Only supported for "
+            "OpenEXR. Use 0 to disable.",
+            &export_warped_img_tile_size,
+            (uint32_t)0,
+            (uint32_t)8192
+        );
+
+        ImGui::EndDisabled();
+
+        // OpenEXR output options
+        imgui_small_div();
+        {
+            ImGui::TextWrapped("OpenEXR Compression");
+            imgui_tooltip("Compression of exported OpenEXR images");
+
+            std::vector<std::string> names;
+            for (int i = 0; i <= (int)ExrCompression::Dwab; i++)
+            {
+                names.push_back(ExrCompression_to_str((ExrCompression)i));
+            }
+            int selected_idx = (int)exr_options.compression;
+            if (imgui_combo(
+                "##exr_compression",
+                names,
+                &selected_idx,
+                true
+            ))
+            {
+                exr_options.compression = (ExrCompression)selected_idx;
+            }
+        }
+
+        {
+            ImGui::TextWrapped("OpenEXR Pixel Type");
+            imgui_tooltip("Pixel type of exported OpenEXR images");
+
+            std::vector<std::string> names;
+            for (int i = 0; i <= (int)ExrPixelType::Float; i++)
+            {
+                names.push_back(ExrPixelType_to_str((ExrPixelType)i));
+            }
+            int selected_idx = (int)exr_options.pixel_type;
+            if (imgui_combo(
+                "##exr_pixel_type",
+                names,
+                &selected_idx,
+                true
+            ))
+            {
+                exr_options.pixel_type = (ExrPixelType)selected_idx;
+            }
+        }
+
+        ImGui::BeginDisabled(optimization_info.n_iters < 1);
+
         // export warped image
         if (imgui_button_full_width("Export Warped Image"))
         {
             browse_and_save_image(
-                grid_warper->get_warped_hires_img(),
-
-                export_warped_img_undo_base_img_mul
-                ? 1.f / grid_warp_params.base_img_mul
-                : 1.f
+                [this](const std::filesystem::path& path)
+                {
+                    save_warped_img(path);
+                },
+                export_warped_img_tile_size > 0
+                || grid_warper->has_tiled_base_img()
             );
         }
         imgui_tooltip("Export the warped image at full resolution");
@@ -3555,7 +3985,8 @@ namespace img_aligner
     bool App::browse_and_load_image(
         bv::ImagePtr& img,
         bv::MemoryChunkPtr& img_mem,
-        bv::ImageViewPtr& imgview
+        bv::ImageViewPtr& imgview,
+        std::shared_ptr<TiledImage>& tiled_img
     )
     {
         nfdu8char_t* nfd_filename;
@@ -3577,7 +4008,29 @@ namespace img_aligner
 
             try
             {
-                load_image(state, filename, img, img_mem, imgview);
+                if (input_img_tile_size > 0)
+                {
+                    tiled_img = load_tiled_image(
+                        filename,
+                        half_precision_textures,
+                        input_img_tile_size
+                    );
+                    img = nullptr;
+                    img_mem = nullptr;
+                    imgview = nullptr;
+                    return true;
+                }
+
+                load_image(
+                    state,
+                    state.queue_main,
+                    filename,
+                    half_precision_textures,
+                    img,
+                    img_mem,
+                    imgview
+                );
+                tiled_img = nullptr;
                 return true;
             }
             catch (const std::exception& e)
@@ -3607,6 +4060,19 @@ namespace img_aligner
     }
 
     void App::browse_and_save_image(const bv::ImagePtr& img, float mul)
+    {
+        browse_and_save_image(
+            [this, &img, mul](const std::filesystem::path& path)
+            {
+                save_image(state, img, path, mul, exr_options);
+            }
+        );
+    }
+
+    void App::browse_and_save_image(
+        const std::function<void(const std::filesystem::path&)>& save_fn,
+        bool exr_only
+    )
     {
         nfdu8char_t* nfd_filename;
         nfdsavedialogu8args_t args{ 0 };
@@ -3616,7 +4082,8 @@ namespace img_aligner
             { "JPEG", "jpg,jpeg" }
         };
         args.filterList = filters;
-        args.filterCount = sizeof(filters) / sizeof(nfdu8filteritem_t);
+        args.filterCount =
+            exr_only ? 1 : sizeof(filters) / sizeof(nfdu8filteritem_t);
 
         nfdresult_t result = NFD_SaveDialogU8_With(&nfd_filename, &args);
         if (result == NFD_OKAY)
@@ -3626,7 +4093,7 @@ namespace img_aligner
 
             try
             {
-                save_image(state, img, filename, mul);
+                save_fn(filename);
             }
             catch (const std::exception& e)
             {
@@ -3652,6 +4119,71 @@ namespace img_aligner
         }
     }
 
+    void App::save_warped_img(const std::filesystem::path& path)
+    {
+        float mul =
+            export_warped_img_undo_base_img_mul
+            ? 1.f / grid_warp_params.base_img_mul
+            : 1.f;
+
+        // a tiled base image can only be rendered in tiles
+        uint32_t tile_size = export_warped_img_tile_size;
+        if (tile_size < 1 && grid_warper->has_tiled_base_img())
+        {
+            tile_size = base_tiled_img->tile_size();
+        }
+
+        if (tile_size > 0)
+        {
+            uint32_t height = grid_warper->get_img_height();
+            save_image_tiled(
+                path,
+                grid_warper->get_img_width(),
+                height,
+                tile_size,
+                [this, height](
+                    uint32_t x,
+                    uint32_t y,
+                    uint32_t tile_width,
+                    uint32_t tile_height
+                    )
+                {
+                    // the file goes from top to bottom but our images are
+                    // flipped vertically
+                    return grid_warper->render_warped_hires_tile(
+                        state.queue_main,
+                        x,
+                        height - y - tile_height,
+                        tile_width,
+                        tile_height,
+                        true
+                    );
+                },
+                mul,
+                exr_options
+            );
+            grid_warper->release_warped_tile_img();
+            return;
+        }
+
+        // the warped hires image is rendered on demand
+        if (!grid_warper->get_warped_hires_img())
+        {
+            grid_warper->run_grid_warp_pass(true, state.queue_main);
+            if (!state.cli_mode && ui_pass != nullptr)
+            {
+                recreate_ui_pass();
+            }
+        }
+        save_image(
+            state,
+            grid_warper->get_warped_hires_img(),
+            path,
+            mul,
+            exr_options
+        );
+    }
+
     void App::browse_and_export_metadata()
     {
         nfdu8char_t* nfd_filename;
@@ -150,6 +150,20 @@ namespace img_aligner
         bv::MemoryChunkPtr target_img_mem = nullptr;
         bv::ImageViewPtr target_imgview = nullptr;
 
+        // used instead of the images above when they're loaded in tiles
+        std::shared_ptr<TiledImage> base_tiled_img = nullptr;
+        std::shared_ptr<TiledImage> target_tiled_img = nullptr;
+
+        // load the base and target images as R16G16B16A16_SFLOAT instead of
+        // R32G32B32A32_SFLOAT
+        bool half_precision_textures = false;
+
+        // keep the tiles of the base and target images in temporary files and
+        // upload them in tiles of this size when they're used, for images that
+        // don't fit in memory. they can't be shown in the UI then, and the
+        // warped image is always exported in tiles. 0 disables tiled loading.
+        uint32_t input_img_tile_size = 0;
+
         // grid warper params and itself
         grid_warp::Params grid_warp_params;
         Transform2d grid_transform;
@@ -175,6 +189,16 @@ namespace img_aligner
 
         // export options
         bool export_warped_img_undo_base_img_mul = true;
+
+        // render and export the warped image in tiles of this size (OpenEXR
+        // only) instead of allocating the whole thing on the GPU. 0 disables
+        // tiled export.
+        uint32_t export_warped_img_tile_size = 0;
+
+        // OpenEXR threads (for loading too) and output settings
+        uint32_t exr_n_threads = std::thread::hardware_concurrency();
+        ExrOptions exr_options;
+
         MetadataExportOptions metadata_export_options;
 
         void init();
@@ -194,6 +218,10 @@ namespace img_aligner
         std::unique_ptr<UiPass> ui_pass = nullptr;
         bool need_to_run_ui_pass = false;
 
+        // set by the optimization thread after it renders the warped hires
+        // image, see start_optimization_internal().
+        bool need_to_show_warped_hires_img = false;
+
         float ui_scale = 1.f;
         bool ui_scale_updated = false;
 
@@ -272,12 +300,20 @@ namespace img_aligner
         void render_frame(ImDrawData* draw_data);
         void present_frame();
 
+        // loads into tiled_img instead of the others if input_img_tile_size
+        // isn't 0
         bool browse_and_load_image(
             bv::ImagePtr& img,
             bv::MemoryChunkPtr& img_mem,
-            bv::ImageViewPtr& imgview
+            bv::ImageViewPtr& imgview,
+            std::shared_ptr<TiledImage>& tiled_img
         );
         void browse_and_save_image(const bv::ImagePtr& img, float mul = 1.f);
+        void browse_and_save_image(
+            const std::function<void(const std::filesystem::path&)>& save_fn,
+            bool exr_only = false
+        );
+        void save_warped_img(const std::filesystem::path& path);
         void browse_and_export_metadata();
 
         void select_ui_pass_image(std::string_view name);
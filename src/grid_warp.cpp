@@ -3,12 +3,6 @@
 namespace img_aligner::grid_warp
 {
 
-    const bv::VertexInputBindingDescription GridVertex::binding{
-            .binding = 0,
-            .stride = sizeof(GridVertex),
-            .input_rate = VK_VERTEX_INPUT_RATE_VERTEX
-    };
-
     bool GridVertex::operator==(const GridVertex& other) const
     {
         return
@@ -16,6 +10,23 @@ namespace img_aligner::grid_warp
             && orig_pos == other.orig_pos;
     }
 
+    // binding 0 has the warped positions and binding 1 has the original
+    // positions, see GridWarper::vertex_buf and GridWarper::orig_pos_buf.
+    static const std::vector<bv::VertexInputBindingDescription>
+        gwp_vertex_bindings
+    {
+        bv::VertexInputBindingDescription{
+            .binding = 0,
+            .stride = sizeof(glm::vec2),
+            .input_rate = VK_VERTEX_INPUT_RATE_VERTEX
+        },
+        bv::VertexInputBindingDescription{
+            .binding = 1,
+            .stride = sizeof(glm::vec2),
+            .input_rate = VK_VERTEX_INPUT_RATE_VERTEX
+        }
+    };
+
     static const std::vector<bv::VertexInputAttributeDescription>
         gwp_vertex_attributes
     {
@@ -23,57 +34,87 @@ namespace img_aligner::grid_warp
             .location = 0,
             .binding = 0,
             .format = VK_FORMAT_R32G32_SFLOAT,
-            .offset = offsetof(GridVertex, warped_pos)
+            .offset = 0
         },
         bv::VertexInputAttributeDescription{
             .location = 1,
-            .binding = 0,
+            .binding = 1,
             .format = VK_FORMAT_R32G32_SFLOAT,
-            .offset = offsetof(GridVertex, orig_pos)
+            .offset = 0
         }
     };
 
-    GridWarper::GridWarper(
-        AppState& state,
-        const Params& params,
-        const Transform2d& grid_transform,
-        const bv::QueuePtr& queue
+    // resolution of the base or target image, which is either a texture or a
+    // TiledImage
+    static VkExtent2D get_img_extent(
+        const bv::ImageViewWPtr& imgview,
+        const std::shared_ptr<TiledImage>& tiled_img,
+        std::string_view name,
+        AppState& state
     )
-        : state(state),
-        rng_seed(params.rng_seed),
-        base_imgview(params.base_imgview),
-        target_imgview(params.target_imgview)
     {
-        if (base_imgview.expired())
-        {
-            throw std::invalid_argument("provided base image view has expired");
-        }
-        if (target_imgview.expired())
+        if (tiled_img)
         {
-            throw std::invalid_argument(
-                "provided target image view has expired"
-            );
+            // the textures have an extra pixel on every side
+            const auto& limits =
+                state.physical_device.value().properties().limits;
+            if (tiled_img->tile_size() + 2 > limits.max_image_dimension_2d)
+            {
+                throw std::invalid_argument(fmt::format(
+                    "the {} image's tile size ({}) is too large for the GPU",
+                    name,
+                    tiled_img->tile_size()
+                ).c_str());
+            }
+            return { tiled_img->width(), tiled_img->height() };
         }
 
-        auto base_imgview_locked = base_imgview.lock();
-        auto target_imgview_locked = target_imgview.lock();
-
-        if (base_imgview_locked->image().expired())
+        if (imgview.expired())
         {
-            throw std::invalid_argument(
-                "provided base image view's parent image has expired"
-            );
+            throw std::invalid_argument(fmt::format(
+                "provided {} image view has expired",
+                name
+            ).c_str());
         }
-        if (target_imgview_locked->image().expired())
+
+        auto imgview_locked = imgview.lock();
+        if (imgview_locked->image().expired())
         {
-            throw std::invalid_argument(
-                "provided target image view's parent image has expired"
-            );
+            throw std::invalid_argument(fmt::format(
+                "provided {} image view's parent image has expired",
+                name
+            ).c_str());
         }
 
-        auto base_extent = base_imgview_locked->image().lock()->config().extent;
-        auto target_extent =
-            target_imgview_locked->image().lock()->config().extent;
+        auto extent = imgview_locked->image().lock()->config().extent;
+        return { extent.width, extent.height };
+    }
+
+    GridWarper::GridWarper(
+        AppState& state,
+        const Params& params,
+        const Transform2d& grid_transform,
+        const bv::QueuePtr& queue
+    )
+        : state(state),
+        rng_seed(params.rng_seed),
+        base_imgview(params.base_imgview),
+        target_imgview(params.target_imgview),
+        base_tiled_img(params.base_tiled_img),
+        target_tiled_img(params.target_tiled_img)
+    {
+        VkExtent2D base_extent = get_img_extent(
+            base_imgview,
+            base_tiled_img,
+            "base",
+            state
+        );
+        VkExtent2D target_extent = get_img_extent(
+            target_imgview,
+            target_tiled_img,
+            "target",
+            state
+        );
 
         if (base_extent.width != target_extent.width
             || base_extent.height != target_extent.height)
@@ -99,7 +140,7 @@ namespace img_aligner::grid_warp
 
         double area_fac =
             (double)params.intermediate_res_area
-            / (double)(img_width * img_height);
+            / ((double)img_width * (double)img_height);
         double size_fac = std::clamp(std::sqrt(area_fac), 0., 1.);
 
         intermediate_res_x = (uint32_t)std::floor(size_fac * (double)img_width);
@@ -121,7 +162,7 @@ namespace img_aligner::grid_warp
 
         area_fac =
             (double)params.cost_res_area
-            / (double)(img_width * img_height);
+            / ((double)img_width * (double)img_height);
         size_fac = std::clamp(std::sqrt(area_fac), 0., 1.);
 
         cost_res_x = (uint32_t)std::floor(size_fac * (double)img_width);
@@ -138,6 +179,25 @@ namespace img_aligner::grid_warp
             intermediate_res_y
         );
 
+        // figure out how many chunks (workgroups) the footprint of every cost
+        // pixel is split into in the cost pass. we aim for about 16 pixels per
+        // invocation with 256 invocations per workgroup.
+        {
+            uint64_t footprint =
+                (uint64_t)std::ceil(
+                    (double)intermediate_res_x / (double)cost_res_x + 1.
+                )
+                * (uint64_t)std::ceil(
+                    (double)intermediate_res_y / (double)cost_res_y + 1.
+                );
+
+            n_cost_chunks = (uint32_t)std::clamp(
+                (footprint + (256 * 16) - 1) / (256 * 16),
+                (uint64_t)1,
+                (uint64_t)256
+            );
+        }
+
         // figure out the grid resolution
 
         area_fac =
@@ -186,22 +246,169 @@ namespace img_aligner::grid_warp
         if ((padded_grid_res_y - grid_res_y) % 2 != 0)
             padded_grid_res_y++;
 
+        batch_size = params.batch_size;
+        if (batch_size < 1)
+        {
+            throw std::invalid_argument("batch size must be at least 1");
+        }
+
+        resident_iters = params.resident_iters;
+        if (resident_iters < 1)
+        {
+            throw std::invalid_argument(
+                "number of resident iterations must be at least 1"
+            );
+        }
+
+        half_precision = params.half_precision;
+        luminance = params.luminance;
+        if (luminance)
+        {
+            warped_img_format = half_precision
+                ? VK_FORMAT_R16_SFLOAT
+                : VK_FORMAT_R32_SFLOAT;
+        }
+        else if (half_precision)
+        {
+            warped_img_format = VK_FORMAT_R16G16B16A16_SFLOAT;
+        }
+        if (half_precision)
+        {
+            difference_img_format = VK_FORMAT_R16_SFLOAT;
+        }
+
         // set up push constants
         gwp_frag_push_constants.base_img_mul = params.base_img_mul;
-        dfp_frag_push_constants.target_img_mul = params.target_img_mul;
+        csp_push_constants.n_chunks = n_cost_chunks;
+        csp_push_constants.cost_res = { cost_res_x, cost_res_y };
+        csp_push_constants.cost_offset = { 0, 0 };
+        csp_push_constants.cost_extent = { cost_res_x, cost_res_y };
+        fcp_push_constants = csp_push_constants;
+        dsp_push_constants.padded_grid_res = {
+            padded_grid_res_x,
+            padded_grid_res_y
+        };
+        dsp_push_constants.intermediate_res = {
+            (float)intermediate_res_x,
+            (float)intermediate_res_y
+        };
 
         create_vertex_and_index_buffer_and_generate_vertices(
             grid_transform,
             queue
         );
-        make_copy_of_vertices();
+        dsp_push_constants.n_vertices = n_vertices;
         create_sampler_and_images(queue);
+        create_base_interm_img(queue);
+        create_target_log_img(queue, params.target_img_mul);
         create_passes();
+        create_cmd_bufs();
+        if (params.pipeline_depth < 1)
+        {
+            throw std::invalid_argument("pipeline depth must be at least 1");
+        }
+        if (params.pipeline_depth > 1 && batch_size < 2 && resident_iters < 2)
+        {
+            create_pipeline_slots(params.pipeline_depth);
+        }
+        if (batch_size > 1)
+        {
+            create_batch_resources(queue);
+        }
+        if (resident_iters > 1)
+        {
+            create_resident_resources();
+        }
     }
 
     GridWarper::~GridWarper()
     {
-        dfp_fence = nullptr;
+        drain_pipeline();
+        pipeline_slots.clear();
+        pipeline_free_slots.clear();
+        pipeline_descriptor_pool = nullptr;
+
+        resident_cmd_buf = nullptr;
+        resident_fence = nullptr;
+        acp_descriptor_set = nullptr;
+        dsp_descriptor_set = nullptr;
+        resident_cip_descriptor_set = nullptr;
+        resident_descriptor_pool = nullptr;
+        resident_history_buf = nullptr;
+        resident_history_buf_mem = nullptr;
+        resident_cost_info_buf = nullptr;
+        resident_cost_info_buf_mem = nullptr;
+        resident_state_buf = nullptr;
+        resident_state_buf_mem = nullptr;
+        resident_warp_buf = nullptr;
+        resident_warp_buf_mem = nullptr;
+        resident_candidate_vertex_buf = nullptr;
+        resident_candidate_vertex_buf_mem = nullptr;
+
+        batch_cmd_buf = nullptr;
+        batch_fence = nullptr;
+        batch_gwp_framebufs.clear();
+        batch_fcp_descriptor_sets.clear();
+        batch_crp_descriptor_sets.clear();
+        batch_descriptor_pool = nullptr;
+        batch_partial_sums_bufs.clear();
+        batch_partial_sums_buf_mems.clear();
+        batch_warped_imgviews.clear();
+        batch_warped_img = nullptr;
+        batch_warped_img_mem = nullptr;
+        batch_cost_imgviews.clear();
+        batch_cost_img = nullptr;
+        batch_cost_img_mem = nullptr;
+        batch_cost_cache_buf = nullptr;
+        batch_cost_cache_buf_mem = nullptr;
+        batch_cost_trees.clear();
+        batch_vertex_buf = nullptr;
+        batch_vertex_buf_mem = nullptr;
+
+        dirty_cmd_buf = nullptr;
+        dirty_cmd_pool = nullptr;
+
+        eval_cmd_buf = nullptr;
+        eval_fused_cmd_buf = nullptr;
+        eval_fence = nullptr;
+
+        acp_compute_pipeline = nullptr;
+        acp_pipeline_layout = nullptr;
+        acp_descriptor_set_layout = nullptr;
+
+        dsp_compute_pipeline = nullptr;
+        dsp_pipeline_layout = nullptr;
+        dsp_descriptor_set_layout = nullptr;
+
+        cip_compute_pipeline = nullptr;
+        cip_pipeline_layout = nullptr;
+
+        cip_descriptor_set = nullptr;
+        cip_descriptor_pool = nullptr;
+        cip_descriptor_set_layout = nullptr;
+
+        crp_compute_pipeline = nullptr;
+        crp_pipeline_layout = nullptr;
+        fcp_compute_pipeline = nullptr;
+        fcp_pipeline_layout = nullptr;
+
+        crp_descriptor_set = nullptr;
+        fcp_descriptor_set = nullptr;
+        fcp_crp_descriptor_pool = nullptr;
+        crp_descriptor_set_layout = nullptr;
+        fcp_descriptor_set_layout = nullptr;
+
+        csp_compute_pipeline = nullptr;
+        csp_pipeline_layout = nullptr;
+
+        csp_descriptor_set = nullptr;
+        csp_descriptor_pool = nullptr;
+        csp_descriptor_set_layout = nullptr;
+
+        gwp_cmd_buf = nullptr;
+        gwp_cmd_buf_hires = nullptr;
+        gwp_cmd_pool_hires = nullptr;
+
         dfp_graphics_pipeline = nullptr;
         dfp_pipeline_layout = nullptr;
         dfp_framebuf = nullptr;
@@ -212,12 +419,19 @@ namespace img_aligner::grid_warp
         dfp_descriptor_set_layout = nullptr;
 
         gwp_fence = nullptr;
+        gwp_graphics_pipeline_hires = nullptr;
         gwp_graphics_pipeline = nullptr;
         gwp_pipeline_layout = nullptr;
         gwp_framebuf = nullptr;
         gwp_framebuf_hires = nullptr;
+        gwp_framebuf_tile = nullptr;
+        gwp_render_pass_hires = nullptr;
         gwp_render_pass = nullptr;
+        gwp_render_pass_load = nullptr;
 
+        gwp_tile_descriptor_sets.clear();
+        gwp_tile_descriptor_pool = nullptr;
+        gwp_descriptor_set_hires = nullptr;
         gwp_descriptor_set = nullptr;
         gwp_descriptor_pool = nullptr;
         gwp_descriptor_set_layout = nullptr;
@@ -225,6 +439,9 @@ namespace img_aligner::grid_warp
         vertex_buf = nullptr;
         vertex_buf_mem = nullptr;
 
+        orig_pos_buf = nullptr;
+        orig_pos_buf_mem = nullptr;
+
         index_buf = nullptr;
         index_buf_mem = nullptr;
 
@@ -236,247 +453,728 @@ namespace img_aligner::grid_warp
         warped_hires_img_mem = nullptr;
         warped_hires_imgview = nullptr;
 
+        warped_tile_img = nullptr;
+        warped_tile_img_mem = nullptr;
+        warped_tile_imgview = nullptr;
+
         difference_img = nullptr;
         difference_img_mem = nullptr;
         difference_imgview = nullptr;
 
+        target_log_img = nullptr;
+        target_log_img_mem = nullptr;
+        target_log_imgview = nullptr;
+
+        base_interm_img = nullptr;
+        base_interm_img_mem = nullptr;
+        base_interm_imgview = nullptr;
+
         cost_img = nullptr;
         cost_img_mem = nullptr;
         cost_imgview = nullptr;
 
-        cost_buf = nullptr;
-        cost_buf_mem = nullptr;
+        cost_info_buf = nullptr;
+        cost_info_buf_mem = nullptr;
+
+        cost_cache_buf = nullptr;
+        cost_cache_buf_mem = nullptr;
+
+        cost_partial_sums_buf = nullptr;
+        cost_partial_sums_buf_mem = nullptr;
 
         sampler = nullptr;
     }
 
     void GridWarper::run_grid_warp_pass(bool hires, const bv::QueuePtr& queue)
     {
-        auto cmd_buf = create_grid_warp_pass_cmd_buf(hires);
+        if (hires && base_tiled_img)
+        {
+            throw std::logic_error(
+                "the warped image can only be rendered in tiles when the base "
+                "image is tiled"
+            );
+        }
+
+        drain_pipeline();
+        bake_grid_transform();
+        dirty_rect_state_valid = false;
+
+        if (hires && !warped_hires_img)
+        {
+            create_warped_hires_img(queue);
+        }
+
+        auto& cmd_buf = (hires ? gwp_cmd_buf_hires : gwp_cmd_buf);
         queue->submit({}, {}, { cmd_buf }, {}, gwp_fence);
         gwp_fence->wait();
         gwp_fence->reset();
     }
 
-    CostInfo GridWarper::run_difference_and_cost_pass(const bv::QueuePtr& queue)
+    void GridWarper::release_warped_hires_img()
     {
-        auto cmd_buf = create_difference_pass_cmd_buf();
-        queue->submit({}, {}, { cmd_buf }, {}, dfp_fence);
-        dfp_fence->wait();
-        dfp_fence->reset();
-
-        cmd_buf = create_cost_pass_cmd_buf();
-        queue->submit({}, {}, { cmd_buf }, {}, csp_fence);
-        csp_fence->wait();
-        csp_fence->reset();
-
-        // find average and maximum value in the cost image
-        float avg_diff = 0.f;
-        float max_local_diff = 0.f;
-        for (size_t y = 0; y < cost_res_y; y++)
-        {
-            for (size_t x = 0; x < cost_res_x; x++)
-            {
-                float v = cost_buf_mapped[x + (y * cost_res_x)];
+        if (!warped_hires_img)
+        {
+            return;
+        }
+
+        // the command buffer references the framebuffer which references the
+        // image view, so it has to go first. run_grid_warp_pass() always waits
+        // for the submission to finish so nothing is in flight at this point.
+        gwp_cmd_buf_hires->reset(0);
+        gwp_framebuf_hires = nullptr;
+
+        warped_hires_imgview = nullptr;
+        warped_hires_img = nullptr;
+        warped_hires_img_mem = nullptr;
+    }
 
-                avg_diff += v;
+    std::vector<float> GridWarper::render_warped_hires_tile(
+        const bv::QueuePtr& queue,
+        uint32_t x,
+        uint32_t y,
+        uint32_t width,
+        uint32_t height,
+        bool vflip
+    )
+    {
+        if (width < 1 || height < 1
+            || x + width > img_width || y + height > img_height)
+        {
+            throw std::invalid_argument(fmt::format(
+                "tile at ({}, {}) with size {}x{} doesn't fit in the {}x{} "
+                "image",
+                x, y, width, height, img_width, img_height
+            ).c_str());
+        }
 
-                max_local_diff = std::max(
-                    max_local_diff,
-                    v
+        // reuse the render target from the previous tile if this one fits in
+        // it, which is all of them except maybe the first one.
+        if (!warped_tile_img
+            || width > warped_tile_img->config().extent.width
+            || height > warped_tile_img->config().extent.height)
+        {
+            uint32_t tile_img_width = width;
+            uint32_t tile_img_height = height;
+            if (warped_tile_img)
+            {
+                tile_img_width = std::max(
+                    tile_img_width,
+                    warped_tile_img->config().extent.width
+                );
+                tile_img_height = std::max(
+                    tile_img_height,
+                    warped_tile_img->config().extent.height
                 );
             }
+            create_warped_tile_img(tile_img_width, tile_img_height);
         }
-        avg_diff /= (float)(cost_res_x * cost_res_y);
 
-        return CostInfo{
-            .avg_diff = avg_diff,
-            .max_local_diff = max_local_diff
+        drain_pipeline();
+        bake_grid_transform();
+        dirty_rect_state_valid = false;
+
+        // map the tile to the render target instead of the whole image. the
+        // vertex shader does pos * 2 - 1 to get to NDC so we want the pixel
+        // coordinates relative to the tile, divided by the render target
+        // size. pixels past the tile in the render target are ignored.
+        float tile_img_width = (float)warped_tile_img->config().extent.width;
+        float tile_img_height = (float)warped_tile_img->config().extent.height;
+        GridWarpPassVertPushConstants vert_push_constants{
+            .transform_mat = glm::mat2(
+                (float)img_width / tile_img_width, 0.f,
+                0.f, (float)img_height / tile_img_height
+            ),
+            .transform_offset = glm::vec2(
+                -(float)x / tile_img_width,
+                -(float)y / tile_img_height
+            )
         };
-    }
 
-    void GridWarper::add_images_to_ui_pass(UiPass& ui_pass)
-    {
-        ui_pass.add_image(
-            warped_imgview,
-            VK_IMAGE_LAYOUT_GENERAL,
-            WARPED_IMAGE_NAME,
-            warped_img->config().extent.width,
-            warped_img->config().extent.height,
-            1.f,
-            false
-        );
+        // a tiled base image is drawn once for every tile that lands in the
+        // region. the textures must stay alive until the pass is done.
+        std::vector<BaseTileDraw> base_tile_draws;
+        std::vector<TiledImage::TexturePtr> base_tile_textures;
+        if (base_tiled_img)
+        {
+            glm::vec2 res{ img_width, img_height };
+            const auto& tiles = base_tiled_img->tiles();
+            std::vector<bv::WriteDescriptorSet> descriptor_writes;
+            for (size_t idx : find_base_tiles_in_region(x, y, width, height))
+            {
+                const auto& tile = tiles[idx];
+                auto texture = base_tiled_img->upload_tile(state, queue, idx);
+                base_tile_textures.push_back(texture);
+
+                bv::DescriptorImageInfo tile_img_info{
+                    .sampler = sampler,
+                    .image_view = texture->imgview,
+                    .image_layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+                };
+                descriptor_writes.push_back({
+                    .dst_set = gwp_tile_descriptor_sets[idx],
+                    .dst_binding = 0,
+                    .dst_array_element = 0,
+                    .descriptor_count = 1,
+                    .descriptor_type =
+                    VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                    .image_infos = { tile_img_info },
+                    .buffer_infos = {},
+                    .texel_buffer_views = {}
+                    });
+
+                // the texture coordinates can be exactly 1 on the far edges
+                // so the last tiles go a bit past them
+                glm::vec2 tex_res{ tile.tex_width, tile.tex_height };
+                GridWarpPassFragPushConstants frag_push_constants =
+                    gwp_frag_push_constants;
+                frag_push_constants.tiled = 1;
+                frag_push_constants.tile_min =
+                    glm::vec2(tile.x, tile.y) / res;
+                frag_push_constants.tile_max = glm::vec2(
+                    tile.x + tile.width >= img_width
+                    ? 2.f
+                    : (float)(tile.x + tile.width) / res.x,
+                    tile.y + tile.height >= img_height
+                    ? 2.f
+                    : (float)(tile.y + tile.height) / res.y
+                );
+                frag_push_constants.tile_uv_scale = res / tex_res;
+                frag_push_constants.tile_uv_offset =
+                    -glm::vec2(tile.tex_x, tile.tex_y) / tex_res;
+
+                base_tile_draws.push_back(BaseTileDraw{
+                    .descriptor_set = gwp_tile_descriptor_sets[idx],
+                    .frag_push_constants = frag_push_constants
+                    });
+            }
+            bv::DescriptorSet::update_sets(state.device, descriptor_writes, {});
+        }
 
-        ui_pass.add_image(
-            warped_hires_imgview,
-            VK_IMAGE_LAYOUT_GENERAL,
-            WARPED_HIRES_IMAGE_NAME,
-            warped_hires_img->config().extent.width,
-            warped_hires_img->config().extent.height,
-            1.f,
-            false
+        StagingAllocation staging = state.staging_ring(queue, true).allocate(
+            (VkDeviceSize)width * height * 4 * sizeof(float)
         );
 
-        ui_pass.add_image(
-            difference_imgview,
+        auto cmd_buf = begin_single_time_commands(state);
+        record_grid_warp_pass(
+            cmd_buf,
+            gwp_framebuf_tile,
+            vertex_buf,
+            0,
+            std::nullopt,
+            vert_push_constants,
+            base_tile_draws
+        );
+        image_memory_barrier(
+            cmd_buf,
+            warped_tile_img,
             VK_IMAGE_LAYOUT_GENERAL,
-            DIFFERENCE_IMAGE_NAME,
-            difference_img->config().extent.width,
-            difference_img->config().extent.height,
-            1.f,
-            true
+            VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+            VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+            VK_PIPELINE_STAGE_TRANSFER_BIT,
+            VK_ACCESS_TRANSFER_READ_BIT
         );
 
-        ui_pass.add_image(
-            cost_imgview,
+        // only copy the tile, tightly packed
+        VkBufferImageCopy copy_region{
+            .bufferOffset = staging.offset(),
+            .bufferRowLength = 0,
+            .bufferImageHeight = 0,
+            .imageSubresource = VkImageSubresourceLayers{
+                .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                .mipLevel = 0,
+                .baseArrayLayer = 0,
+                .layerCount = 1
+            },
+            .imageOffset = { 0, 0, 0 },
+            .imageExtent = { width, height, 1 }
+        };
+        vkCmdCopyImageToBuffer(
+            cmd_buf->handle(),
+            warped_tile_img->handle(),
             VK_IMAGE_LAYOUT_GENERAL,
-            COST_IMAGE_NAME,
-            cost_img->config().extent.width,
-            cost_img->config().extent.height,
-            1.f,
-            true
+            staging.buffer()->handle(),
+            1,
+            &copy_region
         );
+        end_single_time_commands(state, cmd_buf, queue);
+        staging.invalidate();
+
+        // copy row by row, in reverse order if flipping
+        const float* buf_mapped = (float*)staging.mapped();
+        std::vector<float> pixels_rgbaf32((size_t)width * height * 4);
+        for (size_t row = 0; row < height; row++)
+        {
+            size_t src_row = vflip ? (height - row - 1) : row;
+            std::copy(
+                buf_mapped + (src_row * width * 4),
+                buf_mapped + ((src_row + 1) * width * 4),
+                pixels_rgbaf32.data() + (row * width * 4)
+            );
+        }
+        return pixels_rgbaf32;
     }
 
-    void GridWarper::regenerate_grid_vertices(const Transform2d& grid_transform)
+    void GridWarper::release_warped_tile_img()
     {
-        float cell_width = 1.f / (float)grid_res_x;
-        float cell_height = 1.f / (float)grid_res_y;
+        gwp_framebuf_tile = nullptr;
 
-        int32_t horizontal_pad = (int32_t)(padded_grid_res_x - grid_res_x) / 2;
-        int32_t vertical_pad = (int32_t)(padded_grid_res_y - grid_res_y) / 2;
+        warped_tile_imgview = nullptr;
+        warped_tile_img = nullptr;
+        warped_tile_img_mem = nullptr;
 
-        glm::vec2 interm_res{ intermediate_res_x, intermediate_res_y };
-        float interm_res_area_sqrt = std::sqrt(
-            interm_res.x * interm_res.y
-        );
+        if (base_tiled_img)
+        {
+            base_tiled_img->release_textures();
+        }
+    }
 
-        bool no_transform = grid_transform.is_identity();
+    std::vector<size_t> GridWarper::find_base_tiles_in_region(
+        uint32_t x,
+        uint32_t y,
+        uint32_t width,
+        uint32_t height
+    ) const
+    {
+        // range of [a, b] in texture coordinates after the mirroring in
+        // grid_warp_pass_frag.glsl
+        auto mirror = [](float t)
+        {
+            return 1.f - std::abs(std::fmod(std::abs(t), 2.f) - 1.f);
+        };
+        auto mirrored_range = [&mirror](float a, float b)
+        {
+            if (b - a >= 1.f)
+            {
+                return glm::vec2(0.f, 1.f);
+            }
+
+            float ma = mirror(a);
+            float mb = mirror(b);
+            float seam = std::floor(a) + 1.f;
+            if (b <= seam)
+            {
+                return glm::vec2(std::min(ma, mb), std::max(ma, mb));
+            }
 
-        for (int32_t y = 0; y <= (int32_t)padded_grid_res_y; y++)
+            // [a, b] folds over at the seam, which is 0 on even integers and
+            // 1 on odd ones
+            if (std::fmod(std::abs(seam), 2.f) == 0.f)
+            {
+                return glm::vec2(0.f, std::max(ma, mb));
+            }
+            return glm::vec2(std::min(ma, mb), 1.f);
+        };
+
+        glm::vec2 res{ img_width, img_height };
+        glm::vec2 region_min{ x, y };
+        glm::vec2 region_max{ x + width, y + height };
+
+        uint32_t n_tiles_x = base_tiled_img->n_tiles_x();
+        uint32_t n_tiles_y = base_tiled_img->n_tiles_y();
+        float tile_size = (float)base_tiled_img->tile_size();
+        std::vector<bool> used(base_tiled_img->tiles().size(), false);
+
+        // the fragments of a grid cell stay within the bounding box of its
+        // warped positions and sample within the bounding box of its
+        // original positions
+        uint32_t stride_y = padded_grid_res_x + 1;
+        for (uint32_t cell_y = 0; cell_y < padded_grid_res_y; cell_y++)
         {
-            for (int32_t x = 0; x <= (int32_t)padded_grid_res_x; x++)
+            for (uint32_t cell_x = 0; cell_x < padded_grid_res_x; cell_x++)
             {
-                // remove the offset caused by padding
-                int32_t ax = x - horizontal_pad;
-                int32_t ay = y - vertical_pad;
-
-                // original position before transformation
-                glm::vec2 p{
-                    (float)ax * cell_width,
-                    (float)ay * cell_height
+                uint32_t first_idx = cell_y * stride_y + cell_x;
+                uint32_t indices[4]{
+                    first_idx,
+                    first_idx + 1,
+                    first_idx + stride_y,
+                    first_idx + stride_y + 1
                 };
 
-                glm::vec2 p_transformed;
-                if (no_transform)
+                glm::vec2 warped_min{ std::numeric_limits<float>::max() };
+                glm::vec2 warped_max{ std::numeric_limits<float>::lowest() };
+                glm::vec2 orig_min{ std::numeric_limits<float>::max() };
+                glm::vec2 orig_max{ std::numeric_limits<float>::lowest() };
+                for (uint32_t idx : indices)
                 {
-                    p_transformed = p;
+                    glm::vec2 warped = vertex_buf_mapped[idx] * res;
+                    warped_min = glm::min(warped_min, warped);
+                    warped_max = glm::max(warped_max, warped);
+                    orig_min = glm::min(orig_min, orig_positions[idx]);
+                    orig_max = glm::max(orig_max, orig_positions[idx]);
                 }
-                else
+
+                // a pixel of margin for rounding errors
+                if (warped_max.x < region_min.x - 1.f
+                    || warped_max.y < region_min.y - 1.f
+                    || warped_min.x > region_max.x + 1.f
+                    || warped_min.y > region_max.y + 1.f)
                 {
-                    // before applying the transform, we should convert to a
-                    // zero-centered and aspect-ratio-adjusted UV space.
-                    glm::vec2 uv = p * 2.f - 1.f; // zero-centered
-                    uv = uv * interm_res / interm_res_area_sqrt; // aspect ratio
-
-                    // apply the transform in UV space
-                    uv = grid_transform.apply(uv);
-
-                    // go back to normalized space
-                    p_transformed =
-                        (uv * interm_res_area_sqrt / interm_res)
-                        * .5f + .5f;
+                    continue;
                 }
 
-                // update the vertex
-                ACCESS_2D(vertex_buf_mapped, x, y, padded_grid_res_x + 1) = {
-                    .warped_pos = p_transformed,
-                    .orig_pos = p
+                glm::vec2 range_x = mirrored_range(orig_min.x, orig_max.x);
+                glm::vec2 range_y = mirrored_range(orig_min.y, orig_max.y);
+                auto to_tile = [tile_size](float pixel, uint32_t n_tiles)
+                {
+                    return (uint32_t)std::clamp(
+                        std::floor(pixel / tile_size),
+                        0.f,
+                        (float)(n_tiles - 1)
+                    );
                 };
+                uint32_t tile_x0 = to_tile(range_x[0] * res.x - 1.f, n_tiles_x);
+                uint32_t tile_x1 = to_tile(range_x[1] * res.x + 1.f, n_tiles_x);
+                uint32_t tile_y0 = to_tile(range_y[0] * res.y - 1.f, n_tiles_y);
+                uint32_t tile_y1 = to_tile(range_y[1] * res.y + 1.f, n_tiles_y);
+                for (uint32_t ty = tile_y0; ty <= tile_y1; ty++)
+                {
+                    for (uint32_t tx = tile_x0; tx <= tile_x1; tx++)
+                    {
+                        used[(size_t)ty * n_tiles_x + tx] = true;
+                    }
+                }
             }
         }
-        vertex_buf_mem->flush();
+
+        std::vector<size_t> tile_indices;
+        for (size_t i = 0; i < used.size(); i++)
+        {
+            if (used[i])
+            {
+                tile_indices.push_back(i);
+            }
+        }
+        return tile_indices;
     }
 
-    bool GridWarper::optimize_transform(
-        uint32_t hash_index,
-        const Transform2d& base_transform,
-        float scale_jitter,
-        float rotation_jitter,
-        float offset_jitter,
+    CostInfo GridWarper::evaluate(
         const bv::QueuePtr& queue,
-        Transform2d& out_jittered_transform
+        bool update_difference_img
     )
     {
-        // generate random values
-        constexpr uint32_t N_RAND = 4;
-        float rand[N_RAND];
-        for (uint32_t i = 0; i < N_RAND; i++)
+        drain_pipeline();
+        bake_grid_transform();
+
+        auto& cmd_buf =
+            (update_difference_img ? eval_cmd_buf : eval_fused_cmd_buf);
+        queue->submit({}, {}, { cmd_buf }, {}, eval_fence);
+        eval_fence->wait();
+        eval_fence->reset();
+
+        // the cost pass reads the difference image instead of calculating the
+        // difference values on the fly, so the partial sums might be slightly
+        // different from what the fused cost pass would write. don't mix them.
+        dirty_rect_state_valid = !update_difference_img;
+        pending_dirty_rect = std::nullopt;
+
+        if (update_difference_img)
         {
-            rand[i] = hash_f32(
-                rng_seed,
-                hash_index * N_RAND + i
+            return *cost_info_buf_mapped;
+        }
+
+        // the fused version also reads back the whole cost image, see
+        // create_cmd_bufs(). use the same tree evaluate_dirty_rect() does so
+        // the cost values are comparable.
+        cost_cache_tree.build(cost_cache_buf_mapped);
+        return cost_info_from_cache();
+    }
+
+    CostInfo GridWarper::cost_info_from_cache() const
+    {
+        return cost_info_from_tree(cost_cache_tree);
+    }
+
+    CostInfo GridWarper::cost_info_from_tree(const SumMaxTree& tree) const
+    {
+        double avg_diff = tree.sum() / (double)tree.size();
+        return CostInfo{
+            .avg_diff = (float)avg_diff,
+            .max_local_diff = tree.max()
+        };
+    }
+
+    CostInfo GridWarper::evaluate_dirty_rect(
+        VkRect2D dirty_rect,
+        const bv::QueuePtr& queue
+    )
+    {
+        if (!dirty_rect_state_valid)
+        {
+            throw std::logic_error(
+                "can't evaluate a dirty rectangle without a valid previous "
+                "evaluation"
             );
         }
 
-        // keep track of the cost
-        if (!last_avg_diff || !initial_max_local_diff)
+        // we also need to render over the last rejected displacement
+        if (pending_dirty_rect)
         {
-            auto cost_info = run_difference_and_cost_pass(queue);
-            last_avg_diff = cost_info.avg_diff;
-            initial_max_local_diff = cost_info.max_local_diff;
+            if (dirty_rect.extent.width == 0 || dirty_rect.extent.height == 0)
+            {
+                dirty_rect = *pending_dirty_rect;
+            }
+            else
+            {
+                int32_t x0 = std::min(
+                    dirty_rect.offset.x,
+                    pending_dirty_rect->offset.x
+                );
+                int32_t y0 = std::min(
+                    dirty_rect.offset.y,
+                    pending_dirty_rect->offset.y
+                );
+                int32_t x1 = std::max(
+                    dirty_rect.offset.x + (int32_t)dirty_rect.extent.width,
+                    pending_dirty_rect->offset.x
+                    + (int32_t)pending_dirty_rect->extent.width
+                );
+                int32_t y1 = std::max(
+                    dirty_rect.offset.y + (int32_t)dirty_rect.extent.height,
+                    pending_dirty_rect->offset.y
+                    + (int32_t)pending_dirty_rect->extent.height
+                );
+                dirty_rect = VkRect2D{
+                    .offset = { x0, y0 },
+                    .extent = { (uint32_t)(x1 - x0), (uint32_t)(y1 - y0) }
+                };
+            }
+            pending_dirty_rect = std::nullopt;
         }
-        float old_avg_diff = *last_avg_diff;
 
-        // make a copy of the vertices in case we decide to undo the
-        // displacement
-        make_copy_of_vertices();
+        // nothing changed
+        if (dirty_rect.extent.width == 0 || dirty_rect.extent.height == 0)
+        {
+            return cost_info_from_cache();
+        }
 
-        // generate a new jittered grid transform within the specified ranges
+        // cost pixels whose footprint overlaps the dirty rectangle. the cost
+        // pass also fetches the pixel right after the footprint (with a weight
+        // of 0) so we go one pixel further on both sides to be safe.
+        double scale_x = (double)intermediate_res_x / (double)cost_res_x;
+        double scale_y = (double)intermediate_res_y / (double)cost_res_y;
 
-        Transform2d jittered_transform = base_transform;
+        int32_t cost_x0 = std::max(
+            (int32_t)std::floor((double)dirty_rect.offset.x / scale_x) - 1,
+            0
+        );
+        int32_t cost_y0 = std::max(
+            (int32_t)std::floor((double)dirty_rect.offset.y / scale_y) - 1,
+            0
+        );
+        int32_t cost_x1 = std::min(
+            (int32_t)std::ceil(
+                (double)(dirty_rect.offset.x + dirty_rect.extent.width)
+                / scale_x
+            ) + 1,
+            (int32_t)cost_res_x
+        );
+        int32_t cost_y1 = std::min(
+            (int32_t)std::ceil(
+                (double)(dirty_rect.offset.y + dirty_rect.extent.height)
+                / scale_y
+            ) + 1,
+            (int32_t)cost_res_y
+        );
 
-        float scale_jitter_log = std::log(scale_jitter);
-        jittered_transform.scale *= std::exp(
-            (rand[0] * 2.f - 1.f) * scale_jitter_log
+        VkRect2D cost_region{
+            .offset = { cost_x0, cost_y0 },
+            .extent = {
+                (uint32_t)(cost_x1 - cost_x0),
+                (uint32_t)(cost_y1 - cost_y0)
+            }
+        };
+
+        // record
+        dirty_cmd_buf->reset(0);
+        dirty_cmd_buf->begin(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+
+        // the previous submission might still be reading warped_img, the
+        // partial sums, or the cost image.
+        memory_barrier(
+            dirty_cmd_buf,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT
+            | VK_PIPELINE_STAGE_TRANSFER_BIT,
+            VK_ACCESS_SHADER_WRITE_BIT,
+            VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT
+            | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            VK_ACCESS_SHADER_WRITE_BIT
         );
 
-        jittered_transform.rotation +=
-            (rand[1] * 2.f - 1.f) * rotation_jitter;
+        record_grid_warp_pass(
+            dirty_cmd_buf,
+            gwp_framebuf,
+            vertex_buf,
+            0,
+            dirty_rect
+        );
+        image_memory_barrier(
+            dirty_cmd_buf,
+            warped_img,
+            VK_IMAGE_LAYOUT_GENERAL,
+            VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+            VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            VK_ACCESS_SHADER_READ_BIT
+        );
 
-        jittered_transform.offset.x += (rand[2] * 2.f - 1.f) * offset_jitter;
-        jittered_transform.offset.y += (rand[3] * 2.f - 1.f) * offset_jitter;
+        record_cost_pass(dirty_cmd_buf, true, fcp_descriptor_set, cost_region);
+        record_partial_sums_barrier(dirty_cmd_buf);
+        record_cost_reduction_pass(
+            dirty_cmd_buf,
+            crp_descriptor_set,
+            cost_region
+        );
+        record_cost_cache_readback(dirty_cmd_buf, cost_region);
 
-        // regenerate grid vertices with the jittered transform
-        regenerate_grid_vertices(jittered_transform);
+        dirty_cmd_buf->end();
 
-        // see if the displacement did any good (decreased the cost)
-        run_grid_warp_pass(false, queue);
-        auto new_cost_info = run_difference_and_cost_pass(queue);
+        // submit and wait
+        queue->submit({}, {}, { dirty_cmd_buf }, {}, eval_fence);
+        eval_fence->wait();
+        eval_fence->reset();
 
-        // undo the displacement (warping) if it wasn't good
-        if (new_cost_info.avg_diff > old_avg_diff
-            || new_cost_info.max_local_diff > *initial_max_local_diff)
+        // update the tree with the new cost pixels
+        for (uint32_t y = 0; y < cost_region.extent.height; y++)
         {
-            restore_copy_of_vertices();
-            return false;
+            for (uint32_t x = 0; x < cost_region.extent.width; x++)
+            {
+                size_t idx =
+                    (size_t)(cost_region.offset.x + x)
+                    + (size_t)(cost_region.offset.y + y) * cost_res_x;
+                cost_cache_tree.set(idx, cost_cache_buf_mapped[idx]);
+            }
         }
-        else
+
+        return cost_info_from_cache();
+    }
+
+    void GridWarper::add_images_to_ui_pass(UiPass& ui_pass)
+    {
+        ui_pass.add_image(
+            warped_imgview,
+            VK_IMAGE_LAYOUT_GENERAL,
+            WARPED_IMAGE_NAME,
+            warped_img->config().extent.width,
+            warped_img->config().extent.height,
+            1.f,
+            luminance
+        );
+
+        if (warped_hires_img)
         {
-            last_avg_diff = new_cost_info.avg_diff;
-            out_jittered_transform = jittered_transform;
+            ui_pass.add_image(
+                warped_hires_imgview,
+                VK_IMAGE_LAYOUT_GENERAL,
+                WARPED_HIRES_IMAGE_NAME,
+                warped_hires_img->config().extent.width,
+                warped_hires_img->config().extent.height,
+                1.f,
+                false
+            );
         }
-        return true;
+
+        ui_pass.add_image(
+            difference_imgview,
+            VK_IMAGE_LAYOUT_GENERAL,
+            DIFFERENCE_IMAGE_NAME,
+            difference_img->config().extent.width,
+            difference_img->config().extent.height,
+            1.f,
+            true
+        );
+
+        ui_pass.add_image(
+            cost_imgview,
+            VK_IMAGE_LAYOUT_GENERAL,
+            COST_IMAGE_NAME,
+            cost_img->config().extent.width,
+            cost_img->config().extent.height,
+            1.f,
+            true
+        );
     }
 
-    bool GridWarper::optimize_warp(
+    void GridWarper::regenerate_grid_vertices(const Transform2d& grid_transform)
+    {
+        current_grid_transform = grid_transform;
+        grid_transform_baked = true;
+        generate_grid_vertices(grid_transform);
+    }
+
+    void GridWarper::generate_grid_vertices(const Transform2d& grid_transform)
+    {
+        drain_pipeline();
+        dirty_rect_state_valid = false;
+
+        glm::vec2 interm_res{ intermediate_res_x, intermediate_res_y };
+        float interm_res_area_sqrt = std::sqrt(
+            interm_res.x * interm_res.y
+        );
+
+        bool no_transform = grid_transform.is_identity();
+
+        // the original positions never change, only the warped positions
+        // need to be written.
+        for (uint32_t i = 0; i < n_vertices; i++)
+        {
+            const auto& p = orig_positions[i];
+
+            if (no_transform)
+            {
+                vertex_buf_mapped[i] = p;
+                continue;
+            }
+
+            // before applying the transform, we should convert to a
+            // zero-centered and aspect-ratio-adjusted UV space.
+            glm::vec2 uv = p * 2.f - 1.f; // zero-centered
+            uv = uv * interm_res / interm_res_area_sqrt; // aspect ratio
+
+            // apply the transform in UV space
+            uv = grid_transform.apply(uv);
+
+            // go back to normalized space
+            vertex_buf_mapped[i] =
+                (uv * interm_res_area_sqrt / interm_res)
+                * .5f + .5f;
+        }
+        vertex_buf_mem->flush();
+
+        // the transform is affine so three vertices are enough to find the
+        // basis
+        uint32_t stride_y = padded_grid_res_x + 1;
+        grid_basis.origin = vertex_buf_mapped[0] * interm_res;
+        grid_basis.step_x =
+            vertex_buf_mapped[1] * interm_res - grid_basis.origin;
+        grid_basis.step_y =
+            vertex_buf_mapped[stride_y] * interm_res - grid_basis.origin;
+        grid_basis.max_vertex_offset = 0.f;
+    }
+
+    void GridWarper::get_vertices(std::vector<GridVertex>& out_vertices) const
+    {
+        out_vertices.resize(n_vertices);
+        for (uint32_t i = 0; i < n_vertices; i++)
+        {
+            out_vertices[i] = GridVertex{
+                .warped_pos = vertex_buf_mapped[i],
+                .orig_pos = orig_positions[i]
+            };
+        }
+    }
+
+    bool GridWarper::optimize_transform(
         uint32_t hash_index,
-        float warp_strength,
-        const bv::QueuePtr& queue
+        const Transform2d& base_transform,
+        float scale_jitter,
+        float rotation_jitter,
+        float offset_jitter,
+        const bv::QueuePtr& queue,
+        Transform2d& out_jittered_transform
     )
     {
         // generate random values
-        constexpr uint32_t N_RAND = 5;
+        constexpr uint32_t N_RAND = 4;
         float rand[N_RAND];
         for (uint32_t i = 0; i < N_RAND; i++)
         {
@@ -489,90 +1187,192 @@ namespace img_aligner::grid_warp
         // keep track of the cost
         if (!last_avg_diff || !initial_max_local_diff)
         {
-            auto cost_info = run_difference_and_cost_pass(queue);
+            auto cost_info = evaluate(queue, false);
             last_avg_diff = cost_info.avg_diff;
             initial_max_local_diff = cost_info.max_local_diff;
         }
         float old_avg_diff = *last_avg_diff;
 
-        // make a copy of the vertices in case we decide to undo the
-        // displacement
-        make_copy_of_vertices();
-
-        // warp vertices based on an unnormalized gaussian distribution
+        // keep the untransformed grid in the vertex buffer until we're done
+        // with the transform, see evaluate_transformed().
+        if (grid_transform_baked)
+        {
+            generate_grid_vertices(Transform2d());
+            grid_transform_baked = false;
+        }
 
-        // gaussian center
-        glm::vec2 center{
-            rand[0] * (float)intermediate_res_x,
-            rand[1] * (float)intermediate_res_y
-        };
+        // generate a new jittered grid transform within the specified ranges
 
-        // radius = standard deviation
+        Transform2d jittered_transform = base_transform;
 
-        float min_radius = std::max(
-            (float)intermediate_res_x / (float)grid_res_x,
-            (float)intermediate_res_y / (float)grid_res_y
-        );
-        float max_radius = .5f * (float)std::max(
-            intermediate_res_x,
-            intermediate_res_y
+        float scale_jitter_log = std::log(scale_jitter);
+        jittered_transform.scale *= std::exp(
+            (rand[0] * 2.f - 1.f) * scale_jitter_log
         );
 
-        float log_min_radius = std::log(min_radius);
-        float log_max_radius = std::log(max_radius);
+        jittered_transform.rotation +=
+            (rand[1] * 2.f - 1.f) * rotation_jitter;
 
-        float log_radius = lerp(
-            log_min_radius,
-            log_max_radius,
-            rand[2]
+        jittered_transform.offset.x += (rand[2] * 2.f - 1.f) * offset_jitter;
+        jittered_transform.offset.y += (rand[3] * 2.f - 1.f) * offset_jitter;
+
+        // see if the jittered transform did any good (decreased the cost)
+        auto new_cost_info = evaluate_transformed(
+            calc_gwp_vert_push_constants(jittered_transform),
+            queue
         );
-        float radius = std::exp(log_radius);
 
-        // strength
-        float strength = (warp_strength * rand[3]) * radius;
+        // throw it away if it wasn't good
+        if (new_cost_info.avg_diff > old_avg_diff
+            || new_cost_info.max_local_diff > *initial_max_local_diff)
+        {
+            return false;
+        }
+        else
+        {
+            last_avg_diff = new_cost_info.avg_diff;
+            current_grid_transform = jittered_transform;
+            out_jittered_transform = jittered_transform;
+        }
+        return true;
+    }
 
-        // direction
-        float angle = glm::tau<float>() * rand[4];
-        glm::vec2 direction{ std::cos(angle), std::sin(angle) };
+    void GridWarper::bake_grid_transform()
+    {
+        if (grid_transform_baked)
+        {
+            return;
+        }
+        generate_grid_vertices(current_grid_transform);
+        grid_transform_baked = true;
+    }
 
-        // move vertices
-        uint32_t stride_y = padded_grid_res_x + 1;
-        for (uint32_t y = 0; y < padded_grid_res_y; y++)
+    GridWarpPassVertPushConstants GridWarper::calc_gwp_vert_push_constants(
+        const Transform2d& grid_transform
+    ) const
+    {
+        if (grid_transform.is_identity())
         {
-            for (uint32_t x = 0; x < padded_grid_res_x; x++)
-            {
-                auto& vert = vertex_buf_mapped[x + y * stride_y];
+            return GridWarpPassVertPushConstants{};
+        }
 
-                // position in pixel space
-                auto pos = vert.warped_pos * glm::vec2{
-                    (float)intermediate_res_x,
-                    (float)intermediate_res_y
-                };
+        // generate_grid_vertices() goes to a zero-centered and
+        // aspect-ratio-adjusted UV space, applies the transform, and comes
+        // back. with D being the aspect ratio scale, that's
+        // p' = .5 * D^-1 * (A * D * (2p - 1) + offset) + .5 which we write as
+        // M * p + b.
+        glm::vec2 interm_res{ intermediate_res_x, intermediate_res_y };
+        glm::vec2 aspect = interm_res / std::sqrt(interm_res.x * interm_res.y);
 
-                // displace (warp)
-                float displacement = strength * unnormalized_gaussian(
-                    radius,
-                    glm::distance(pos, center)
-                );
-                pos += displacement * direction;
+        glm::mat2 d{ aspect.x, 0.f, 0.f, aspect.y };
+        glm::mat2 d_inv{ 1.f / aspect.x, 0.f, 0.f, 1.f / aspect.y };
+        glm::mat2 m = d_inv * grid_transform.linear_part() * d;
 
-                // convert from pixel space back to normalized space
-                vert.warped_pos = pos / glm::vec2{
-                    (float)intermediate_res_x,
-                    (float)intermediate_res_y
-                };
-            }
+        return GridWarpPassVertPushConstants{
+            .transform_mat = m,
+            .transform_offset =
+                .5f * (glm::vec2(1.f) - m * glm::vec2(1.f))
+                + .5f * (grid_transform.offset / aspect)
+        };
+    }
+
+    CostInfo GridWarper::evaluate_transformed(
+        const GridWarpPassVertPushConstants& gwp_vert_push_constants,
+        const bv::QueuePtr& queue
+    )
+    {
+        drain_pipeline();
+
+        dirty_cmd_buf->reset(0);
+        dirty_cmd_buf->begin(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+
+        // the previous submission might still be reading warped_img, the
+        // partial sums, or the cost image.
+        memory_barrier(
+            dirty_cmd_buf,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT
+            | VK_PIPELINE_STAGE_TRANSFER_BIT,
+            VK_ACCESS_SHADER_WRITE_BIT,
+            VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT
+            | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            VK_ACCESS_SHADER_WRITE_BIT
+        );
+
+        record_evaluation(
+            dirty_cmd_buf,
+            vertex_buf,
+            cip_descriptor_set,
+            false,
+            gwp_vert_push_constants
+        );
+        record_cost_cache_readback(dirty_cmd_buf);
+
+        dirty_cmd_buf->end();
+
+        queue->submit({}, {}, { dirty_cmd_buf }, {}, eval_fence);
+        eval_fence->wait();
+        eval_fence->reset();
+
+        // the images don't match the vertex buffer
+        dirty_rect_state_valid = false;
+        pending_dirty_rect = std::nullopt;
+
+        cost_cache_tree.build(cost_cache_buf_mapped);
+        return cost_info_from_cache();
+    }
+
+    bool GridWarper::optimize_warp(
+        uint32_t hash_index,
+        float warp_strength,
+        const bv::QueuePtr& queue
+    )
+    {
+        bake_grid_transform();
+
+        // keep track of the cost
+        if (!last_avg_diff || !initial_max_local_diff)
+        {
+            auto cost_info = evaluate(queue, false);
+            last_avg_diff = cost_info.avg_diff;
+            initial_max_local_diff = cost_info.max_local_diff;
         }
+        float old_avg_diff = *last_avg_diff;
+
+        // warp vertices based on an unnormalized gaussian distribution and
+        // keep the previous positions in case we decide to undo it
+        VkRect2D dirty_rect{};
+        undo_journal.clear();
+        displace_vertices(
+            vertex_buf_mapped,
+            hash_index,
+            warp_strength,
+            &dirty_rect,
+            &undo_journal
+        );
 
-        // see if the displacement did any good (decreased the cost)
-        run_grid_warp_pass(false, queue);
-        auto new_cost_info = run_difference_and_cost_pass(queue);
+        // see if the displacement did any good (decreased the cost). if the
+        // images are still valid from the previous iteration, we only need to
+        // update the area affected by the displacement.
+        CostInfo new_cost_info;
+        if (dirty_rect_state_valid)
+        {
+            new_cost_info = evaluate_dirty_rect(dirty_rect, queue);
+        }
+        else
+        {
+            new_cost_info = evaluate(queue, false);
+        }
 
         // undo the displacement (warping) if it wasn't good
         if (new_cost_info.avg_diff > old_avg_diff
             || new_cost_info.max_local_diff > *initial_max_local_diff)
         {
-            restore_copy_of_vertices();
+            undo_displacement();
+
+            // the images still have the rejected displacement in the dirty
+            // rectangle, it will be rendered again in the next evaluation.
+            pending_dirty_rect = dirty_rect;
+
             return false;
         }
         else
@@ -582,401 +1382,2367 @@ namespace img_aligner::grid_warp
         return true;
     }
 
-    void GridWarper::create_vertex_and_index_buffer_and_generate_vertices(
-        const Transform2d& grid_transform,
+    bool GridWarper::optimize_warp_pipelined(
+        uint32_t hash_index,
+        const std::function<float(uint32_t)>& calc_warp_strength,
         const bv::QueuePtr& queue
     )
     {
-        // please keep in mind that the 2D resolution of the vertex array is
-        // (padded_grid_res_x + 1) by (padded_grid_res_y + 1) to account for
-        // vertices at the edges. for example, for a 2x2 grid we would need 3x3
-        // vertices.
-        n_vertices = (padded_grid_res_x + 1) * (padded_grid_res_y + 1);
-        uint32_t vertices_size_bytes = n_vertices * sizeof(GridVertex);
+        bake_grid_transform();
 
-        // create vertex buffer and map its memory
-        create_buffer(
-            state,
-            vertices_size_bytes,
-            VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+        if (pipeline_slots.size() < 2)
+        {
+            throw std::logic_error(
+                "pipelined optimization needs a pipeline depth of at least 2"
+            );
+        }
 
-            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT
-            | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        // keep track of the cost
+        if (!last_avg_diff || !initial_max_local_diff)
+        {
+            auto cost_info = evaluate(queue, false);
+            last_avg_diff = cost_info.avg_diff;
+            initial_max_local_diff = cost_info.max_local_diff;
+        }
 
-            vertex_buf,
-            vertex_buf_mem
-        );
-        vertex_buf_mapped = (GridVertex*)vertex_buf_mem->mapped();
+        // the oldest candidate in flight must be the one for hash_index. if it
+        // isn't (the caller skipped or repeated an index), start over.
+        if (!pipeline_in_flight.empty()
+            && pipeline_slots[pipeline_in_flight.front()].hash_index
+            != hash_index)
+        {
+            drain_pipeline();
+        }
 
-        // create index buffer and upload triangle indices
+        // keep the pipeline full. the candidates are built against the
+        // currently accepted vertices while the GPU works on the older ones.
+        while (!pipeline_free_slots.empty())
         {
-            uint32_t n_cells = padded_grid_res_x * padded_grid_res_y;
-            uint32_t n_triangles = n_cells * 2;
-            n_triangle_vertices = n_triangles * 3;
+            uint32_t next_hash_index =
+                pipeline_in_flight.empty()
+                ? hash_index
+                : pipeline_slots[pipeline_in_flight.back()].hash_index + 1;
+
+            submit_pipeline_candidate(
+                next_hash_index,
+                calc_warp_strength(next_hash_index),
+                queue
+            );
+        }
 
-            std::vector<uint32_t> indices;
-            indices.reserve(n_triangle_vertices);
-            for (uint32_t y = 0; y < padded_grid_res_y; y++)
-            {
-                for (uint32_t x = 0; x < padded_grid_res_x; x++)
-                {
-                    // index of bottom left, bottom right, top left and top
-                    // right vertices
-                    uint32_t bl_idx = INDEX_2D(x, y, padded_grid_res_x + 1);
-                    uint32_t br_idx = INDEX_2D(x + 1, y, padded_grid_res_x + 1);
-                    uint32_t tl_idx = INDEX_2D(x, y + 1, padded_grid_res_x + 1);
-                    uint32_t tr_idx =
-                        INDEX_2D(x + 1, y + 1, padded_grid_res_x + 1);
+        // wait for the oldest candidate
+        uint32_t slot_idx = pipeline_in_flight.front();
+        pipeline_in_flight.pop_front();
+        pipeline_free_slots.push_back(slot_idx);
+
+        auto& slot = pipeline_slots[slot_idx];
+        slot.fence->wait();
+        slot.fence->reset();
+
+        // throw it away if it wasn't good. the accepted vertices haven't
+        // changed so the other candidates in flight are still valid. the cost
+        // values come from a tree like in optimize_warp() and not from the
+        // cost info pass, which sums in a different order.
+        pipeline_cost_tree.build(slot.cost_cache_buf_mapped);
+        auto new_cost_info = cost_info_from_tree(pipeline_cost_tree);
+        if (new_cost_info.avg_diff > *last_avg_diff
+            || new_cost_info.max_local_diff > *initial_max_local_diff)
+        {
+            return false;
+        }
 
-                    // push 2 triangles that fill the quad which is the current
-                    // cell
+        // accept the candidate
+        last_avg_diff = new_cost_info.avg_diff;
+        std::swap(cost_cache_tree, pipeline_cost_tree);
+        std::copy(
+            slot.vertex_buf_mapped,
+            slot.vertex_buf_mapped + n_vertices,
+            vertex_buf_mapped
+        );
 
-                    indices.push_back(bl_idx);
-                    indices.push_back(br_idx);
-                    indices.push_back(tr_idx);
+        // the remaining candidates were built on top of the old vertices, so
+        // rebuild and resubmit them with the same hash indices.
+        std::vector<uint32_t> stale_hash_indices;
+        for (auto idx : pipeline_in_flight)
+        {
+            stale_hash_indices.push_back(pipeline_slots[idx].hash_index);
+        }
+        drain_pipeline();
+        for (auto idx : stale_hash_indices)
+        {
+            submit_pipeline_candidate(idx, calc_warp_strength(idx), queue);
+        }
 
-                    indices.push_back(bl_idx);
-                    indices.push_back(tr_idx);
-                    indices.push_back(tl_idx);
-                }
-            }
+        return true;
+    }
 
-            VkDeviceSize indices_size_bytes =
-                sizeof(indices[0]) * indices.size();
+    void GridWarper::drain_pipeline()
+    {
+        while (!pipeline_in_flight.empty())
+        {
+            uint32_t slot_idx = pipeline_in_flight.front();
+            pipeline_in_flight.pop_front();
+            pipeline_free_slots.push_back(slot_idx);
 
-            bv::BufferPtr staging_buf;
-            bv::MemoryChunkPtr staging_buf_mem;
-            create_buffer(
-                state,
-                indices_size_bytes,
-                VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+            pipeline_slots[slot_idx].fence->wait();
+            pipeline_slots[slot_idx].fence->reset();
+        }
+    }
 
-                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT
-                | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+    bool GridWarper::optimize_warp_batched(
+        uint32_t hash_index,
+        const std::function<float(uint32_t)>& calc_warp_strength,
+        const bv::QueuePtr& queue
+    )
+    {
+        bake_grid_transform();
 
-                staging_buf,
-                staging_buf_mem
+        if (batch_size < 2)
+        {
+            throw std::logic_error(
+                "batched optimization needs a batch size of at least 2"
             );
+        }
+
+        // keep track of the cost
+        if (!last_avg_diff || !initial_max_local_diff)
+        {
+            auto cost_info = evaluate(queue, false);
+            last_avg_diff = cost_info.avg_diff;
+            initial_max_local_diff = cost_info.max_local_diff;
+        }
+        drain_pipeline();
 
-            void* mapped = staging_buf_mem->mapped();
+        // every candidate starts from the current vertices
+        for (uint32_t i = 0; i < batch_size; i++)
+        {
+            glm::vec2* warped_positions =
+                batch_vertex_buf_mapped + i * n_vertices;
             std::copy(
-                indices.data(),
-                indices.data() + indices.size(),
-                (uint32_t*)mapped
+                vertex_buf_mapped,
+                vertex_buf_mapped + n_vertices,
+                warped_positions
             );
-            staging_buf_mem->flush();
-
-            create_buffer(
-                state,
-                indices_size_bytes,
+            displace_vertices(
+                warped_positions,
+                hash_index + i,
+                calc_warp_strength(hash_index + i)
+            );
+        }
 
-                VK_BUFFER_USAGE_TRANSFER_DST_BIT
-                | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+        queue->submit({}, {}, { batch_cmd_buf }, {}, batch_fence);
+        batch_fence->wait();
+        batch_fence->reset();
 
-                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-                index_buf,
-                index_buf_mem
+        // find the best candidate that didn't make things worse. the cost
+        // values come from trees like in optimize_warp() and not from the cost
+        // info pass, which sums in a different order.
+        std::optional<uint32_t> best_idx;
+        float best_avg_diff = 0.f;
+        for (uint32_t i = 0; i < batch_size; i++)
+        {
+            batch_cost_trees[i].build(
+                batch_cost_cache_buf_mapped
+                + ((size_t)i * cost_res_x * cost_res_y)
             );
+            auto cost_info = cost_info_from_tree(batch_cost_trees[i]);
+            if (cost_info.avg_diff > *last_avg_diff
+                || cost_info.max_local_diff > *initial_max_local_diff)
+            {
+                continue;
+            }
+            if (!best_idx || cost_info.avg_diff < best_avg_diff)
+            {
+                best_idx = i;
+                best_avg_diff = cost_info.avg_diff;
+            }
+        }
 
-            auto cmd_buf = begin_single_time_commands(state, true);
-            copy_buffer(cmd_buf, staging_buf, index_buf, indices_size_bytes);
-            end_single_time_commands(cmd_buf, queue);
-
-            staging_buf = nullptr;
-            staging_buf_mem = nullptr;
+        if (!best_idx)
+        {
+            return false;
         }
 
-        regenerate_grid_vertices(grid_transform);
+        const glm::vec2* best_warped_positions =
+            batch_vertex_buf_mapped + *best_idx * n_vertices;
+        std::copy(
+            best_warped_positions,
+            best_warped_positions + n_vertices,
+            vertex_buf_mapped
+        );
+        last_avg_diff = best_avg_diff;
+        std::swap(cost_cache_tree, batch_cost_trees[*best_idx]);
+
+        // the tree matches the new vertices but the images don't, so the
+        // next evaluation has to be a full one
+        dirty_rect_state_valid = false;
+        return true;
     }
 
-    void GridWarper::create_sampler_and_images(const bv::QueuePtr& queue)
+    uint32_t GridWarper::optimize_warp_resident(
+        uint32_t hash_index,
+        const std::function<float(uint32_t)>& calc_warp_strength,
+        const bv::QueuePtr& queue,
+        std::vector<float>& out_cost_history
+    )
     {
-        // create sampler
-        sampler = bv::Sampler::create(
-            state.device,
-            {
-                .flags = 0,
-                .mag_filter = VK_FILTER_LINEAR,
-                .min_filter = VK_FILTER_LINEAR,
-                .mipmap_mode = VK_SAMPLER_MIPMAP_MODE_NEAREST,
-                .address_mode_u = VK_SAMPLER_ADDRESS_MODE_MIRRORED_REPEAT,
-                .address_mode_v = VK_SAMPLER_ADDRESS_MODE_MIRRORED_REPEAT,
-                .address_mode_w = VK_SAMPLER_ADDRESS_MODE_MIRRORED_REPEAT,
-                .mip_lod_bias = 0.,
-                .anisotropy_enable = false,
-                .max_anisotropy = 0.,
-                .compare_enable = false,
-                .compare_op = VK_COMPARE_OP_ALWAYS,
-                .min_lod = 0.,
-                .max_lod = VK_LOD_CLAMP_NONE,
-                .border_color = VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE,
-                .unnormalized_coordinates = false
-            }
-        );
+        bake_grid_transform();
 
-        // command buffer for image layout transitions
-        auto cmd_buf = begin_single_time_commands(state, true);
+        if (resident_iters < 2)
+        {
+            throw std::logic_error(
+                "resident optimization needs at least 2 resident iterations"
+            );
+        }
 
-        // create images and image views, and transition layouts
+        // keep track of the cost
+        if (!last_avg_diff || !initial_max_local_diff)
+        {
+            auto cost_info = evaluate(queue, false);
+            last_avg_diff = cost_info.avg_diff;
+            initial_max_local_diff = cost_info.max_local_diff;
+        }
+        drain_pipeline();
 
-        // warped image uses the intermediate resolution.
-        create_image(
-            state,
-            intermediate_res_x,
-            intermediate_res_y,
-            1,
-            VK_SAMPLE_COUNT_1_BIT,
-            VK_FORMAT_R32G32B32A32_SFLOAT,
-            VK_IMAGE_TILING_OPTIMAL,
-            VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
-            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-            warped_img,
-            warped_img_mem
-        );
-        warped_imgview = create_image_view(
-            state,
-            warped_img,
-            VK_FORMAT_R32G32B32A32_SFLOAT,
-            VK_IMAGE_ASPECT_COLOR_BIT,
-            1
-        );
-        transition_image_layout(
-            cmd_buf,
-            warped_img,
-            VK_IMAGE_LAYOUT_UNDEFINED,
-            VK_IMAGE_LAYOUT_GENERAL,
-            1
-        );
+        // generate the displacements up front, they don't depend on the
+        // vertices
+        for (uint32_t i = 0; i < resident_iters; i++)
+        {
+            resident_warp_buf_mapped[i] = gen_warp_params(
+                hash_index + i,
+                calc_warp_strength(hash_index + i)
+            );
+        }
 
-        // high-resolution warped image uses the original resolution
-        create_image(
-            state,
-            img_width,
-            img_height,
-            1,
-            VK_SAMPLE_COUNT_1_BIT,
-            VK_FORMAT_R32G32B32A32_SFLOAT,
-            VK_IMAGE_TILING_OPTIMAL,
+        // last_avg_diff is overwritten with the cost of the current vertices
+        // from the cost info pass at the start of the submission, see
+        // create_resident_resources().
+        *resident_state_buf_mapped = ResidentState{
+            .last_avg_diff = *last_avg_diff,
+            .max_local_diff_limit = *initial_max_local_diff,
+            .accepted = 0,
+            .n_accepted = 0
+        };
 
-            VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT
-            | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+        queue->submit({}, {}, { resident_cmd_buf }, {}, resident_fence);
+        resident_fence->wait();
+        resident_fence->reset();
 
-            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-            warped_hires_img,
-            warped_hires_img_mem
-        );
-        warped_hires_imgview = create_image_view(
-            state,
-            warped_hires_img,
-            VK_FORMAT_R32G32B32A32_SFLOAT,
-            VK_IMAGE_ASPECT_COLOR_BIT,
-            1
-        );
-        transition_image_layout(
-            cmd_buf,
-            warped_hires_img,
-            VK_IMAGE_LAYOUT_UNDEFINED,
-            VK_IMAGE_LAYOUT_GENERAL,
-            1
+        // warped_img and the cost image have the last candidate now
+        dirty_rect_state_valid = false;
+
+        out_cost_history.assign(
+            resident_history_buf_mapped,
+            resident_history_buf_mapped + resident_iters
         );
 
-        // difference image uses the intermediate resolution
-        create_image(
-            state,
-            intermediate_res_x,
-            intermediate_res_y,
-            1,
-            VK_SAMPLE_COUNT_1_BIT,
-            VK_FORMAT_R32_SFLOAT,
-            VK_IMAGE_TILING_OPTIMAL,
+        auto result = *resident_state_buf_mapped;
+        last_avg_diff = result.last_avg_diff;
+        if (result.n_accepted > 0)
+        {
+            update_max_vertex_offset();
+        }
+        return result.n_accepted;
+    }
 
-            VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+    WarpParams GridWarper::gen_warp_params(
+        uint32_t hash_index,
+        float warp_strength
+    ) const
+    {
+        // generate random values
+        constexpr uint32_t N_RAND = 5;
+        float rand[N_RAND];
+        for (uint32_t i = 0; i < N_RAND; i++)
+        {
+            rand[i] = hash_f32(
+                rng_seed,
+                hash_index * N_RAND + i
+            );
+        }
 
-            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-            difference_img,
-            difference_img_mem
+        // gaussian center
+        glm::vec2 center{
+            rand[0] * (float)intermediate_res_x,
+            rand[1] * (float)intermediate_res_y
+        };
+
+        // radius = standard deviation
+
+        float min_radius = std::max(
+            (float)intermediate_res_x / (float)grid_res_x,
+            (float)intermediate_res_y / (float)grid_res_y
         );
-        difference_imgview = create_image_view(
-            state,
-            difference_img,
-            VK_FORMAT_R32_SFLOAT,
-            VK_IMAGE_ASPECT_COLOR_BIT,
-            1
+        float max_radius = .5f * (float)std::max(
+            intermediate_res_x,
+            intermediate_res_y
         );
-        transition_image_layout(
-            cmd_buf,
-            difference_img,
-            VK_IMAGE_LAYOUT_UNDEFINED,
-            VK_IMAGE_LAYOUT_GENERAL,
-            1
+
+        float log_min_radius = std::log(min_radius);
+        float log_max_radius = std::log(max_radius);
+
+        float log_radius = lerp(
+            log_min_radius,
+            log_max_radius,
+            rand[2]
         );
+        float radius = std::exp(log_radius);
 
-        // cost image uses the cost resolution and a host-visible memory chunk
-        create_image(
-            state,
-            cost_res_x,
-            cost_res_y,
-            1,
-            VK_SAMPLE_COUNT_1_BIT,
-            VK_FORMAT_R32_SFLOAT,
-            VK_IMAGE_TILING_OPTIMAL,
+        // strength
+        float strength = (warp_strength * rand[3]) * radius;
 
-            VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT
-            | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+        // direction
+        float angle = glm::tau<float>() * rand[4];
+        glm::vec2 direction{ std::cos(angle), std::sin(angle) };
 
-            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-            cost_img,
-            cost_img_mem
+        return WarpParams{
+            .center = center,
+            .direction = direction,
+            .radius = radius,
+            .strength = strength
+        };
+    }
+
+    void GridWarper::displace_vertices(
+        glm::vec2* warped_positions,
+        uint32_t hash_index,
+        float warp_strength,
+        VkRect2D* out_dirty_rect,
+        std::vector<VertexUndoEntry>* out_undo_journal
+    )
+    {
+        auto warp = gen_warp_params(hash_index, warp_strength);
+        const auto& center = warp.center;
+        const auto& direction = warp.direction;
+        float radius = warp.radius;
+        float strength = warp.strength;
+
+        // bounding box of the moved vertices in grid space and of their
+        // old and new positions in pixel space
+        uint32_t moved_x0 = std::numeric_limits<uint32_t>::max();
+        uint32_t moved_y0 = std::numeric_limits<uint32_t>::max();
+        uint32_t moved_x1 = 0;
+        uint32_t moved_y1 = 0;
+        glm::vec2 bbox_min{ std::numeric_limits<float>::infinity() };
+        glm::vec2 bbox_max{ -std::numeric_limits<float>::infinity() };
+
+        // window of vertices that might be displaced by at least
+        // MIN_VERTEX_DISPLACEMENT. the displacement is strength * exp(-d^2 /
+        // (2 * radius^2)) at distance d so we solve for d, then go back to
+        // grid space with the inverse of the grid basis.
+        uint32_t window_x0 = 0;
+        uint32_t window_y0 = 0;
+        uint32_t window_x1 = 0; // exclusive
+        uint32_t window_y1 = 0; // exclusive
+        if (std::abs(strength) >= MIN_VERTEX_DISPLACEMENT)
+        {
+            window_x1 = padded_grid_res_x;
+            window_y1 = padded_grid_res_y;
+
+            // the vertices might have moved away from where the basis says
+            // they should be, and we add a pixel for rounding errors.
+            float support =
+                radius * std::sqrt(
+                    2.f * std::log(std::abs(strength) / MIN_VERTEX_DISPLACEMENT)
+                )
+                + grid_basis.max_vertex_offset
+                + 1.f;
+
+            glm::mat2 basis{ grid_basis.step_x, grid_basis.step_y };
+            float det = glm::determinant(basis);
+            if (std::abs(det) > 1e-6f)
+            {
+                glm::mat2 inv_basis = glm::inverse(basis);
+
+                glm::vec2 grid_min{ std::numeric_limits<float>::infinity() };
+                glm::vec2 grid_max{ -std::numeric_limits<float>::infinity() };
+                for (auto corner : {
+                    glm::vec2{ -support, -support },
+                    glm::vec2{ support, -support },
+                    glm::vec2{ -support, support },
+                    glm::vec2{ support, support } })
+                {
+                    glm::vec2 grid_pos =
+                        inv_basis * (center + corner - grid_basis.origin);
+                    grid_min = glm::min(grid_min, grid_pos);
+                    grid_max = glm::max(grid_max, grid_pos);
+                }
+
+                window_x0 = (uint32_t)std::clamp(
+                    std::floor(grid_min.x),
+                    0.f,
+                    (float)padded_grid_res_x
+                );
+                window_y0 = (uint32_t)std::clamp(
+                    std::floor(grid_min.y),
+                    0.f,
+                    (float)padded_grid_res_y
+                );
+                window_x1 = (uint32_t)std::clamp(
+                    std::ceil(grid_max.x) + 1.f,
+                    0.f,
+                    (float)padded_grid_res_x
+                );
+                window_y1 = (uint32_t)std::clamp(
+                    std::ceil(grid_max.y) + 1.f,
+                    0.f,
+                    (float)padded_grid_res_y
+                );
+            }
+        }
+
+        // move vertices
+        uint32_t stride_y = padded_grid_res_x + 1;
+        for (uint32_t y = window_y0; y < window_y1; y++)
+        {
+            for (uint32_t x = window_x0; x < window_x1; x++)
+            {
+                auto& warped_pos = warped_positions[x + y * stride_y];
+
+                // position in pixel space
+                auto pos = warped_pos * glm::vec2{
+                    (float)intermediate_res_x,
+                    (float)intermediate_res_y
+                };
+
+                // displace (warp)
+                float displacement = strength * unnormalized_gaussian(
+                    radius,
+                    glm::distance(pos, center)
+                );
+                if (std::abs(displacement) < MIN_VERTEX_DISPLACEMENT)
+                {
+                    continue;
+                }
+
+                if (out_undo_journal)
+                {
+                    out_undo_journal->push_back(VertexUndoEntry{
+                        .idx = x + y * stride_y,
+                        .warped_pos = warped_pos
+                        });
+                }
+
+                bbox_min = glm::min(bbox_min, pos);
+                bbox_max = glm::max(bbox_max, pos);
+
+                pos += displacement * direction;
+
+                bbox_min = glm::min(bbox_min, pos);
+                bbox_max = glm::max(bbox_max, pos);
+
+                // keep the bound for the offset from the basis up to date
+                glm::vec2 base_pos =
+                    grid_basis.origin
+                    + (float)x * grid_basis.step_x
+                    + (float)y * grid_basis.step_y;
+                grid_basis.max_vertex_offset = std::max(
+                    grid_basis.max_vertex_offset,
+                    glm::distance(pos, base_pos)
+                );
+
+                moved_x0 = std::min(moved_x0, x);
+                moved_y0 = std::min(moved_y0, y);
+                moved_x1 = std::max(moved_x1, x);
+                moved_y1 = std::max(moved_y1, y);
+
+                // convert from pixel space back to normalized space
+                warped_pos = pos / glm::vec2{
+                    (float)intermediate_res_x,
+                    (float)intermediate_res_y
+                };
+            }
+        }
+
+        if (!out_dirty_rect)
+        {
+            return;
+        }
+
+        // nothing moved
+        if (moved_x0 > moved_x1)
+        {
+            *out_dirty_rect = VkRect2D{
+                .offset = { 0, 0 },
+                .extent = { 0, 0 }
+            };
+            return;
+        }
+
+        // the triangles that were affected also have the neighbors of the
+        // moved vertices as corners, which didn't move.
+        for (uint32_t y = (moved_y0 > 0 ? moved_y0 - 1 : 0);
+            y <= std::min(moved_y1 + 1, padded_grid_res_y);
+            y++)
+        {
+            for (uint32_t x = (moved_x0 > 0 ? moved_x0 - 1 : 0);
+                x <= std::min(moved_x1 + 1, padded_grid_res_x);
+                x++)
+            {
+                auto pos = warped_positions[x + y * stride_y] * glm::vec2{
+                    (float)intermediate_res_x,
+                    (float)intermediate_res_y
+                };
+                bbox_min = glm::min(bbox_min, pos);
+                bbox_max = glm::max(bbox_max, pos);
+            }
+        }
+
+        // pixels covered by the bounding box, plus one on every side to be
+        // safe.
+        int32_t x0 = std::clamp(
+            (int32_t)std::floor(bbox_min.x) - 1,
+            0,
+            (int32_t)intermediate_res_x
         );
-        cost_imgview = create_image_view(
-            state,
-            cost_img,
-            VK_FORMAT_R32_SFLOAT,
-            VK_IMAGE_ASPECT_COLOR_BIT,
-            1
+        int32_t y0 = std::clamp(
+            (int32_t)std::floor(bbox_min.y) - 1,
+            0,
+            (int32_t)intermediate_res_y
         );
-        transition_image_layout(
-            cmd_buf,
-            cost_img,
-            VK_IMAGE_LAYOUT_UNDEFINED,
-            VK_IMAGE_LAYOUT_GENERAL,
-            1
+        int32_t x1 = std::clamp(
+            (int32_t)std::ceil(bbox_max.x) + 1,
+            0,
+            (int32_t)intermediate_res_x
+        );
+        int32_t y1 = std::clamp(
+            (int32_t)std::ceil(bbox_max.y) + 1,
+            0,
+            (int32_t)intermediate_res_y
         );
 
-        // end, submit, and wait for the command buffer
-        end_single_time_commands(cmd_buf, queue);
+        *out_dirty_rect = VkRect2D{
+            .offset = { x0, y0 },
+            .extent = { (uint32_t)(x1 - x0), (uint32_t)(y1 - y0) }
+        };
+    }
+
+    void GridWarper::submit_pipeline_candidate(
+        uint32_t hash_index,
+        float warp_strength,
+        const bv::QueuePtr& queue
+    )
+    {
+        if (pipeline_free_slots.empty())
+        {
+            throw std::logic_error("no free slots in the pipeline");
+        }
+
+        uint32_t slot_idx = pipeline_free_slots.back();
+        pipeline_free_slots.pop_back();
+
+        auto& slot = pipeline_slots[slot_idx];
+        slot.hash_index = hash_index;
+
+        // start from the accepted vertices
+        std::copy(
+            vertex_buf_mapped,
+            vertex_buf_mapped + n_vertices,
+            slot.vertex_buf_mapped
+        );
+        displace_vertices(slot.vertex_buf_mapped, hash_index, warp_strength);
+
+        // the slots render to warped_img too
+        dirty_rect_state_valid = false;
+
+        queue->submit({}, {}, { slot.cmd_buf }, {}, slot.fence);
+        pipeline_in_flight.push_back(slot_idx);
+    }
+
+    void GridWarper::create_vertex_and_index_buffer_and_generate_vertices(
+        const Transform2d& grid_transform,
+        const bv::QueuePtr& queue
+    )
+    {
+        // please keep in mind that the 2D resolution of the vertex array is
+        // (padded_grid_res_x + 1) by (padded_grid_res_y + 1) to account for
+        // vertices at the edges. for example, for a 2x2 grid we would need 3x3
+        // vertices.
+        n_vertices = (padded_grid_res_x + 1) * (padded_grid_res_y + 1);
+        uint32_t positions_size_bytes = n_vertices * sizeof(glm::vec2);
 
-        // cost buffer
+        // create the vertex buffer for the warped positions and map its
+        // memory. it's also a storage buffer for the displacement pass.
         create_buffer(
             state,
-            cost_res_x * cost_res_y * sizeof(float),
-            VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+            positions_size_bytes,
+            VK_BUFFER_USAGE_VERTEX_BUFFER_BIT
+            | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
 
             VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT
             | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
 
-            cost_buf,
-            cost_buf_mem
+            vertex_buf,
+            vertex_buf_mem
         );
-        cost_buf_mapped = (float*)cost_buf_mem->mapped();
-    }
+        vertex_buf_mapped = (glm::vec2*)vertex_buf_mem->mapped();
 
-    void GridWarper::create_passes()
-    {
-        // shaders
+        // generate the original positions and upload them
+        {
+            float cell_width = 1.f / (float)grid_res_x;
+            float cell_height = 1.f / (float)grid_res_y;
 
-        bv::ShaderModulePtr fullscreen_quad_vert_shader_module = nullptr;
-        bv::ShaderStage fullscreen_quad_vert_shader_stage{};
+            int32_t horizontal_pad =
+                (int32_t)(padded_grid_res_x - grid_res_x) / 2;
+            int32_t vertical_pad =
+                (int32_t)(padded_grid_res_y - grid_res_y) / 2;
 
-        bv::ShaderModulePtr gwp_vert_shader_module = nullptr;
-        bv::ShaderStage gwp_vert_shader_stage{};
+            orig_positions.resize(n_vertices);
+            for (int32_t y = 0; y <= (int32_t)padded_grid_res_y; y++)
+            {
+                for (int32_t x = 0; x <= (int32_t)padded_grid_res_x; x++)
+                {
+                    // remove the offset caused by padding
+                    int32_t ax = x - horizontal_pad;
+                    int32_t ay = y - vertical_pad;
+
+                    ACCESS_2D(
+                        orig_positions.data(),
+                        x,
+                        y,
+                        padded_grid_res_x + 1
+                    ) = glm::vec2{
+                        (float)ax * cell_width,
+                        (float)ay * cell_height
+                    };
+                }
+            }
 
-        bv::ShaderModulePtr gwp_frag_shader_module = nullptr;
-        bv::ShaderStage gwp_frag_shader_stage{};
+            StagingAllocation staging =
+                state.staging_ring(queue, false).allocate(positions_size_bytes);
+            std::copy(
+                orig_positions.data(),
+                orig_positions.data() + orig_positions.size(),
+                (glm::vec2*)staging.mapped()
+            );
+            staging.flush();
 
-        bv::ShaderModulePtr dfp_frag_shader_module = nullptr;
-        bv::ShaderStage dfp_frag_shader_stage{};
+            create_buffer(
+                state,
+                positions_size_bytes,
 
-        bv::ShaderModulePtr csp_frag_shader_module = nullptr;
-        bv::ShaderStage csp_frag_shader_stage{};
+                VK_BUFFER_USAGE_TRANSFER_DST_BIT
+                | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
 
-        {
-            std::vector<uint8_t> shader_code = read_file(
-                exec_dir() / "shaders/fullscreen_quad_vert.spv"
-            );
-            fullscreen_quad_vert_shader_module = bv::ShaderModule::create(
-                state.device,
-                std::move(shader_code)
+                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                orig_pos_buf,
+                orig_pos_buf_mem
             );
-            fullscreen_quad_vert_shader_stage = bv::ShaderStage{
-                .flags = {},
-                .stage = VK_SHADER_STAGE_VERTEX_BIT,
-                .module = fullscreen_quad_vert_shader_module,
-                .entry_point = "main",
-                .specialization_info = std::nullopt
-            };
 
-            shader_code = read_file(
-                exec_dir() / "shaders/grid_warp_pass_vert.spv"
+            auto cmd_buf = begin_single_time_commands(state);
+            copy_buffer(
+                cmd_buf,
+                staging.buffer(),
+                orig_pos_buf,
+                positions_size_bytes,
+                staging.offset()
             );
-            gwp_vert_shader_module = bv::ShaderModule::create(
-                state.device,
-                std::move(shader_code)
+            end_single_time_commands(state, cmd_buf, queue);
+        }
+
+        // create index buffer and upload triangle indices
+        {
+            uint32_t n_cells = padded_grid_res_x * padded_grid_res_y;
+            uint32_t n_triangles = n_cells * 2;
+            n_triangle_vertices = n_triangles * 3;
+
+            std::vector<uint32_t> indices;
+            indices.reserve(n_triangle_vertices);
+            for (uint32_t y = 0; y < padded_grid_res_y; y++)
+            {
+                for (uint32_t x = 0; x < padded_grid_res_x; x++)
+                {
+                    // index of bottom left, bottom right, top left and top
+                    // right vertices
+                    uint32_t bl_idx = INDEX_2D(x, y, padded_grid_res_x + 1);
+                    uint32_t br_idx = INDEX_2D(x + 1, y, padded_grid_res_x + 1);
+                    uint32_t tl_idx = INDEX_2D(x, y + 1, padded_grid_res_x + 1);
+                    uint32_t tr_idx =
+                        INDEX_2D(x + 1, y + 1, padded_grid_res_x + 1);
+
+                    // push 2 triangles that fill the quad which is the current
+                    // cell
+
+                    indices.push_back(bl_idx);
+                    indices.push_back(br_idx);
+                    indices.push_back(tr_idx);
+
+                    indices.push_back(bl_idx);
+                    indices.push_back(tr_idx);
+                    indices.push_back(tl_idx);
+                }
+            }
+
+            VkDeviceSize indices_size_bytes =
+                sizeof(indices[0]) * indices.size();
+
+            StagingAllocation staging =
+                state.staging_ring(queue, false).allocate(indices_size_bytes);
+            std::copy(
+                indices.data(),
+                indices.data() + indices.size(),
+                (uint32_t*)staging.mapped()
             );
-            gwp_vert_shader_stage = bv::ShaderStage{
-                .flags = {},
-                .stage = VK_SHADER_STAGE_VERTEX_BIT,
-                .module = gwp_vert_shader_module,
-                .entry_point = "main",
-                .specialization_info = std::nullopt
-            };
+            staging.flush();
 
-            shader_code = read_file(
-                exec_dir() / "shaders/grid_warp_pass_frag.spv"
+            create_buffer(
+                state,
+                indices_size_bytes,
+
+                VK_BUFFER_USAGE_TRANSFER_DST_BIT
+                | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+
+                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                index_buf,
+                index_buf_mem
             );
-            gwp_frag_shader_module = bv::ShaderModule::create(
-                state.device,
-                std::move(shader_code)
+
+            auto cmd_buf = begin_single_time_commands(state);
+            copy_buffer(
+                cmd_buf,
+                staging.buffer(),
+                index_buf,
+                indices_size_bytes,
+                staging.offset()
             );
-            gwp_frag_shader_stage = bv::ShaderStage{
-                .flags = {},
-                .stage = VK_SHADER_STAGE_FRAGMENT_BIT,
-                .module = gwp_frag_shader_module,
-                .entry_point = "main",
-                .specialization_info = std::nullopt
+            end_single_time_commands(state, cmd_buf, queue);
+        }
+
+        regenerate_grid_vertices(grid_transform);
+    }
+
+    void GridWarper::create_sampler_and_images(const bv::QueuePtr& queue)
+    {
+        // create sampler
+        sampler = bv::Sampler::create(
+            state.device,
+            {
+                .flags = 0,
+                .mag_filter = VK_FILTER_LINEAR,
+                .min_filter = VK_FILTER_LINEAR,
+                .mipmap_mode = VK_SAMPLER_MIPMAP_MODE_NEAREST,
+                .address_mode_u = VK_SAMPLER_ADDRESS_MODE_MIRRORED_REPEAT,
+                .address_mode_v = VK_SAMPLER_ADDRESS_MODE_MIRRORED_REPEAT,
+                .address_mode_w = VK_SAMPLER_ADDRESS_MODE_MIRRORED_REPEAT,
+                .mip_lod_bias = 0.,
+                .anisotropy_enable = false,
+                .max_anisotropy = 0.,
+                .compare_enable = false,
+                .compare_op = VK_COMPARE_OP_ALWAYS,
+                .min_lod = 0.,
+                .max_lod = VK_LOD_CLAMP_NONE,
+                .border_color = VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE,
+                .unnormalized_coordinates = false
+            }
+        );
+
+        // command buffer for image layout transitions
+        auto cmd_buf = begin_single_time_commands(state);
+
+        // create images and image views, and transition layouts
+
+        // warped image uses the intermediate resolution.
+        create_image(
+            state,
+            intermediate_res_x,
+            intermediate_res_y,
+            1,
+            VK_SAMPLE_COUNT_1_BIT,
+            warped_img_format,
+            VK_IMAGE_TILING_OPTIMAL,
+            VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+            warped_img,
+            warped_img_mem
+        );
+        warped_imgview = create_image_view(
+            state,
+            warped_img,
+            warped_img_format,
+            VK_IMAGE_ASPECT_COLOR_BIT,
+            1
+        );
+        transition_image_layout(
+            cmd_buf,
+            warped_img,
+            VK_IMAGE_LAYOUT_UNDEFINED,
+            VK_IMAGE_LAYOUT_GENERAL,
+            1
+        );
+
+        // the high-resolution warped image is created on demand, see
+        // create_warped_hires_img().
+
+        // difference image uses the intermediate resolution
+        create_image(
+            state,
+            intermediate_res_x,
+            intermediate_res_y,
+            1,
+            VK_SAMPLE_COUNT_1_BIT,
+            difference_img_format,
+            VK_IMAGE_TILING_OPTIMAL,
+
+            VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+            difference_img,
+            difference_img_mem
+        );
+        difference_imgview = create_image_view(
+            state,
+            difference_img,
+            difference_img_format,
+            VK_IMAGE_ASPECT_COLOR_BIT,
+            1
+        );
+        transition_image_layout(
+            cmd_buf,
+            difference_img,
+            VK_IMAGE_LAYOUT_UNDEFINED,
+            VK_IMAGE_LAYOUT_GENERAL,
+            1
+        );
+
+        // cost image uses the cost resolution. it's a storage image because
+        // the cost reduction pass writes to it.
+        create_image(
+            state,
+            cost_res_x,
+            cost_res_y,
+            1,
+            VK_SAMPLE_COUNT_1_BIT,
+            VK_FORMAT_R32_SFLOAT,
+            VK_IMAGE_TILING_OPTIMAL,
+
+            VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT
+            | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+            cost_img,
+            cost_img_mem
+        );
+        cost_imgview = create_image_view(
+            state,
+            cost_img,
+            VK_FORMAT_R32_SFLOAT,
+            VK_IMAGE_ASPECT_COLOR_BIT,
+            1
+        );
+        transition_image_layout(
+            cmd_buf,
+            cost_img,
+            VK_IMAGE_LAYOUT_UNDEFINED,
+            VK_IMAGE_LAYOUT_GENERAL,
+            1
+        );
+
+        // end, submit, and wait for the command buffer
+        end_single_time_commands(state, cmd_buf, queue);
+
+        // cost info buffer
+        create_buffer(
+            state,
+            sizeof(CostInfo),
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT
+            | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+
+            cost_info_buf,
+            cost_info_buf_mem
+        );
+        cost_info_buf_mapped = (CostInfo*)cost_info_buf_mem->mapped();
+
+        // cost cache buffer and tree
+        create_buffer(
+            state,
+            cost_res_x * cost_res_y * sizeof(float),
+            VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT
+            | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+
+            cost_cache_buf,
+            cost_cache_buf_mem
+        );
+        cost_cache_buf_mapped = (float*)cost_cache_buf_mem->mapped();
+        cost_cache_tree = SumMaxTree(cost_res_x * cost_res_y);
+        pipeline_cost_tree = SumMaxTree(cost_res_x * cost_res_y);
+
+        // partial sums buffer for the cost pass
+        create_buffer(
+            state,
+            cost_res_x * cost_res_y * n_cost_chunks * sizeof(glm::vec2),
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+            cost_partial_sums_buf,
+            cost_partial_sums_buf_mem
+        );
+    }
+
+    void GridWarper::create_target_log_img(
+        const bv::QueuePtr& queue,
+        float target_img_mul
+    )
+    {
+        // the log values can be large and negative so this one stays 32-bit
+        // even in half precision mode
+        VkFormat format = luminance
+            ? VK_FORMAT_R32_SFLOAT
+            : VK_FORMAT_R32G32B32A32_SFLOAT;
+
+        create_image(
+            state,
+            intermediate_res_x,
+            intermediate_res_y,
+            1,
+            VK_SAMPLE_COUNT_1_BIT,
+            format,
+            VK_IMAGE_TILING_OPTIMAL,
+
+            // cleared before tiled resampling
+            VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT
+            | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+            target_log_img,
+            target_log_img_mem
+        );
+        target_log_imgview = create_image_view(
+            state,
+            target_log_img,
+            format,
+            VK_IMAGE_ASPECT_COLOR_BIT,
+            1
+        );
+
+        // the difference pass and the fused cost pass read it later
+        run_resample_pass(
+            queue,
+            exec_dir() / (luminance
+                ? "shaders/luminance_log_resample_pass_comp.spv"
+                : "shaders/log_resample_pass_comp.spv"),
+            target_imgview,
+            VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+            target_tiled_img,
+            target_log_img,
+            target_log_imgview,
+            target_img_mul,
+
+            VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT
+            | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+
+            VK_ACCESS_SHADER_READ_BIT
+        );
+    }
+
+    void GridWarper::create_warped_hires_img(const bv::QueuePtr& queue)
+    {
+        // high-resolution warped image uses the original resolution
+        create_image(
+            state,
+            img_width,
+            img_height,
+            1,
+            VK_SAMPLE_COUNT_1_BIT,
+            VK_FORMAT_R32G32B32A32_SFLOAT,
+            VK_IMAGE_TILING_OPTIMAL,
+
+            VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT
+            | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+            warped_hires_img,
+            warped_hires_img_mem
+        );
+        warped_hires_imgview = create_image_view(
+            state,
+            warped_hires_img,
+            VK_FORMAT_R32G32B32A32_SFLOAT,
+            VK_IMAGE_ASPECT_COLOR_BIT,
+            1
+        );
+
+        auto cmd_buf = begin_single_time_commands(state);
+        transition_image_layout(
+            cmd_buf,
+            warped_hires_img,
+            VK_IMAGE_LAYOUT_UNDEFINED,
+            VK_IMAGE_LAYOUT_GENERAL,
+            1
+        );
+        end_single_time_commands(state, cmd_buf, queue);
+
+        gwp_framebuf_hires = bv::Framebuffer::create(
+            state.device,
+            bv::FramebufferConfig{
+                .flags = 0,
+                .render_pass = gwp_render_pass_hires,
+                .attachments = { warped_hires_imgview },
+                .width = img_width,
+                .height = img_height,
+                .layers = 1
+            }
+        );
+
+        gwp_cmd_buf_hires->begin(0);
+        record_grid_warp_pass(
+            gwp_cmd_buf_hires,
+            gwp_framebuf_hires,
+            vertex_buf
+        );
+        gwp_cmd_buf_hires->end();
+    }
+
+    void GridWarper::create_warped_tile_img(uint32_t width, uint32_t height)
+    {
+        release_warped_tile_img();
+
+        const auto& limits = state.physical_device.value().properties().limits;
+        if (width > limits.max_image_dimension_2d
+            || height > limits.max_image_dimension_2d
+            || width > limits.max_framebuffer_width
+            || height > limits.max_framebuffer_height)
+        {
+            throw std::invalid_argument(fmt::format(
+                "tile size {}x{} is larger than what the GPU supports",
+                width, height
+            ).c_str());
+        }
+
+        // same as warped_hires_img
+        create_image(
+            state,
+            width,
+            height,
+            1,
+            VK_SAMPLE_COUNT_1_BIT,
+            VK_FORMAT_R32G32B32A32_SFLOAT,
+            VK_IMAGE_TILING_OPTIMAL,
+
+            VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT
+            | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+            warped_tile_img,
+            warped_tile_img_mem
+        );
+        warped_tile_imgview = create_image_view(
+            state,
+            warped_tile_img,
+            VK_FORMAT_R32G32B32A32_SFLOAT,
+            VK_IMAGE_ASPECT_COLOR_BIT,
+            1
+        );
+
+        gwp_framebuf_tile = bv::Framebuffer::create(
+            state.device,
+            bv::FramebufferConfig{
+                .flags = 0,
+                .render_pass = gwp_render_pass_hires,
+                .attachments = { warped_tile_imgview },
+                .width = width,
+                .height = height,
+                .layers = 1
+            }
+        );
+    }
+
+    void GridWarper::create_base_interm_img(const bv::QueuePtr& queue)
+    {
+        VkFormat format = luminance
+            ? VK_FORMAT_R32_SFLOAT
+            : VK_FORMAT_R32G32B32A32_SFLOAT;
+
+        create_image(
+            state,
+            intermediate_res_x,
+            intermediate_res_y,
+            1,
+            VK_SAMPLE_COUNT_1_BIT,
+            format,
+            VK_IMAGE_TILING_OPTIMAL,
+
+            // cleared before tiled resampling
+            VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT
+            | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+            base_interm_img,
+            base_interm_img_mem
+        );
+        base_interm_imgview = create_image_view(
+            state,
+            base_interm_img,
+            format,
+            VK_IMAGE_ASPECT_COLOR_BIT,
+            1
+        );
+
+        // the grid warp pass reads it later. the base image multiplier is
+        // applied there too.
+        run_resample_pass(
+            queue,
+            exec_dir() / (luminance
+                ? "shaders/luminance_resample_pass_comp.spv"
+                : "shaders/resample_pass_comp.spv"),
+            base_imgview,
+            VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+            base_tiled_img,
+            base_interm_img,
+            base_interm_imgview,
+            1.f,
+            VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+            VK_ACCESS_SHADER_READ_BIT
+        );
+    }
+
+    void GridWarper::run_resample_pass(
+        const bv::QueuePtr& queue,
+        const std::filesystem::path& shader_path,
+        const bv::ImageViewWPtr& src_imgview,
+        VkImageLayout src_layout,
+        const std::shared_ptr<TiledImage>& src_tiled_img,
+        const bv::ImagePtr& dst_img,
+        const bv::ImageViewPtr& dst_imgview,
+        float mul,
+        VkPipelineStageFlags next_stage_mask,
+        VkAccessFlags next_stage_access_mask
+    )
+    {
+        // this pass only runs once per image so everything here is temporary
+
+        std::vector<uint8_t> shader_code = read_file(shader_path);
+        auto comp_shader_module = bv::ShaderModule::create(
+            state.device,
+            std::move(shader_code)
+        );
+        bv::ShaderStage comp_shader_stage{
+            .flags = {},
+            .stage = VK_SHADER_STAGE_COMPUTE_BIT,
+            .module = comp_shader_module,
+            .entry_point = "main",
+            .specialization_info = std::nullopt
+        };
+
+        // descriptor set layout
+        bv::DescriptorSetLayoutPtr descriptor_set_layout = nullptr;
+        {
+            bv::DescriptorSetLayoutBinding binding_src_img{
+                .binding = 0,
+                .descriptor_type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                .descriptor_count = 1,
+                .stage_flags = VK_SHADER_STAGE_COMPUTE_BIT,
+                .immutable_samplers = { sampler }
+            };
+
+            bv::DescriptorSetLayoutBinding binding_dst_img{
+                .binding = 1,
+                .descriptor_type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+                .descriptor_count = 1,
+                .stage_flags = VK_SHADER_STAGE_COMPUTE_BIT,
+                .immutable_samplers = {}
+            };
+
+            descriptor_set_layout = bv::DescriptorSetLayout::create(
+                state.device,
+                {
+                    .flags = 0,
+                    .bindings = { binding_src_img, binding_dst_img }
+                }
+            );
+        }
+
+        // descriptor pool
+        bv::DescriptorPoolPtr descriptor_pool = nullptr;
+        {
+            bv::DescriptorPoolSize image_pool_size{
+                .type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                .descriptor_count = 1
+            };
+
+            bv::DescriptorPoolSize storage_image_pool_size{
+                .type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+                .descriptor_count = 1
+            };
+
+            descriptor_pool = bv::DescriptorPool::create(
+                state.device,
+                {
+                    .flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT,
+                    .max_sets = 1,
+                    .pool_sizes = { image_pool_size, storage_image_pool_size }
+                }
+            );
+        }
+
+        // descriptor set. the source image is written before every dispatch
+        // since it changes for every tile.
+        auto descriptor_set = bv::DescriptorPool::allocate_set(
+            descriptor_pool,
+            descriptor_set_layout
+        );
+        auto write_descriptor_set = [&](const bv::ImageViewWPtr& src)
+        {
+            bv::DescriptorImageInfo src_img_info{
+                .sampler = sampler,
+                .image_view = src,
+                .image_layout = src_layout
+            };
+
+            bv::DescriptorImageInfo dst_img_info{
+                .sampler = std::nullopt,
+                .image_view = dst_imgview,
+                .image_layout = VK_IMAGE_LAYOUT_GENERAL
+            };
+
+            std::vector<bv::WriteDescriptorSet> descriptor_writes;
+
+            descriptor_writes.push_back({
+                .dst_set = descriptor_set,
+                .dst_binding = 0,
+                .dst_array_element = 0,
+                .descriptor_count = 1,
+                .descriptor_type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                .image_infos = { src_img_info },
+                .buffer_infos = {},
+                .texel_buffer_views = {}
+                });
+
+            descriptor_writes.push_back({
+                .dst_set = descriptor_set,
+                .dst_binding = 1,
+                .dst_array_element = 0,
+                .descriptor_count = 1,
+                .descriptor_type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+                .image_infos = { dst_img_info },
+                .buffer_infos = {},
+                .texel_buffer_views = {}
+                });
+
+            bv::DescriptorSet::update_sets(state.device, descriptor_writes, {});
+        };
+
+        // pipeline layout and compute pipeline
+        bv::PushConstantRange push_constant_range{
+            .stage_flags = VK_SHADER_STAGE_COMPUTE_BIT,
+            .offset = 0,
+            .size = sizeof(ResamplePassCompPushConstants)
+        };
+
+        auto pipeline_layout = bv::PipelineLayout::create(
+            state.device,
+            bv::PipelineLayoutConfig{
+                .flags = 0,
+                .set_layouts = { descriptor_set_layout },
+                .push_constant_ranges = { push_constant_range }
+            }
+        );
+
+        auto compute_pipeline = bv::ComputePipeline::create(
+            state.device,
+            bv::ComputePipelineConfig{
+                .flags = 0,
+                .stage = comp_shader_stage,
+                .layout = pipeline_layout,
+                .base_pipeline = std::nullopt
+            }
+        );
+
+        uint32_t dst_width = dst_img->config().extent.width;
+        uint32_t dst_height = dst_img->config().extent.height;
+
+        // bind everything and dispatch 8x8 pixels per workgroup
+        auto record_dispatch = [&](
+            const bv::CommandBufferPtr& cmd_buf,
+            const ResamplePassCompPushConstants& push_constants,
+            uint32_t width,
+            uint32_t height
+            )
+        {
+            vkCmdBindPipeline(
+                cmd_buf->handle(),
+                VK_PIPELINE_BIND_POINT_COMPUTE,
+                compute_pipeline->handle()
+            );
+
+            auto vk_descriptor_set = descriptor_set->handle();
+            vkCmdBindDescriptorSets(
+                cmd_buf->handle(),
+                VK_PIPELINE_BIND_POINT_COMPUTE,
+                pipeline_layout->handle(),
+                0,
+                1,
+                &vk_descriptor_set,
+                0,
+                nullptr
+            );
+
+            vkCmdPushConstants(
+                cmd_buf->handle(),
+                pipeline_layout->handle(),
+                VK_SHADER_STAGE_COMPUTE_BIT,
+                0,
+                sizeof(push_constants),
+                &push_constants
+            );
+
+            vkCmdDispatch(
+                cmd_buf->handle(),
+                (width + 7) / 8,
+                (height + 7) / 8,
+                1
+            );
+        };
+
+        // the tiles (and the finalize pass) read what the ones before them
+        // wrote
+        auto record_accumulation_barrier = [&](
+            const bv::CommandBufferPtr& cmd_buf
+            )
+        {
+            image_memory_barrier(
+                cmd_buf,
+                dst_img,
+                VK_IMAGE_LAYOUT_GENERAL,
+                VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                VK_ACCESS_SHADER_WRITE_BIT,
+                VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT
+            );
+        };
+
+        // record, submit, and wait
+        auto cmd_buf = begin_single_time_commands(state);
+
+        transition_image_layout(
+            cmd_buf,
+            dst_img,
+            VK_IMAGE_LAYOUT_UNDEFINED,
+            VK_IMAGE_LAYOUT_GENERAL,
+            1
+        );
+
+        if (!src_tiled_img)
+        {
+            auto src_extent =
+                src_imgview.lock()->image().lock()->config().extent;
+            glm::ivec2 src_res{ src_extent.width, src_extent.height };
+
+            write_descriptor_set(src_imgview);
+            record_dispatch(
+                cmd_buf,
+                ResamplePassCompPushConstants{
+                    .mul = mul,
+                    .mode = RESAMPLE_MODE_WHOLE,
+                    .src_res = src_res,
+                    .src_offset = { 0, 0 },
+                    .core_min = { 0, 0 },
+                    .core_max = src_res,
+                    .dst_offset = { 0, 0 }
+                },
+                dst_width,
+                dst_height
+            );
+        }
+        else
+        {
+            // the tiles add their shares to zero
+            VkClearColorValue clear_val{};
+            VkImageSubresourceRange clear_range{
+                .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                .baseMipLevel = 0,
+                .levelCount = 1,
+                .baseArrayLayer = 0,
+                .layerCount = 1
+            };
+            vkCmdClearColorImage(
+                cmd_buf->handle(),
+                dst_img->handle(),
+                VK_IMAGE_LAYOUT_GENERAL,
+                &clear_val,
+                1,
+                &clear_range
+            );
+            image_memory_barrier(
+                cmd_buf,
+                dst_img,
+                VK_IMAGE_LAYOUT_GENERAL,
+                VK_PIPELINE_STAGE_TRANSFER_BIT,
+                VK_ACCESS_TRANSFER_WRITE_BIT,
+                VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT
+            );
+            end_single_time_commands(state, cmd_buf, queue);
+
+            glm::ivec2 src_res{
+                src_tiled_img->width(),
+                src_tiled_img->height()
+            };
+            double scale_x = (double)dst_width / (double)src_res.x;
+            double scale_y = (double)dst_height / (double)src_res.y;
+
+            // one tile at a time so only one has to be on the GPU. the
+            // descriptor set can be rewritten because we wait every time.
+            const auto& tiles = src_tiled_img->tiles();
+            TiledImage::TexturePtr texture = nullptr;
+            for (size_t i = 0; i < tiles.size(); i++)
+            {
+                const auto& tile = tiles[i];
+                texture = src_tiled_img->upload_tile(state, queue, i);
+                write_descriptor_set(texture->imgview);
+
+                // destination pixels whose footprint overlaps the tile, with
+                // an extra one on every side for rounding errors. the shader
+                // ignores the source pixels outside the tile anyway.
+                uint32_t dst_x0 = (uint32_t)std::max(
+                    std::floor(tile.x * scale_x) - 1.,
+                    0.
+                );
+                uint32_t dst_y0 = (uint32_t)std::max(
+                    std::floor(tile.y * scale_y) - 1.,
+                    0.
+                );
+                uint32_t dst_x1 = (uint32_t)std::min(
+                    std::ceil((tile.x + tile.width) * scale_x) + 1.,
+                    (double)dst_width
+                );
+                uint32_t dst_y1 = (uint32_t)std::min(
+                    std::ceil((tile.y + tile.height) * scale_y) + 1.,
+                    (double)dst_height
+                );
+
+                cmd_buf = begin_single_time_commands(state);
+                record_dispatch(
+                    cmd_buf,
+                    ResamplePassCompPushConstants{
+                        .mul = mul,
+                        .mode = RESAMPLE_MODE_TILE,
+                        .src_res = src_res,
+                        .src_offset = glm::ivec2(tile.tex_x, tile.tex_y),
+                        .core_min = glm::ivec2(tile.x, tile.y),
+                        .core_max = glm::ivec2(
+                            tile.x + tile.width,
+                            tile.y + tile.height
+                        ),
+                        .dst_offset = glm::ivec2(dst_x0, dst_y0)
+                    },
+                    dst_x1 - dst_x0,
+                    dst_y1 - dst_y0
+                );
+                record_accumulation_barrier(cmd_buf);
+                end_single_time_commands(state, cmd_buf, queue);
+            }
+
+            // the finalize pass doesn't read src_img but it still needs a
+            // valid descriptor, so the last tile stays bound
+            cmd_buf = begin_single_time_commands(state);
+            record_dispatch(
+                cmd_buf,
+                ResamplePassCompPushConstants{
+                    .mul = mul,
+                    .mode = RESAMPLE_MODE_FINALIZE,
+                    .src_res = src_res
+                },
+                dst_width,
+                dst_height
+            );
+        }
+
+        image_memory_barrier(
+            cmd_buf,
+            dst_img,
+            VK_IMAGE_LAYOUT_GENERAL,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            VK_ACCESS_SHADER_WRITE_BIT,
+            next_stage_mask,
+            next_stage_access_mask
+        );
+
+        end_single_time_commands(state, cmd_buf, queue);
+
+        // the tiles aren't needed until the warped image is rendered, if at
+        // all
+        if (src_tiled_img)
+        {
+            src_tiled_img->release_textures();
+        }
+    }
+
+    void GridWarper::create_passes()
+    {
+        // shaders
+
+        bv::ShaderModulePtr fullscreen_quad_vert_shader_module = nullptr;
+        bv::ShaderStage fullscreen_quad_vert_shader_stage{};
+
+        bv::ShaderModulePtr gwp_vert_shader_module = nullptr;
+        bv::ShaderStage gwp_vert_shader_stage{};
+
+        bv::ShaderModulePtr gwp_frag_shader_module = nullptr;
+        bv::ShaderStage gwp_frag_shader_stage{};
+
+        bv::ShaderModulePtr dfp_frag_shader_module = nullptr;
+        bv::ShaderStage dfp_frag_shader_stage{};
+
+        bv::ShaderModulePtr csp_comp_shader_module = nullptr;
+        bv::ShaderStage csp_comp_shader_stage{};
+
+        bv::ShaderModulePtr fcp_comp_shader_module = nullptr;
+        bv::ShaderStage fcp_comp_shader_stage{};
+
+        bv::ShaderModulePtr crp_comp_shader_module = nullptr;
+        bv::ShaderStage crp_comp_shader_stage{};
+
+        bv::ShaderModulePtr cip_comp_shader_module = nullptr;
+        bv::ShaderStage cip_comp_shader_stage{};
+
+        bv::ShaderModulePtr dsp_comp_shader_module = nullptr;
+        bv::ShaderStage dsp_comp_shader_stage{};
+
+        bv::ShaderModulePtr acp_comp_shader_module = nullptr;
+        bv::ShaderStage acp_comp_shader_stage{};
+
+        {
+            std::vector<uint8_t> shader_code = read_file(
+                exec_dir() / "shaders/fullscreen_quad_vert.spv"
+            );
+            fullscreen_quad_vert_shader_module = bv::ShaderModule::create(
+                state.device,
+                std::move(shader_code)
+            );
+            fullscreen_quad_vert_shader_stage = bv::ShaderStage{
+                .flags = {},
+                .stage = VK_SHADER_STAGE_VERTEX_BIT,
+                .module = fullscreen_quad_vert_shader_module,
+                .entry_point = "main",
+                .specialization_info = std::nullopt
+            };
+
+            shader_code = read_file(
+                exec_dir() / "shaders/grid_warp_pass_vert.spv"
+            );
+            gwp_vert_shader_module = bv::ShaderModule::create(
+                state.device,
+                std::move(shader_code)
+            );
+            gwp_vert_shader_stage = bv::ShaderStage{
+                .flags = {},
+                .stage = VK_SHADER_STAGE_VERTEX_BIT,
+                .module = gwp_vert_shader_module,
+                .entry_point = "main",
+                .specialization_info = std::nullopt
+            };
+
+            shader_code = read_file(
+                exec_dir() / "shaders/grid_warp_pass_frag.spv"
+            );
+            gwp_frag_shader_module = bv::ShaderModule::create(
+                state.device,
+                std::move(shader_code)
+            );
+            gwp_frag_shader_stage = bv::ShaderStage{
+                .flags = {},
+                .stage = VK_SHADER_STAGE_FRAGMENT_BIT,
+                .module = gwp_frag_shader_module,
+                .entry_point = "main",
+                .specialization_info = std::nullopt
+            };
+
+            shader_code = read_file(
+                exec_dir() / (luminance
+                    ? "shaders/luminance_difference_pass_frag.spv"
+                    : "shaders/difference_pass_frag.spv")
+            );
+            dfp_frag_shader_module = bv::ShaderModule::create(
+                state.device,
+                std::move(shader_code)
+            );
+            dfp_frag_shader_stage = bv::ShaderStage{
+                .flags = {},
+                .stage = VK_SHADER_STAGE_FRAGMENT_BIT,
+                .module = dfp_frag_shader_module,
+                .entry_point = "main",
+                .specialization_info = std::nullopt
+            };
+
+            shader_code = read_file(
+                exec_dir() / "shaders/cost_pass_comp.spv"
+            );
+            csp_comp_shader_module = bv::ShaderModule::create(
+                state.device,
+                std::move(shader_code)
+            );
+            csp_comp_shader_stage = bv::ShaderStage{
+                .flags = {},
+                .stage = VK_SHADER_STAGE_COMPUTE_BIT,
+                .module = csp_comp_shader_module,
+                .entry_point = "main",
+                .specialization_info = std::nullopt
+            };
+
+            shader_code = read_file(
+                exec_dir() / (luminance
+                    ? "shaders/luminance_fused_cost_pass_comp.spv"
+                    : "shaders/fused_cost_pass_comp.spv")
+            );
+            fcp_comp_shader_module = bv::ShaderModule::create(
+                state.device,
+                std::move(shader_code)
+            );
+            fcp_comp_shader_stage = bv::ShaderStage{
+                .flags = {},
+                .stage = VK_SHADER_STAGE_COMPUTE_BIT,
+                .module = fcp_comp_shader_module,
+                .entry_point = "main",
+                .specialization_info = std::nullopt
+            };
+
+            shader_code = read_file(
+                exec_dir() / "shaders/cost_reduction_pass_comp.spv"
+            );
+            crp_comp_shader_module = bv::ShaderModule::create(
+                state.device,
+                std::move(shader_code)
+            );
+            crp_comp_shader_stage = bv::ShaderStage{
+                .flags = {},
+                .stage = VK_SHADER_STAGE_COMPUTE_BIT,
+                .module = crp_comp_shader_module,
+                .entry_point = "main",
+                .specialization_info = std::nullopt
+            };
+
+            shader_code = read_file(
+                exec_dir() / "shaders/cost_info_pass_comp.spv"
+            );
+            cip_comp_shader_module = bv::ShaderModule::create(
+                state.device,
+                std::move(shader_code)
+            );
+            cip_comp_shader_stage = bv::ShaderStage{
+                .flags = {},
+                .stage = VK_SHADER_STAGE_COMPUTE_BIT,
+                .module = cip_comp_shader_module,
+                .entry_point = "main",
+                .specialization_info = std::nullopt
+            };
+
+            shader_code = read_file(
+                exec_dir() / "shaders/displacement_pass_comp.spv"
+            );
+            dsp_comp_shader_module = bv::ShaderModule::create(
+                state.device,
+                std::move(shader_code)
+            );
+            dsp_comp_shader_stage = bv::ShaderStage{
+                .flags = {},
+                .stage = VK_SHADER_STAGE_COMPUTE_BIT,
+                .module = dsp_comp_shader_module,
+                .entry_point = "main",
+                .specialization_info = std::nullopt
+            };
+
+            shader_code = read_file(
+                exec_dir() / "shaders/accept_pass_comp.spv"
+            );
+            acp_comp_shader_module = bv::ShaderModule::create(
+                state.device,
+                std::move(shader_code)
+            );
+            acp_comp_shader_stage = bv::ShaderStage{
+                .flags = {},
+                .stage = VK_SHADER_STAGE_COMPUTE_BIT,
+                .module = acp_comp_shader_module,
+                .entry_point = "main",
+                .specialization_info = std::nullopt
+            };
+        }
+
+        // grid warp pass: descriptor set layout
+        {
+            bv::DescriptorSetLayoutBinding binding_base_img{
+                .binding = 0,
+                .descriptor_type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                .descriptor_count = 1,
+                .stage_flags = VK_SHADER_STAGE_FRAGMENT_BIT,
+                .immutable_samplers = { sampler }
+            };
+
+            gwp_descriptor_set_layout = bv::DescriptorSetLayout::create(
+                state.device,
+                {
+                    .flags = 0,
+                    .bindings = { binding_base_img }
+                }
+            );
+        }
+
+        // grid warp pass: descriptor pool
+        {
+            // 1 image in every descriptor set * 2 sets in total
+            bv::DescriptorPoolSize image_pool_size{
+                .type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                .descriptor_count = 2
+            };
+
+            gwp_descriptor_pool = bv::DescriptorPool::create(
+                state.device,
+                {
+                    .flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT,
+                    .max_sets = 2,
+                    .pool_sizes = { image_pool_size }
+                }
+            );
+        }
+
+        // grid warp pass: descriptor sets for the tiles of a tiled base
+        // image. they're written when the tiles are uploaded.
+        if (base_tiled_img)
+        {
+            uint32_t n_tiles = (uint32_t)base_tiled_img->tiles().size();
+
+            bv::DescriptorPoolSize image_pool_size{
+                .type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                .descriptor_count = n_tiles
+            };
+
+            gwp_tile_descriptor_pool = bv::DescriptorPool::create(
+                state.device,
+                {
+                    .flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT,
+                    .max_sets = n_tiles,
+                    .pool_sizes = { image_pool_size }
+                }
+            );
+
+            for (uint32_t i = 0; i < n_tiles; i++)
+            {
+                gwp_tile_descriptor_sets.push_back(
+                    bv::DescriptorPool::allocate_set(
+                        gwp_tile_descriptor_pool,
+                        gwp_descriptor_set_layout
+                    )
+                );
+            }
+        }
+
+        // grid warp pass: descriptor sets. the intermediate resolution
+        // samples the resampled base image and the original resolution
+        // samples the original one unless it's tiled.
+        {
+            gwp_descriptor_set = bv::DescriptorPool::allocate_set(
+                gwp_descriptor_pool,
+                gwp_descriptor_set_layout
+            );
+
+            bv::DescriptorImageInfo base_interm_img_info{
+                .sampler = sampler,
+                .image_view = base_interm_imgview,
+                .image_layout = VK_IMAGE_LAYOUT_GENERAL
+            };
+
+            std::vector<bv::WriteDescriptorSet> descriptor_writes;
+
+            descriptor_writes.push_back({
+                .dst_set = gwp_descriptor_set,
+                .dst_binding = 0,
+                .dst_array_element = 0,
+                .descriptor_count = 1,
+                .descriptor_type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                .image_infos = { base_interm_img_info },
+                .buffer_infos = {},
+                .texel_buffer_views = {}
+                });
+
+            if (!base_tiled_img)
+            {
+                gwp_descriptor_set_hires = bv::DescriptorPool::allocate_set(
+                    gwp_descriptor_pool,
+                    gwp_descriptor_set_layout
+                );
+
+                bv::DescriptorImageInfo base_img_info{
+                    .sampler = sampler,
+                    .image_view = base_imgview,
+                    .image_layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+                };
+
+                descriptor_writes.push_back({
+                    .dst_set = gwp_descriptor_set_hires,
+                    .dst_binding = 0,
+                    .dst_array_element = 0,
+                    .descriptor_count = 1,
+                    .descriptor_type =
+                    VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                    .image_infos = { base_img_info },
+                    .buffer_infos = {},
+                    .texel_buffer_views = {}
+                    });
+            }
+
+            bv::DescriptorSet::update_sets(state.device, descriptor_writes, {});
+        }
+
+        // grid warp pass: render pass
+        {
+            bv::Attachment color_attachment{
+                .flags = 0,
+                .format = warped_img_format,
+                .samples = VK_SAMPLE_COUNT_1_BIT,
+                .load_op = VK_ATTACHMENT_LOAD_OP_CLEAR,
+                .store_op = VK_ATTACHMENT_STORE_OP_STORE,
+                .stencil_load_op = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+                .stencil_store_op = VK_ATTACHMENT_STORE_OP_DONT_CARE,
+                .initial_layout = VK_IMAGE_LAYOUT_UNDEFINED,
+                .final_layout = VK_IMAGE_LAYOUT_GENERAL
+            };
+
+            bv::AttachmentReference color_attachment_ref{
+                .attachment = 0,
+                .layout = VK_IMAGE_LAYOUT_GENERAL
+            };
+
+            bv::Subpass subpass{
+                .flags = 0,
+                .pipeline_bind_point = VK_PIPELINE_BIND_POINT_GRAPHICS,
+                .input_attachments = {},
+                .color_attachments = { color_attachment_ref },
+                .resolve_attachments = {},
+                .depth_stencil_attachment = std::nullopt,
+                .preserve_attachment_indices = {}
+            };
+
+            bv::SubpassDependency dependency{
+                .src_subpass = VK_SUBPASS_EXTERNAL,
+                .dst_subpass = 0,
+                .src_stage_mask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                .dst_stage_mask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                .src_access_mask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+                .dst_access_mask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+                .dependency_flags = 0
+            };
+
+            gwp_render_pass = bv::RenderPass::create(
+                state.device,
+                bv::RenderPassConfig{
+                    .flags = 0,
+                    .attachments = { color_attachment },
+                    .subpasses = { subpass },
+                    .dependencies = { dependency }
+                }
+            );
+
+            // same thing for the high-resolution warped image, which is
+            // always 32-bit RGBA
+            if (warped_img_format != VK_FORMAT_R32G32B32A32_SFLOAT)
+            {
+                color_attachment.format = VK_FORMAT_R32G32B32A32_SFLOAT;
+                gwp_render_pass_hires = bv::RenderPass::create(
+                    state.device,
+                    bv::RenderPassConfig{
+                        .flags = 0,
+                        .attachments = { color_attachment },
+                        .subpasses = { subpass },
+                        .dependencies = { dependency }
+                    }
+                );
+                color_attachment.format = warped_img_format;
+            }
+            else
+            {
+                gwp_render_pass_hires = gwp_render_pass;
+            }
+
+            // same thing but keeps the existing pixels so we can render a
+            // dirty rectangle on top. it's compatible with the one above so
+            // the same framebuffers and pipeline can be used.
+            color_attachment.load_op = VK_ATTACHMENT_LOAD_OP_LOAD;
+            color_attachment.initial_layout = VK_IMAGE_LAYOUT_GENERAL;
+            gwp_render_pass_load = bv::RenderPass::create(
+                state.device,
+                bv::RenderPassConfig{
+                    .flags = 0,
+                    .attachments = { color_attachment },
+                    .subpasses = { subpass },
+                    .dependencies = { dependency }
+                }
+            );
+        }
+
+        // grid warp pass: framebuffers
+        {
+            gwp_framebuf = bv::Framebuffer::create(
+                state.device,
+                bv::FramebufferConfig{
+                    .flags = 0,
+                    .render_pass = gwp_render_pass,
+                    .attachments = { warped_imgview },
+                    .width = warped_img->config().extent.width,
+                    .height = warped_img->config().extent.height,
+                    .layers = 1
+                }
+            );
+        }
+
+        // grid warp pass: pipeline layout
+        {
+            bv::PushConstantRange vert_push_constant_range{
+                .stage_flags = VK_SHADER_STAGE_VERTEX_BIT,
+                .offset = 0,
+                .size = sizeof(GridWarpPassVertPushConstants)
+            };
+
+            bv::PushConstantRange frag_push_constant_range{
+                .stage_flags = VK_SHADER_STAGE_FRAGMENT_BIT,
+                .offset = sizeof(GridWarpPassVertPushConstants),
+                .size = sizeof(GridWarpPassFragPushConstants)
+            };
+
+            gwp_pipeline_layout = bv::PipelineLayout::create(
+                state.device,
+                bv::PipelineLayoutConfig{
+                    .flags = 0,
+                    .set_layouts = { gwp_descriptor_set_layout },
+                    .push_constant_ranges = {
+                        vert_push_constant_range,
+                        frag_push_constant_range
+                    }
+                }
+            );
+        }
+
+        // grid warp pass: graphics pipeline
+        {
+            // not using intermediate res here because we'll use dynamic
+            // viewport and scissor states anyway.
+            bv::Viewport viewport{
+                .x = 0.f,
+                .y = 0.f,
+                .width = (float)img_width,
+                .height = (float)img_height,
+                .min_depth = 0.f,
+                .max_depth = 1.f
+            };
+
+            bv::Rect2d scissor{
+                .offset = { 0, 0 },
+                .extent = { img_width, img_height }
+            };
+
+            bv::ViewportState viewport_state{
+                .viewports = { viewport },
+                .scissors = { scissor }
+            };
+
+            bv::RasterizationState rasterization_state{
+                .depth_clamp_enable = false,
+                .rasterizer_discard_enable = false,
+                .polygon_mode = VK_POLYGON_MODE_FILL,
+                .cull_mode = VK_CULL_MODE_BACK_BIT,
+                .front_face = VK_FRONT_FACE_CLOCKWISE,
+                .depth_bias_enable = false,
+                .depth_bias_constant_factor = 0.f,
+                .depth_bias_clamp = 0.f,
+                .depth_bias_slope_factor = 0.f,
+                .line_width = 1.f
+            };
+
+            bv::MultisampleState multisample_state{
+                .rasterization_samples = VK_SAMPLE_COUNT_1_BIT,
+                .sample_shading_enable = false,
+                .min_sample_shading = 1.f,
+                .sample_mask = {},
+                .alpha_to_coverage_enable = false,
+                .alpha_to_one_enable = false
+            };
+
+            bv::DepthStencilState depth_stencil_state{
+                .flags = 0,
+                .depth_test_enable = false,
+                .depth_write_enable = false,
+                .depth_compare_op = VK_COMPARE_OP_LESS,
+                .depth_bounds_test_enable = false,
+                .stencil_test_enable = false,
+                .front = {},
+                .back = {},
+                .min_depth_bounds = 0.f,
+                .max_depth_bounds = 1.f
+            };
+
+            bv::ColorBlendAttachment color_blend_attachment{
+                .blend_enable = false,
+                .src_color_blend_factor = VK_BLEND_FACTOR_ONE,
+                .dst_color_blend_factor = VK_BLEND_FACTOR_ZERO,
+                .color_blend_op = VK_BLEND_OP_ADD,
+                .src_alpha_blend_factor = VK_BLEND_FACTOR_ONE,
+                .dst_alpha_blend_factor = VK_BLEND_FACTOR_ZERO,
+                .alpha_blend_op = VK_BLEND_OP_ADD,
+                .color_write_mask =
+                VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT
+                | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT
+            };
+
+            bv::ColorBlendState color_blend_state{
+                .flags = 0,
+                .logic_op_enable = false,
+                .logic_op = VK_LOGIC_OP_COPY,
+                .attachments = { color_blend_attachment },
+                .blend_constants = { 0.f, 0.f, 0.f, 0.f }
+            };
+
+            bv::GraphicsPipelineConfig pipeline_config{
+                .flags = 0,
+                .stages = { gwp_vert_shader_stage, gwp_frag_shader_stage },
+                .vertex_input_state = bv::VertexInputState{
+                    .binding_descriptions = { gwp_vertex_bindings },
+                    .attribute_descriptions = { gwp_vertex_attributes }
+                },
+                .input_assembly_state = bv::InputAssemblyState{
+                    .topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,
+                    .primitive_restart_enable = false
+                },
+                .tessellation_state = std::nullopt,
+                .viewport_state = viewport_state,
+                .rasterization_state = rasterization_state,
+                .multisample_state = multisample_state,
+                .depth_stencil_state = depth_stencil_state,
+                .color_blend_state = color_blend_state,
+                .dynamic_states = {
+                    VK_DYNAMIC_STATE_VIEWPORT,
+                    VK_DYNAMIC_STATE_SCISSOR
+                },
+                .layout = gwp_pipeline_layout,
+                .render_pass = gwp_render_pass,
+                .subpass_index = 0,
+                .base_pipeline = std::nullopt
+            };
+            gwp_graphics_pipeline = bv::GraphicsPipeline::create(
+                state.device,
+                pipeline_config
+            );
+
+            if (gwp_render_pass_hires != gwp_render_pass)
+            {
+                pipeline_config.render_pass = gwp_render_pass_hires;
+                gwp_graphics_pipeline_hires = bv::GraphicsPipeline::create(
+                    state.device,
+                    pipeline_config
+                );
+            }
+            else
+            {
+                gwp_graphics_pipeline_hires = gwp_graphics_pipeline;
+            }
+        }
+
+        // grid warp pass: fence
+        gwp_fence = bv::Fence::create(state.device, 0);
+
+        // difference pass: descriptor set layout
+        {
+            bv::DescriptorSetLayoutBinding binding_warped_img{
+                .binding = 0,
+                .descriptor_type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                .descriptor_count = 1,
+                .stage_flags = VK_SHADER_STAGE_FRAGMENT_BIT,
+                .immutable_samplers = { sampler }
+            };
+
+            bv::DescriptorSetLayoutBinding binding_target_log_img{
+                .binding = 1,
+                .descriptor_type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                .descriptor_count = 1,
+                .stage_flags = VK_SHADER_STAGE_FRAGMENT_BIT,
+                .immutable_samplers = { sampler }
+            };
+
+            dfp_descriptor_set_layout = bv::DescriptorSetLayout::create(
+                state.device,
+                {
+                    .flags = 0,
+                    .bindings = { binding_warped_img, binding_target_log_img }
+                }
+            );
+        }
+
+        // difference pass: descriptor pool
+        {
+            // 2 images in every descriptor set * 1 set in total
+            bv::DescriptorPoolSize image_pool_size{
+                .type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                .descriptor_count = 2
+            };
+
+            dfp_descriptor_pool = bv::DescriptorPool::create(
+                state.device,
+                {
+                    .flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT,
+                    .max_sets = 1,
+                    .pool_sizes = { image_pool_size }
+                }
+            );
+        }
+
+        // difference pass: descriptor set
+        {
+            dfp_descriptor_set = bv::DescriptorPool::allocate_set(
+                dfp_descriptor_pool,
+                dfp_descriptor_set_layout
+            );
+
+            bv::DescriptorImageInfo warped_img_info{
+                .sampler = sampler,
+                .image_view = warped_imgview,
+                .image_layout = VK_IMAGE_LAYOUT_GENERAL
+            };
+
+            bv::DescriptorImageInfo target_log_img_info{
+                .sampler = sampler,
+                .image_view = target_log_imgview,
+                .image_layout = VK_IMAGE_LAYOUT_GENERAL
+            };
+
+            std::vector<bv::WriteDescriptorSet> descriptor_writes;
+
+            descriptor_writes.push_back({
+                .dst_set = dfp_descriptor_set,
+                .dst_binding = 0,
+                .dst_array_element = 0,
+                .descriptor_count = 1,
+                .descriptor_type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                .image_infos = { warped_img_info },
+                .buffer_infos = {},
+                .texel_buffer_views = {}
+                });
+
+            descriptor_writes.push_back({
+                .dst_set = dfp_descriptor_set,
+                .dst_binding = 1,
+                .dst_array_element = 0,
+                .descriptor_count = 1,
+                .descriptor_type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                .image_infos = { target_log_img_info },
+                .buffer_infos = {},
+                .texel_buffer_views = {}
+                });
+
+            bv::DescriptorSet::update_sets(state.device, descriptor_writes, {});
+        }
+
+        // difference pass: render pass
+        {
+            bv::Attachment color_attachment{
+                .flags = 0,
+                .format = difference_img_format,
+                .samples = VK_SAMPLE_COUNT_1_BIT,
+                .load_op = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+                .store_op = VK_ATTACHMENT_STORE_OP_STORE,
+                .stencil_load_op = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+                .stencil_store_op = VK_ATTACHMENT_STORE_OP_DONT_CARE,
+                .initial_layout = VK_IMAGE_LAYOUT_UNDEFINED,
+                .final_layout = VK_IMAGE_LAYOUT_GENERAL
+            };
+
+            bv::AttachmentReference color_attachment_ref{
+                .attachment = 0,
+                .layout = VK_IMAGE_LAYOUT_GENERAL
+            };
+
+            bv::Subpass subpass{
+                .flags = 0,
+                .pipeline_bind_point = VK_PIPELINE_BIND_POINT_GRAPHICS,
+                .input_attachments = {},
+                .color_attachments = { color_attachment_ref },
+                .resolve_attachments = {},
+                .depth_stencil_attachment = std::nullopt,
+                .preserve_attachment_indices = {}
+            };
+
+            bv::SubpassDependency dependency{
+                .src_subpass = VK_SUBPASS_EXTERNAL,
+                .dst_subpass = 0,
+                .src_stage_mask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                .dst_stage_mask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                .src_access_mask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+                .dst_access_mask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+                .dependency_flags = 0
+            };
+
+            dfp_render_pass = bv::RenderPass::create(
+                state.device,
+                bv::RenderPassConfig{
+                    .flags = 0,
+                    .attachments = { color_attachment },
+                    .subpasses = { subpass },
+                    .dependencies = { dependency }
+                }
+            );
+        }
+
+        // difference pass: framebuffer
+        dfp_framebuf = bv::Framebuffer::create(
+            state.device,
+            bv::FramebufferConfig{
+                .flags = 0,
+                .render_pass = dfp_render_pass,
+                .attachments = { difference_imgview },
+                .width = difference_img->config().extent.width,
+                .height = difference_img->config().extent.height,
+                .layers = 1
+            }
+        );
+
+        // difference pass: pipeline layout
+        dfp_pipeline_layout = bv::PipelineLayout::create(
+            state.device,
+            bv::PipelineLayoutConfig{
+                .flags = 0,
+                .set_layouts = { dfp_descriptor_set_layout },
+                .push_constant_ranges = {}
+            }
+        );
+
+        // difference pass: graphics pipeline
+        {
+            bv::Viewport viewport{
+                .x = 0.f,
+                .y = 0.f,
+                .width = (float)dfp_framebuf->config().width,
+                .height = (float)dfp_framebuf->config().height,
+                .min_depth = 0.f,
+                .max_depth = 1.f
+            };
+
+            bv::Rect2d scissor{
+                .offset = { 0, 0 },
+                .extent = {
+                    dfp_framebuf->config().width,
+                    dfp_framebuf->config().height
+                }
+            };
+
+            bv::ViewportState viewport_state{
+                .viewports = { viewport },
+                .scissors = { scissor }
+            };
+
+            bv::RasterizationState rasterization_state{
+                .depth_clamp_enable = false,
+                .rasterizer_discard_enable = false,
+                .polygon_mode = VK_POLYGON_MODE_FILL,
+                .cull_mode = VK_CULL_MODE_BACK_BIT,
+                .front_face = VK_FRONT_FACE_CLOCKWISE,
+                .depth_bias_enable = false,
+                .depth_bias_constant_factor = 0.f,
+                .depth_bias_clamp = 0.f,
+                .depth_bias_slope_factor = 0.f,
+                .line_width = 1.f
+            };
+
+            bv::MultisampleState multisample_state{
+                .rasterization_samples = VK_SAMPLE_COUNT_1_BIT,
+                .sample_shading_enable = false,
+                .min_sample_shading = 1.f,
+                .sample_mask = {},
+                .alpha_to_coverage_enable = false,
+                .alpha_to_one_enable = false
+            };
+
+            bv::DepthStencilState depth_stencil_state{
+                .flags = 0,
+                .depth_test_enable = false,
+                .depth_write_enable = false,
+                .depth_compare_op = VK_COMPARE_OP_LESS,
+                .depth_bounds_test_enable = false,
+                .stencil_test_enable = false,
+                .front = {},
+                .back = {},
+                .min_depth_bounds = 0.f,
+                .max_depth_bounds = 1.f
+            };
+
+            bv::ColorBlendAttachment color_blend_attachment{
+                .blend_enable = false,
+                .src_color_blend_factor = VK_BLEND_FACTOR_ONE,
+                .dst_color_blend_factor = VK_BLEND_FACTOR_ZERO,
+                .color_blend_op = VK_BLEND_OP_ADD,
+                .src_alpha_blend_factor = VK_BLEND_FACTOR_ONE,
+                .dst_alpha_blend_factor = VK_BLEND_FACTOR_ZERO,
+                .alpha_blend_op = VK_BLEND_OP_ADD,
+                .color_write_mask =
+                VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT
+                | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT
             };
 
-            shader_code = read_file(
-                exec_dir() / "shaders/difference_pass_frag.spv"
-            );
-            dfp_frag_shader_module = bv::ShaderModule::create(
-                state.device,
-                std::move(shader_code)
-            );
-            dfp_frag_shader_stage = bv::ShaderStage{
-                .flags = {},
-                .stage = VK_SHADER_STAGE_FRAGMENT_BIT,
-                .module = dfp_frag_shader_module,
-                .entry_point = "main",
-                .specialization_info = std::nullopt
+            bv::ColorBlendState color_blend_state{
+                .flags = 0,
+                .logic_op_enable = false,
+                .logic_op = VK_LOGIC_OP_COPY,
+                .attachments = { color_blend_attachment },
+                .blend_constants = { 0.f, 0.f, 0.f, 0.f }
             };
 
-            shader_code = read_file(
-                exec_dir() / "shaders/cost_pass_frag.spv"
-            );
-            csp_frag_shader_module = bv::ShaderModule::create(
+            dfp_graphics_pipeline = bv::GraphicsPipeline::create(
                 state.device,
-                std::move(shader_code)
+                bv::GraphicsPipelineConfig{
+                    .flags = 0,
+                    .stages = {
+                        fullscreen_quad_vert_shader_stage,
+                        dfp_frag_shader_stage
+                    },
+                    .vertex_input_state = bv::VertexInputState{
+                        .binding_descriptions = {},
+                        .attribute_descriptions = {}
+                    },
+                    .input_assembly_state = bv::InputAssemblyState{
+                        .topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,
+                        .primitive_restart_enable = false
+                    },
+                    .tessellation_state = std::nullopt,
+                    .viewport_state = viewport_state,
+                    .rasterization_state = rasterization_state,
+                    .multisample_state = multisample_state,
+                    .depth_stencil_state = depth_stencil_state,
+                    .color_blend_state = color_blend_state,
+                    .dynamic_states = {},
+                    .layout = dfp_pipeline_layout,
+                    .render_pass = dfp_render_pass,
+                    .subpass_index = 0,
+                    .base_pipeline = std::nullopt
+                }
             );
-            csp_frag_shader_stage = bv::ShaderStage{
-                .flags = {},
-                .stage = VK_SHADER_STAGE_FRAGMENT_BIT,
-                .module = csp_frag_shader_module,
-                .entry_point = "main",
-                .specialization_info = std::nullopt
-            };
         }
 
-        // grid warp pass: descriptor set layout
+        // cost pass: descriptor set layout
         {
-            bv::DescriptorSetLayoutBinding binding_base_img{
+            bv::DescriptorSetLayoutBinding binding_difference_img{
                 .binding = 0,
                 .descriptor_type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
                 .descriptor_count = 1,
-                .stage_flags = VK_SHADER_STAGE_FRAGMENT_BIT,
+                .stage_flags = VK_SHADER_STAGE_COMPUTE_BIT,
                 .immutable_samplers = { sampler }
             };
 
-            gwp_descriptor_set_layout = bv::DescriptorSetLayout::create(
+            bv::DescriptorSetLayoutBinding binding_partial_sums{
+                .binding = 2,
+                .descriptor_type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                .descriptor_count = 1,
+                .stage_flags = VK_SHADER_STAGE_COMPUTE_BIT,
+                .immutable_samplers = {}
+            };
+
+            csp_descriptor_set_layout = bv::DescriptorSetLayout::create(
                 state.device,
                 {
                     .flags = 0,
-                    .bindings = { binding_base_img }
+                    .bindings = { binding_difference_img, binding_partial_sums }
                 }
             );
         }
 
-        // grid warp pass: descriptor pool
+        // cost pass: descriptor pool
         {
             // 1 image in every descriptor set * 1 set in total
             bv::DescriptorPoolSize image_pool_size{
@@ -984,820 +3750,1407 @@ namespace img_aligner::grid_warp
                 .descriptor_count = 1
             };
 
-            gwp_descriptor_pool = bv::DescriptorPool::create(
+            // 1 buffer in every descriptor set * 1 set in total
+            bv::DescriptorPoolSize buffer_pool_size{
+                .type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                .descriptor_count = 1
+            };
+
+            csp_descriptor_pool = bv::DescriptorPool::create(
                 state.device,
                 {
                     .flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT,
                     .max_sets = 1,
-                    .pool_sizes = { image_pool_size }
+                    .pool_sizes = { image_pool_size, buffer_pool_size }
                 }
             );
         }
 
-        // grid warp pass: descriptor set
+        // cost pass: descriptor set
         {
-            gwp_descriptor_set = bv::DescriptorPool::allocate_set(
-                gwp_descriptor_pool,
-                gwp_descriptor_set_layout
+            csp_descriptor_set = bv::DescriptorPool::allocate_set(
+                csp_descriptor_pool,
+                csp_descriptor_set_layout
             );
 
-            bv::DescriptorImageInfo base_img_info{
+            bv::DescriptorImageInfo difference_img_info{
                 .sampler = sampler,
-                .image_view = base_imgview,
-                .image_layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+                .image_view = difference_imgview,
+                .image_layout = VK_IMAGE_LAYOUT_GENERAL
+            };
+
+            bv::DescriptorBufferInfo partial_sums_buf_info{
+                .buffer = cost_partial_sums_buf,
+                .offset = 0,
+                .range = VK_WHOLE_SIZE
             };
 
             std::vector<bv::WriteDescriptorSet> descriptor_writes;
 
             descriptor_writes.push_back({
-                .dst_set = gwp_descriptor_set,
+                .dst_set = csp_descriptor_set,
                 .dst_binding = 0,
                 .dst_array_element = 0,
                 .descriptor_count = 1,
                 .descriptor_type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-                .image_infos = { base_img_info },
+                .image_infos = { difference_img_info },
                 .buffer_infos = {},
                 .texel_buffer_views = {}
                 });
 
+            descriptor_writes.push_back({
+                .dst_set = csp_descriptor_set,
+                .dst_binding = 2,
+                .dst_array_element = 0,
+                .descriptor_count = 1,
+                .descriptor_type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                .image_infos = {},
+                .buffer_infos = { partial_sums_buf_info },
+                .texel_buffer_views = {}
+                });
+
             bv::DescriptorSet::update_sets(state.device, descriptor_writes, {});
         }
 
-        // grid warp pass: render pass
+        // cost pass: pipeline layout
         {
-            bv::Attachment color_attachment{
+            bv::PushConstantRange push_constant_range{
+                .stage_flags = VK_SHADER_STAGE_COMPUTE_BIT,
+                .offset = 0,
+                .size = sizeof(CostPassCompPushConstants)
+            };
+
+            csp_pipeline_layout = bv::PipelineLayout::create(
+                state.device,
+                bv::PipelineLayoutConfig{
+                    .flags = 0,
+                    .set_layouts = { csp_descriptor_set_layout },
+                    .push_constant_ranges = { push_constant_range }
+                }
+            );
+        }
+
+        // cost pass: compute pipeline
+        csp_compute_pipeline = bv::ComputePipeline::create(
+            state.device,
+            bv::ComputePipelineConfig{
                 .flags = 0,
-                .format = VK_FORMAT_R32G32B32A32_SFLOAT,
-                .samples = VK_SAMPLE_COUNT_1_BIT,
-                .load_op = VK_ATTACHMENT_LOAD_OP_CLEAR,
-                .store_op = VK_ATTACHMENT_STORE_OP_STORE,
-                .stencil_load_op = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
-                .stencil_store_op = VK_ATTACHMENT_STORE_OP_DONT_CARE,
-                .initial_layout = VK_IMAGE_LAYOUT_UNDEFINED,
-                .final_layout = VK_IMAGE_LAYOUT_GENERAL
+                .stage = csp_comp_shader_stage,
+                .layout = csp_pipeline_layout,
+                .base_pipeline = std::nullopt
+            }
+        );
+
+        // fused cost pass: descriptor set layout
+        {
+            bv::DescriptorSetLayoutBinding binding_warped_img{
+                .binding = 0,
+                .descriptor_type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                .descriptor_count = 1,
+                .stage_flags = VK_SHADER_STAGE_COMPUTE_BIT,
+                .immutable_samplers = { sampler }
             };
 
-            bv::AttachmentReference color_attachment_ref{
-                .attachment = 0,
-                .layout = VK_IMAGE_LAYOUT_GENERAL
+            bv::DescriptorSetLayoutBinding binding_target_log_img{
+                .binding = 1,
+                .descriptor_type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                .descriptor_count = 1,
+                .stage_flags = VK_SHADER_STAGE_COMPUTE_BIT,
+                .immutable_samplers = { sampler }
             };
 
-            bv::Subpass subpass{
+            bv::DescriptorSetLayoutBinding binding_partial_sums{
+                .binding = 2,
+                .descriptor_type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                .descriptor_count = 1,
+                .stage_flags = VK_SHADER_STAGE_COMPUTE_BIT,
+                .immutable_samplers = {}
+            };
+
+            fcp_descriptor_set_layout = bv::DescriptorSetLayout::create(
+                state.device,
+                {
+                    .flags = 0,
+                    .bindings = {
+                        binding_warped_img,
+                        binding_target_log_img,
+                        binding_partial_sums
+                    }
+                }
+            );
+        }
+
+        // cost reduction pass: descriptor set layout
+        {
+            bv::DescriptorSetLayoutBinding binding_partial_sums{
+                .binding = 0,
+                .descriptor_type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                .descriptor_count = 1,
+                .stage_flags = VK_SHADER_STAGE_COMPUTE_BIT,
+                .immutable_samplers = {}
+            };
+
+            bv::DescriptorSetLayoutBinding binding_cost_img{
+                .binding = 1,
+                .descriptor_type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+                .descriptor_count = 1,
+                .stage_flags = VK_SHADER_STAGE_COMPUTE_BIT,
+                .immutable_samplers = {}
+            };
+
+            crp_descriptor_set_layout = bv::DescriptorSetLayout::create(
+                state.device,
+                {
+                    .flags = 0,
+                    .bindings = { binding_partial_sums, binding_cost_img }
+                }
+            );
+        }
+
+        // fused cost pass and cost reduction pass: descriptor pool
+        {
+            // 2 images in every fused cost pass descriptor set * 1 set
+            bv::DescriptorPoolSize image_pool_size{
+                .type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                .descriptor_count = 2
+            };
+
+            // 1 buffer in every descriptor set * 2 sets
+            bv::DescriptorPoolSize buffer_pool_size{
+                .type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                .descriptor_count = 2
+            };
+
+            // 1 storage image in every cost reduction pass descriptor set *
+            // 1 set
+            bv::DescriptorPoolSize storage_image_pool_size{
+                .type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+                .descriptor_count = 1
+            };
+
+            fcp_crp_descriptor_pool = bv::DescriptorPool::create(
+                state.device,
+                {
+                    .flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT,
+                    .max_sets = 2,
+                    .pool_sizes = {
+                        image_pool_size,
+                        buffer_pool_size,
+                        storage_image_pool_size
+                    }
+                }
+            );
+        }
+
+        // fused cost pass and cost reduction pass: descriptor sets
+        fcp_descriptor_set = create_fcp_descriptor_set(
+            fcp_crp_descriptor_pool,
+            warped_imgview,
+            cost_partial_sums_buf
+        );
+        crp_descriptor_set = create_crp_descriptor_set(
+            fcp_crp_descriptor_pool,
+            cost_partial_sums_buf,
+            cost_imgview
+        );
+
+        // fused cost pass and cost reduction pass: pipeline layouts
+        {
+            bv::PushConstantRange push_constant_range{
+                .stage_flags = VK_SHADER_STAGE_COMPUTE_BIT,
+                .offset = 0,
+                .size = sizeof(CostPassCompPushConstants)
+            };
+
+            fcp_pipeline_layout = bv::PipelineLayout::create(
+                state.device,
+                bv::PipelineLayoutConfig{
+                    .flags = 0,
+                    .set_layouts = { fcp_descriptor_set_layout },
+                    .push_constant_ranges = { push_constant_range }
+                }
+            );
+
+            crp_pipeline_layout = bv::PipelineLayout::create(
+                state.device,
+                bv::PipelineLayoutConfig{
+                    .flags = 0,
+                    .set_layouts = { crp_descriptor_set_layout },
+                    .push_constant_ranges = { push_constant_range }
+                }
+            );
+        }
+
+        // fused cost pass and cost reduction pass: compute pipelines
+
+        fcp_compute_pipeline = bv::ComputePipeline::create(
+            state.device,
+            bv::ComputePipelineConfig{
                 .flags = 0,
-                .pipeline_bind_point = VK_PIPELINE_BIND_POINT_GRAPHICS,
-                .input_attachments = {},
-                .color_attachments = { color_attachment_ref },
-                .resolve_attachments = {},
-                .depth_stencil_attachment = std::nullopt,
-                .preserve_attachment_indices = {}
+                .stage = fcp_comp_shader_stage,
+                .layout = fcp_pipeline_layout,
+                .base_pipeline = std::nullopt
+            }
+        );
+
+        crp_compute_pipeline = bv::ComputePipeline::create(
+            state.device,
+            bv::ComputePipelineConfig{
+                .flags = 0,
+                .stage = crp_comp_shader_stage,
+                .layout = crp_pipeline_layout,
+                .base_pipeline = std::nullopt
+            }
+        );
+
+        // cost info pass: descriptor set layout
+        {
+            bv::DescriptorSetLayoutBinding binding_cost_img{
+                .binding = 0,
+                .descriptor_type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+                .descriptor_count = 1,
+                .stage_flags = VK_SHADER_STAGE_COMPUTE_BIT,
+                .immutable_samplers = {}
             };
 
-            bv::SubpassDependency dependency{
-                .src_subpass = VK_SUBPASS_EXTERNAL,
-                .dst_subpass = 0,
-                .src_stage_mask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-                .dst_stage_mask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-                .src_access_mask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
-                .dst_access_mask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
-                .dependency_flags = 0
+            bv::DescriptorSetLayoutBinding binding_cost_info{
+                .binding = 1,
+                .descriptor_type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                .descriptor_count = 1,
+                .stage_flags = VK_SHADER_STAGE_COMPUTE_BIT,
+                .immutable_samplers = {}
             };
 
-            gwp_render_pass = bv::RenderPass::create(
+            cip_descriptor_set_layout = bv::DescriptorSetLayout::create(
                 state.device,
-                bv::RenderPassConfig{
+                {
                     .flags = 0,
-                    .attachments = { color_attachment },
-                    .subpasses = { subpass },
-                    .dependencies = { dependency }
+                    .bindings = { binding_cost_img, binding_cost_info }
+                }
+            );
+        }
+
+        // cost info pass: descriptor pool
+        cip_descriptor_pool = create_cip_descriptor_pool(1);
+
+        // cost info pass: descriptor set
+        cip_descriptor_set = create_cip_descriptor_set(
+            cip_descriptor_pool,
+            cost_imgview,
+            cost_info_buf
+        );
+
+        // cost info pass: pipeline layout
+        {
+            bv::PushConstantRange push_constant_range{
+                .stage_flags = VK_SHADER_STAGE_COMPUTE_BIT,
+                .offset = 0,
+                .size = sizeof(CostInfoPassCompPushConstants)
+            };
+
+            cip_pipeline_layout = bv::PipelineLayout::create(
+                state.device,
+                bv::PipelineLayoutConfig{
+                    .flags = 0,
+                    .set_layouts = { cip_descriptor_set_layout },
+                    .push_constant_ranges = { push_constant_range }
                 }
             );
         }
 
-        // grid warp pass: framebuffers
+        // cost info pass: compute pipeline
+        cip_compute_pipeline = bv::ComputePipeline::create(
+            state.device,
+            bv::ComputePipelineConfig{
+                .flags = 0,
+                .stage = cip_comp_shader_stage,
+                .layout = cip_pipeline_layout,
+                .base_pipeline = std::nullopt
+            }
+        );
+
+        // displacement pass and accept pass: descriptor set layouts. every
+        // binding is a storage buffer, 4 for the displacement pass (vertices,
+        // candidate vertices, warps, state) and 3 for the accept pass (cost
+        // info, state, history).
         {
-            gwp_framebuf = bv::Framebuffer::create(
+            std::vector<bv::DescriptorSetLayoutBinding> bindings;
+            for (uint32_t i = 0; i < 4; i++)
+            {
+                bindings.push_back(bv::DescriptorSetLayoutBinding{
+                    .binding = i,
+                    .descriptor_type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                    .descriptor_count = 1,
+                    .stage_flags = VK_SHADER_STAGE_COMPUTE_BIT,
+                    .immutable_samplers = {}
+                    });
+            }
+
+            dsp_descriptor_set_layout = bv::DescriptorSetLayout::create(
                 state.device,
-                bv::FramebufferConfig{
+                {
                     .flags = 0,
-                    .render_pass = gwp_render_pass,
-                    .attachments = { warped_imgview },
-                    .width = warped_img->config().extent.width,
-                    .height = warped_img->config().extent.height,
-                    .layers = 1
+                    .bindings = bindings
                 }
             );
 
-            gwp_framebuf_hires = bv::Framebuffer::create(
+            bindings.pop_back();
+            acp_descriptor_set_layout = bv::DescriptorSetLayout::create(
                 state.device,
-                bv::FramebufferConfig{
+                {
                     .flags = 0,
-                    .render_pass = gwp_render_pass,
-                    .attachments = { warped_hires_imgview },
-                    .width = warped_hires_img->config().extent.width,
-                    .height = warped_hires_img->config().extent.height,
-                    .layers = 1
+                    .bindings = bindings
                 }
             );
         }
 
-        // grid warp pass: pipeline layout
+        // displacement pass: pipeline layout
         {
-            bv::PushConstantRange frag_push_constant_range{
-                .stage_flags = VK_SHADER_STAGE_FRAGMENT_BIT,
+            bv::PushConstantRange push_constant_range{
+                .stage_flags = VK_SHADER_STAGE_COMPUTE_BIT,
                 .offset = 0,
-                .size = sizeof(GridWarpPassFragPushConstants)
+                .size = sizeof(DisplacementPassCompPushConstants)
             };
 
-            gwp_pipeline_layout = bv::PipelineLayout::create(
+            dsp_pipeline_layout = bv::PipelineLayout::create(
                 state.device,
                 bv::PipelineLayoutConfig{
                     .flags = 0,
-                    .set_layouts = { gwp_descriptor_set_layout },
-                    .push_constant_ranges = { frag_push_constant_range }
+                    .set_layouts = { dsp_descriptor_set_layout },
+                    .push_constant_ranges = { push_constant_range }
                 }
             );
         }
 
-        // grid warp pass: graphics pipeline
+        // displacement pass: compute pipeline
+        dsp_compute_pipeline = bv::ComputePipeline::create(
+            state.device,
+            bv::ComputePipelineConfig{
+                .flags = 0,
+                .stage = dsp_comp_shader_stage,
+                .layout = dsp_pipeline_layout,
+                .base_pipeline = std::nullopt
+            }
+        );
+
+        // accept pass: pipeline layout
         {
-            // not using intermediate res here because we'll use dynamic
-            // viewport and scissor states anyway.
-            bv::Viewport viewport{
-                .x = 0.f,
-                .y = 0.f,
-                .width = (float)img_width,
-                .height = (float)img_height,
-                .min_depth = 0.f,
-                .max_depth = 1.f
+            bv::PushConstantRange push_constant_range{
+                .stage_flags = VK_SHADER_STAGE_COMPUTE_BIT,
+                .offset = 0,
+                .size = sizeof(AcceptPassCompPushConstants)
             };
 
-            bv::Rect2d scissor{
-                .offset = { 0, 0 },
-                .extent = { img_width, img_height }
-            };
+            acp_pipeline_layout = bv::PipelineLayout::create(
+                state.device,
+                bv::PipelineLayoutConfig{
+                    .flags = 0,
+                    .set_layouts = { acp_descriptor_set_layout },
+                    .push_constant_ranges = { push_constant_range }
+                }
+            );
+        }
 
-            bv::ViewportState viewport_state{
-                .viewports = { viewport },
-                .scissors = { scissor }
-            };
+        // accept pass: compute pipeline
+        acp_compute_pipeline = bv::ComputePipeline::create(
+            state.device,
+            bv::ComputePipelineConfig{
+                .flags = 0,
+                .stage = acp_comp_shader_stage,
+                .layout = acp_pipeline_layout,
+                .base_pipeline = std::nullopt
+            }
+        );
+    }
 
-            bv::RasterizationState rasterization_state{
-                .depth_clamp_enable = false,
-                .rasterizer_discard_enable = false,
-                .polygon_mode = VK_POLYGON_MODE_FILL,
-                .cull_mode = VK_CULL_MODE_BACK_BIT,
-                .front_face = VK_FRONT_FACE_CLOCKWISE,
-                .depth_bias_enable = false,
-                .depth_bias_constant_factor = 0.f,
-                .depth_bias_clamp = 0.f,
-                .depth_bias_slope_factor = 0.f,
-                .line_width = 1.f
-            };
+    bv::DescriptorPoolPtr GridWarper::create_cip_descriptor_pool(
+        uint32_t n_sets
+    )
+    {
+        // 1 storage image in every descriptor set
+        bv::DescriptorPoolSize storage_image_pool_size{
+            .type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+            .descriptor_count = n_sets
+        };
 
-            bv::MultisampleState multisample_state{
-                .rasterization_samples = VK_SAMPLE_COUNT_1_BIT,
-                .sample_shading_enable = false,
-                .min_sample_shading = 1.f,
-                .sample_mask = {},
-                .alpha_to_coverage_enable = false,
-                .alpha_to_one_enable = false
-            };
+        // 1 buffer in every descriptor set
+        bv::DescriptorPoolSize buffer_pool_size{
+            .type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+            .descriptor_count = n_sets
+        };
 
-            bv::DepthStencilState depth_stencil_state{
-                .flags = 0,
-                .depth_test_enable = false,
-                .depth_write_enable = false,
-                .depth_compare_op = VK_COMPARE_OP_LESS,
-                .depth_bounds_test_enable = false,
-                .stencil_test_enable = false,
-                .front = {},
-                .back = {},
-                .min_depth_bounds = 0.f,
-                .max_depth_bounds = 1.f
-            };
+        return bv::DescriptorPool::create(
+            state.device,
+            {
+                .flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT,
+                .max_sets = n_sets,
+                .pool_sizes = { storage_image_pool_size, buffer_pool_size }
+            }
+        );
+    }
 
-            bv::ColorBlendAttachment color_blend_attachment{
-                .blend_enable = false,
-                .src_color_blend_factor = VK_BLEND_FACTOR_ONE,
-                .dst_color_blend_factor = VK_BLEND_FACTOR_ZERO,
-                .color_blend_op = VK_BLEND_OP_ADD,
-                .src_alpha_blend_factor = VK_BLEND_FACTOR_ONE,
-                .dst_alpha_blend_factor = VK_BLEND_FACTOR_ZERO,
-                .alpha_blend_op = VK_BLEND_OP_ADD,
-                .color_write_mask =
-                VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT
-                | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT
-            };
+    bv::DescriptorSetPtr GridWarper::create_cip_descriptor_set(
+        const bv::DescriptorPoolPtr& pool,
+        const bv::ImageViewPtr& cost_imgview_to_use,
+        const bv::BufferPtr& cost_info_buf_to_use
+    )
+    {
+        auto descriptor_set = bv::DescriptorPool::allocate_set(
+            pool,
+            cip_descriptor_set_layout
+        );
 
-            bv::ColorBlendState color_blend_state{
-                .flags = 0,
-                .logic_op_enable = false,
-                .logic_op = VK_LOGIC_OP_COPY,
-                .attachments = { color_blend_attachment },
-                .blend_constants = { 0.f, 0.f, 0.f, 0.f }
-            };
+        bv::DescriptorImageInfo cost_img_info{
+            .sampler = std::nullopt,
+            .image_view = cost_imgview_to_use,
+            .image_layout = VK_IMAGE_LAYOUT_GENERAL
+        };
 
-            gwp_graphics_pipeline = bv::GraphicsPipeline::create(
-                state.device,
-                bv::GraphicsPipelineConfig{
-                    .flags = 0,
-                    .stages = { gwp_vert_shader_stage, gwp_frag_shader_stage },
-                    .vertex_input_state = bv::VertexInputState{
-                        .binding_descriptions = { GridVertex::binding },
-                        .attribute_descriptions = { gwp_vertex_attributes }
-                    },
-                    .input_assembly_state = bv::InputAssemblyState{
-                        .topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,
-                        .primitive_restart_enable = false
-                    },
-                    .tessellation_state = std::nullopt,
-                    .viewport_state = viewport_state,
-                    .rasterization_state = rasterization_state,
-                    .multisample_state = multisample_state,
-                    .depth_stencil_state = depth_stencil_state,
-                    .color_blend_state = color_blend_state,
-                    .dynamic_states = {
-                        VK_DYNAMIC_STATE_VIEWPORT,
-                        VK_DYNAMIC_STATE_SCISSOR
-                    },
-                    .layout = gwp_pipeline_layout,
-                    .render_pass = gwp_render_pass,
-                    .subpass_index = 0,
-                    .base_pipeline = std::nullopt
-                }
-            );
+        bv::DescriptorBufferInfo cost_info_buf_info{
+            .buffer = cost_info_buf_to_use,
+            .offset = 0,
+            .range = VK_WHOLE_SIZE
+        };
+
+        std::vector<bv::WriteDescriptorSet> descriptor_writes;
+
+        descriptor_writes.push_back({
+            .dst_set = descriptor_set,
+            .dst_binding = 0,
+            .dst_array_element = 0,
+            .descriptor_count = 1,
+            .descriptor_type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+            .image_infos = { cost_img_info },
+            .buffer_infos = {},
+            .texel_buffer_views = {}
+            });
+
+        descriptor_writes.push_back({
+            .dst_set = descriptor_set,
+            .dst_binding = 1,
+            .dst_array_element = 0,
+            .descriptor_count = 1,
+            .descriptor_type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+            .image_infos = {},
+            .buffer_infos = { cost_info_buf_info },
+            .texel_buffer_views = {}
+            });
+
+        bv::DescriptorSet::update_sets(state.device, descriptor_writes, {});
+        return descriptor_set;
+    }
+
+    bv::DescriptorSetPtr GridWarper::create_fcp_descriptor_set(
+        const bv::DescriptorPoolPtr& pool,
+        const bv::ImageViewPtr& warped_imgview_to_use,
+        const bv::BufferPtr& partial_sums_buf
+    )
+    {
+        auto descriptor_set = bv::DescriptorPool::allocate_set(
+            pool,
+            fcp_descriptor_set_layout
+        );
+
+        bv::DescriptorImageInfo warped_img_info{
+            .sampler = sampler,
+            .image_view = warped_imgview_to_use,
+            .image_layout = VK_IMAGE_LAYOUT_GENERAL
+        };
+
+        bv::DescriptorImageInfo target_log_img_info{
+            .sampler = sampler,
+            .image_view = target_log_imgview,
+            .image_layout = VK_IMAGE_LAYOUT_GENERAL
+        };
+
+        bv::DescriptorBufferInfo partial_sums_buf_info{
+            .buffer = partial_sums_buf,
+            .offset = 0,
+            .range = VK_WHOLE_SIZE
+        };
+
+        std::vector<bv::WriteDescriptorSet> descriptor_writes;
+
+        descriptor_writes.push_back({
+            .dst_set = descriptor_set,
+            .dst_binding = 0,
+            .dst_array_element = 0,
+            .descriptor_count = 1,
+            .descriptor_type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+            .image_infos = { warped_img_info },
+            .buffer_infos = {},
+            .texel_buffer_views = {}
+            });
+
+        descriptor_writes.push_back({
+            .dst_set = descriptor_set,
+            .dst_binding = 1,
+            .dst_array_element = 0,
+            .descriptor_count = 1,
+            .descriptor_type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+            .image_infos = { target_log_img_info },
+            .buffer_infos = {},
+            .texel_buffer_views = {}
+            });
+
+        descriptor_writes.push_back({
+            .dst_set = descriptor_set,
+            .dst_binding = 2,
+            .dst_array_element = 0,
+            .descriptor_count = 1,
+            .descriptor_type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+            .image_infos = {},
+            .buffer_infos = { partial_sums_buf_info },
+            .texel_buffer_views = {}
+            });
+
+        bv::DescriptorSet::update_sets(state.device, descriptor_writes, {});
+        return descriptor_set;
+    }
+
+    bv::DescriptorSetPtr GridWarper::create_crp_descriptor_set(
+        const bv::DescriptorPoolPtr& pool,
+        const bv::BufferPtr& partial_sums_buf,
+        const bv::ImageViewPtr& cost_imgview_to_use
+    )
+    {
+        auto descriptor_set = bv::DescriptorPool::allocate_set(
+            pool,
+            crp_descriptor_set_layout
+        );
+
+        bv::DescriptorBufferInfo partial_sums_buf_info{
+            .buffer = partial_sums_buf,
+            .offset = 0,
+            .range = VK_WHOLE_SIZE
+        };
+
+        bv::DescriptorImageInfo cost_img_info{
+            .sampler = std::nullopt,
+            .image_view = cost_imgview_to_use,
+            .image_layout = VK_IMAGE_LAYOUT_GENERAL
+        };
+
+        std::vector<bv::WriteDescriptorSet> descriptor_writes;
+
+        descriptor_writes.push_back({
+            .dst_set = descriptor_set,
+            .dst_binding = 0,
+            .dst_array_element = 0,
+            .descriptor_count = 1,
+            .descriptor_type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+            .image_infos = {},
+            .buffer_infos = { partial_sums_buf_info },
+            .texel_buffer_views = {}
+            });
+
+        descriptor_writes.push_back({
+            .dst_set = descriptor_set,
+            .dst_binding = 1,
+            .dst_array_element = 0,
+            .descriptor_count = 1,
+            .descriptor_type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+            .image_infos = { cost_img_info },
+            .buffer_infos = {},
+            .texel_buffer_views = {}
+            });
+
+        bv::DescriptorSet::update_sets(state.device, descriptor_writes, {});
+        return descriptor_set;
+    }
+
+    void GridWarper::create_cmd_bufs()
+    {
+        auto cmd_bufs = bv::CommandPool::allocate_buffers(
+            state.cmd_pool(),
+            VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+            3
+        );
+
+        // no VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT because we'll submit
+        // them many times. we always wait for the previous submission to
+        // finish so we don't need VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT
+        // either.
+
+        gwp_cmd_buf = cmd_bufs[0];
+        gwp_cmd_buf->begin(0);
+        record_grid_warp_pass(gwp_cmd_buf, gwp_framebuf, vertex_buf);
+        gwp_cmd_buf->end();
+
+        eval_cmd_buf = cmd_bufs[1];
+        eval_cmd_buf->begin(0);
+        record_evaluation(eval_cmd_buf, vertex_buf, cip_descriptor_set, true);
+        eval_cmd_buf->end();
+
+        eval_fused_cmd_buf = cmd_bufs[2];
+        eval_fused_cmd_buf->begin(0);
+        record_evaluation(
+            eval_fused_cmd_buf,
+            vertex_buf,
+            cip_descriptor_set,
+            false
+        );
+        record_cost_cache_readback(eval_fused_cmd_buf);
+        eval_fused_cmd_buf->end();
+
+        eval_fence = bv::Fence::create(state.device, 0);
+
+        dirty_cmd_pool = bv::CommandPool::create(
+            state.device,
+            {
+                .flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
+                .queue_family_index = state.queue_main->queue_family_index()
+            }
+        );
+        dirty_cmd_buf = bv::CommandPool::allocate_buffer(
+            dirty_cmd_pool,
+            VK_COMMAND_BUFFER_LEVEL_PRIMARY
+        );
+
+        // recorded in create_warped_hires_img() and reset when the image is
+        // released, so it needs a pool that allows resetting it too.
+        gwp_cmd_pool_hires = bv::CommandPool::create(
+            state.device,
+            {
+                .flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
+                .queue_family_index = state.queue_main->queue_family_index()
+            }
+        );
+        gwp_cmd_buf_hires = bv::CommandPool::allocate_buffer(
+            gwp_cmd_pool_hires,
+            VK_COMMAND_BUFFER_LEVEL_PRIMARY
+        );
+    }
+
+    void GridWarper::create_pipeline_slots(uint32_t pipeline_depth)
+    {
+        if (pipeline_depth < 1)
+        {
+            throw std::invalid_argument("pipeline depth must be at least 1");
         }
 
-        // grid warp pass: fence
-        gwp_fence = bv::Fence::create(state.device, 0);
+        auto cmd_bufs = bv::CommandPool::allocate_buffers(
+            state.cmd_pool(),
+            VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+            pipeline_depth
+        );
 
-        // difference pass: descriptor set layout
+        pipeline_descriptor_pool = create_cip_descriptor_pool(pipeline_depth);
+
+        pipeline_slots.resize(pipeline_depth);
+        for (uint32_t i = 0; i < pipeline_depth; i++)
         {
-            bv::DescriptorSetLayoutBinding binding_warped_img{
-                .binding = 0,
-                .descriptor_type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-                .descriptor_count = 1,
-                .stage_flags = VK_SHADER_STAGE_FRAGMENT_BIT,
-                .immutable_samplers = { sampler }
-            };
+            auto& slot = pipeline_slots[i];
 
-            bv::DescriptorSetLayoutBinding binding_target_img{
-                .binding = 1,
-                .descriptor_type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-                .descriptor_count = 1,
-                .stage_flags = VK_SHADER_STAGE_FRAGMENT_BIT,
-                .immutable_samplers = { sampler }
-            };
+            create_buffer(
+                state,
+                n_vertices * sizeof(glm::vec2),
+                VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
 
-            dfp_descriptor_set_layout = bv::DescriptorSetLayout::create(
-                state.device,
-                {
-                    .flags = 0,
-                    .bindings = { binding_warped_img, binding_target_img }
-                }
+                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT
+                | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+
+                slot.vertex_buf,
+                slot.vertex_buf_mem
             );
-        }
+            slot.vertex_buf_mapped = (glm::vec2*)slot.vertex_buf_mem->mapped();
 
-        // difference pass: descriptor pool
-        {
-            // 2 images in every descriptor set * 1 set in total
-            bv::DescriptorPoolSize image_pool_size{
-                .type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-                .descriptor_count = 2
-            };
+            create_buffer(
+                state,
+                sizeof(CostInfo),
+                VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
 
-            dfp_descriptor_pool = bv::DescriptorPool::create(
-                state.device,
-                {
-                    .flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT,
-                    .max_sets = 1,
-                    .pool_sizes = { image_pool_size }
-                }
+                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT
+                | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+
+                slot.cost_info_buf,
+                slot.cost_info_buf_mem
             );
-        }
+            slot.cost_info_buf_mapped =
+                (CostInfo*)slot.cost_info_buf_mem->mapped();
 
-        // difference pass: descriptor set
-        {
-            dfp_descriptor_set = bv::DescriptorPool::allocate_set(
-                dfp_descriptor_pool,
-                dfp_descriptor_set_layout
+            slot.cip_descriptor_set = create_cip_descriptor_set(
+                pipeline_descriptor_pool,
+                cost_imgview,
+                slot.cost_info_buf
             );
 
-            bv::DescriptorImageInfo warped_img_info{
-                .sampler = sampler,
-                .image_view = warped_imgview,
-                .image_layout = VK_IMAGE_LAYOUT_GENERAL
-            };
+            create_buffer(
+                state,
+                cost_res_x * cost_res_y * sizeof(float),
+                VK_BUFFER_USAGE_TRANSFER_DST_BIT,
 
-            bv::DescriptorImageInfo target_img_info{
-                .sampler = sampler,
-                .image_view = target_imgview,
-                .image_layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
-            };
+                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT
+                | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
 
-            std::vector<bv::WriteDescriptorSet> descriptor_writes;
+                slot.cost_cache_buf,
+                slot.cost_cache_buf_mem
+            );
+            slot.cost_cache_buf_mapped =
+                (float*)slot.cost_cache_buf_mem->mapped();
+
+            // the slots share the same images and partial sums buffer, and
+            // the previous submission might still be reading warped_img, the
+            // partial sums, or the cost image when this one starts writing to
+            // them.
+            slot.cmd_buf = cmd_bufs[i];
+            slot.cmd_buf->begin(0);
+
+            memory_barrier(
+                slot.cmd_buf,
+                VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT
+                | VK_PIPELINE_STAGE_TRANSFER_BIT,
+                VK_ACCESS_SHADER_WRITE_BIT,
+                VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT
+                | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                VK_ACCESS_SHADER_WRITE_BIT
+            );
 
-            descriptor_writes.push_back({
-                .dst_set = dfp_descriptor_set,
-                .dst_binding = 0,
-                .dst_array_element = 0,
-                .descriptor_count = 1,
-                .descriptor_type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-                .image_infos = { warped_img_info },
-                .buffer_infos = {},
-                .texel_buffer_views = {}
-                });
+            record_evaluation(
+                slot.cmd_buf,
+                slot.vertex_buf,
+                slot.cip_descriptor_set,
+                false
+            );
+            record_cost_cache_readback(
+                slot.cmd_buf,
+                std::nullopt,
+                slot.cost_cache_buf
+            );
+            slot.cmd_buf->end();
 
-            descriptor_writes.push_back({
-                .dst_set = dfp_descriptor_set,
-                .dst_binding = 1,
-                .dst_array_element = 0,
-                .descriptor_count = 1,
-                .descriptor_type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-                .image_infos = { target_img_info },
-                .buffer_infos = {},
-                .texel_buffer_views = {}
-                });
+            slot.fence = bv::Fence::create(state.device, 0);
 
-            bv::DescriptorSet::update_sets(state.device, descriptor_writes, {});
+            pipeline_free_slots.push_back(i);
         }
+    }
 
-        // difference pass: render pass
-        {
-            bv::Attachment color_attachment{
-                .flags = 0,
-                .format = VK_FORMAT_R32_SFLOAT,
-                .samples = VK_SAMPLE_COUNT_1_BIT,
-                .load_op = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
-                .store_op = VK_ATTACHMENT_STORE_OP_STORE,
-                .stencil_load_op = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
-                .stencil_store_op = VK_ATTACHMENT_STORE_OP_DONT_CARE,
-                .initial_layout = VK_IMAGE_LAYOUT_UNDEFINED,
-                .final_layout = VK_IMAGE_LAYOUT_GENERAL
-            };
+    void GridWarper::create_batch_resources(const bv::QueuePtr& queue)
+    {
+        // vertex buffer with a region for every candidate
+        create_buffer(
+            state,
+            batch_size * n_vertices * sizeof(glm::vec2),
+            VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
 
-            bv::AttachmentReference color_attachment_ref{
-                .attachment = 0,
-                .layout = VK_IMAGE_LAYOUT_GENERAL
-            };
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT
+            | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
 
-            bv::Subpass subpass{
-                .flags = 0,
-                .pipeline_bind_point = VK_PIPELINE_BIND_POINT_GRAPHICS,
-                .input_attachments = {},
-                .color_attachments = { color_attachment_ref },
-                .resolve_attachments = {},
-                .depth_stencil_attachment = std::nullopt,
-                .preserve_attachment_indices = {}
-            };
+            batch_vertex_buf,
+            batch_vertex_buf_mem
+        );
+        batch_vertex_buf_mapped = (glm::vec2*)batch_vertex_buf_mem->mapped();
 
-            bv::SubpassDependency dependency{
-                .src_subpass = VK_SUBPASS_EXTERNAL,
-                .dst_subpass = 0,
-                .src_stage_mask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-                .dst_stage_mask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-                .src_access_mask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
-                .dst_access_mask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
-                .dependency_flags = 0
-            };
+        // layered images, same formats and resolutions as their non-batched
+        // counterparts
 
-            dfp_render_pass = bv::RenderPass::create(
-                state.device,
-                bv::RenderPassConfig{
-                    .flags = 0,
-                    .attachments = { color_attachment },
-                    .subpasses = { subpass },
-                    .dependencies = { dependency }
-                }
-            );
-        }
+        create_image(
+            state,
+            intermediate_res_x,
+            intermediate_res_y,
+            1,
+            VK_SAMPLE_COUNT_1_BIT,
+            warped_img_format,
+            VK_IMAGE_TILING_OPTIMAL,
+            VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+            batch_warped_img,
+            batch_warped_img_mem,
+            batch_size
+        );
 
-        // difference pass: framebuffer
-        dfp_framebuf = bv::Framebuffer::create(
-            state.device,
-            bv::FramebufferConfig{
-                .flags = 0,
-                .render_pass = dfp_render_pass,
-                .attachments = { difference_imgview },
-                .width = difference_img->config().extent.width,
-                .height = difference_img->config().extent.height,
-                .layers = 1
-            }
+        create_image(
+            state,
+            cost_res_x,
+            cost_res_y,
+            1,
+            VK_SAMPLE_COUNT_1_BIT,
+            VK_FORMAT_R32_SFLOAT,
+            VK_IMAGE_TILING_OPTIMAL,
+            VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+            batch_cost_img,
+            batch_cost_img_mem,
+            batch_size
         );
 
-        // difference pass: pipeline layout
         {
-            bv::PushConstantRange frag_push_constant_range{
-                .stage_flags = VK_SHADER_STAGE_FRAGMENT_BIT,
-                .offset = 0,
-                .size = sizeof(DifferencePassFragPushConstants)
-            };
-
-            dfp_pipeline_layout = bv::PipelineLayout::create(
-                state.device,
-                bv::PipelineLayoutConfig{
-                    .flags = 0,
-                    .set_layouts = { dfp_descriptor_set_layout },
-                    .push_constant_ranges = { frag_push_constant_range }
-                }
-            );
+            auto cmd_buf = begin_single_time_commands(state);
+            for (auto& img : { batch_warped_img, batch_cost_img })
+            {
+                transition_image_layout(
+                    cmd_buf,
+                    img,
+                    VK_IMAGE_LAYOUT_UNDEFINED,
+                    VK_IMAGE_LAYOUT_GENERAL,
+                    1
+                );
+            }
+            end_single_time_commands(state, cmd_buf, queue);
         }
 
-        // difference pass: graphics pipeline
-        {
-            bv::Viewport viewport{
-                .x = 0.f,
-                .y = 0.f,
-                .width = (float)dfp_framebuf->config().width,
-                .height = (float)dfp_framebuf->config().height,
-                .min_depth = 0.f,
-                .max_depth = 1.f
-            };
-
-            bv::Rect2d scissor{
-                .offset = { 0, 0 },
-                .extent = {
-                    dfp_framebuf->config().width,
-                    dfp_framebuf->config().height
-                }
-            };
-
-            bv::ViewportState viewport_state{
-                .viewports = { viewport },
-                .scissors = { scissor }
-            };
+        // host visible copy of every layer of the cost image, one after
+        // another, and a tree for every candidate
+        create_buffer(
+            state,
+            batch_size * cost_res_x * cost_res_y * sizeof(float),
+            VK_BUFFER_USAGE_TRANSFER_DST_BIT,
 
-            bv::RasterizationState rasterization_state{
-                .depth_clamp_enable = false,
-                .rasterizer_discard_enable = false,
-                .polygon_mode = VK_POLYGON_MODE_FILL,
-                .cull_mode = VK_CULL_MODE_BACK_BIT,
-                .front_face = VK_FRONT_FACE_CLOCKWISE,
-                .depth_bias_enable = false,
-                .depth_bias_constant_factor = 0.f,
-                .depth_bias_clamp = 0.f,
-                .depth_bias_slope_factor = 0.f,
-                .line_width = 1.f
-            };
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT
+            | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
 
-            bv::MultisampleState multisample_state{
-                .rasterization_samples = VK_SAMPLE_COUNT_1_BIT,
-                .sample_shading_enable = false,
-                .min_sample_shading = 1.f,
-                .sample_mask = {},
-                .alpha_to_coverage_enable = false,
-                .alpha_to_one_enable = false
-            };
+            batch_cost_cache_buf,
+            batch_cost_cache_buf_mem
+        );
+        batch_cost_cache_buf_mapped =
+            (float*)batch_cost_cache_buf_mem->mapped();
+        batch_cost_trees.assign(
+            batch_size,
+            SumMaxTree(cost_res_x * cost_res_y)
+        );
 
-            bv::DepthStencilState depth_stencil_state{
-                .flags = 0,
-                .depth_test_enable = false,
-                .depth_write_enable = false,
-                .depth_compare_op = VK_COMPARE_OP_LESS,
-                .depth_bounds_test_enable = false,
-                .stencil_test_enable = false,
-                .front = {},
-                .back = {},
-                .min_depth_bounds = 0.f,
-                .max_depth_bounds = 1.f
+        // descriptor pool for the fused cost pass and the cost reduction
+        // pass, batch_size sets each
+        {
+            // 2 sampled images in every fused cost pass descriptor set
+            bv::DescriptorPoolSize image_pool_size{
+                .type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                .descriptor_count = 2 * batch_size
             };
 
-            bv::ColorBlendAttachment color_blend_attachment{
-                .blend_enable = false,
-                .src_color_blend_factor = VK_BLEND_FACTOR_ONE,
-                .dst_color_blend_factor = VK_BLEND_FACTOR_ZERO,
-                .color_blend_op = VK_BLEND_OP_ADD,
-                .src_alpha_blend_factor = VK_BLEND_FACTOR_ONE,
-                .dst_alpha_blend_factor = VK_BLEND_FACTOR_ZERO,
-                .alpha_blend_op = VK_BLEND_OP_ADD,
-                .color_write_mask =
-                VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT
-                | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT
+            // 1 buffer in every descriptor set
+            bv::DescriptorPoolSize buffer_pool_size{
+                .type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                .descriptor_count = 2 * batch_size
             };
 
-            bv::ColorBlendState color_blend_state{
-                .flags = 0,
-                .logic_op_enable = false,
-                .logic_op = VK_LOGIC_OP_COPY,
-                .attachments = { color_blend_attachment },
-                .blend_constants = { 0.f, 0.f, 0.f, 0.f }
+            // 1 storage image in every cost reduction pass descriptor set
+            bv::DescriptorPoolSize storage_image_pool_size{
+                .type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+                .descriptor_count = batch_size
             };
 
-            dfp_graphics_pipeline = bv::GraphicsPipeline::create(
+            batch_descriptor_pool = bv::DescriptorPool::create(
                 state.device,
-                bv::GraphicsPipelineConfig{
-                    .flags = 0,
-                    .stages = {
-                        fullscreen_quad_vert_shader_stage,
-                        dfp_frag_shader_stage
-                    },
-                    .vertex_input_state = bv::VertexInputState{
-                        .binding_descriptions = {},
-                        .attribute_descriptions = {}
-                    },
-                    .input_assembly_state = bv::InputAssemblyState{
-                        .topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,
-                        .primitive_restart_enable = false
-                    },
-                    .tessellation_state = std::nullopt,
-                    .viewport_state = viewport_state,
-                    .rasterization_state = rasterization_state,
-                    .multisample_state = multisample_state,
-                    .depth_stencil_state = depth_stencil_state,
-                    .color_blend_state = color_blend_state,
-                    .dynamic_states = {},
-                    .layout = dfp_pipeline_layout,
-                    .render_pass = dfp_render_pass,
-                    .subpass_index = 0,
-                    .base_pipeline = std::nullopt
+                {
+                    .flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT,
+                    .max_sets = 2 * batch_size,
+                    .pool_sizes = {
+                        image_pool_size,
+                        buffer_pool_size,
+                        storage_image_pool_size
+                    }
                 }
             );
         }
 
-        // difference pass: fence
-        dfp_fence = bv::Fence::create(state.device, 0);
-
-        // cost pass: descriptor set layout
+        // image views, framebuffers, partial sums buffers, and descriptor sets
+        // for every layer
+        for (uint32_t i = 0; i < batch_size; i++)
         {
-            bv::DescriptorSetLayoutBinding binding_difference_img{
-                .binding = 0,
-                .descriptor_type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-                .descriptor_count = 1,
-                .stage_flags = VK_SHADER_STAGE_FRAGMENT_BIT,
-                .immutable_samplers = { sampler }
-            };
-
-            csp_descriptor_set_layout = bv::DescriptorSetLayout::create(
+            batch_warped_imgviews.push_back(create_image_view(
+                state,
+                batch_warped_img,
+                warped_img_format,
+                VK_IMAGE_ASPECT_COLOR_BIT,
+                1,
+                i
+            ));
+            batch_cost_imgviews.push_back(create_image_view(
+                state,
+                batch_cost_img,
+                VK_FORMAT_R32_SFLOAT,
+                VK_IMAGE_ASPECT_COLOR_BIT,
+                1,
+                i
+            ));
+
+            batch_gwp_framebufs.push_back(bv::Framebuffer::create(
                 state.device,
-                {
+                bv::FramebufferConfig{
                     .flags = 0,
-                    .bindings = { binding_difference_img }
+                    .render_pass = gwp_render_pass,
+                    .attachments = { batch_warped_imgviews[i] },
+                    .width = intermediate_res_x,
+                    .height = intermediate_res_y,
+                    .layers = 1
                 }
+            ));
+
+            bv::BufferPtr partial_sums_buf = nullptr;
+            bv::MemoryChunkPtr partial_sums_buf_mem = nullptr;
+            create_buffer(
+                state,
+                cost_res_x * cost_res_y * n_cost_chunks * sizeof(glm::vec2),
+                VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                partial_sums_buf,
+                partial_sums_buf_mem
             );
+            batch_partial_sums_bufs.push_back(partial_sums_buf);
+            batch_partial_sums_buf_mems.push_back(partial_sums_buf_mem);
+
+            batch_fcp_descriptor_sets.push_back(create_fcp_descriptor_set(
+                batch_descriptor_pool,
+                batch_warped_imgviews[i],
+                partial_sums_buf
+            ));
+            batch_crp_descriptor_sets.push_back(create_crp_descriptor_set(
+                batch_descriptor_pool,
+                partial_sums_buf,
+                batch_cost_imgviews[i]
+            ));
         }
 
-        // cost pass: descriptor pool
-        {
-            // 1 image in every descriptor set * 1 set in total
-            bv::DescriptorPoolSize image_pool_size{
-                .type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-                .descriptor_count = 1
-            };
+        // record the command buffer. we render all candidates before running
+        // the fused cost pass on all of them, and the same with the cost
+        // reduction pass, so we only need one barrier between every stage.
 
-            csp_descriptor_pool = bv::DescriptorPool::create(
-                state.device,
-                {
-                    .flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT,
-                    .max_sets = 1,
-                    .pool_sizes = { image_pool_size }
-                }
+        batch_cmd_buf = bv::CommandPool::allocate_buffer(
+            state.cmd_pool(),
+            VK_COMMAND_BUFFER_LEVEL_PRIMARY
+        );
+        batch_cmd_buf->begin(0);
+
+        for (uint32_t i = 0; i < batch_size; i++)
+        {
+            record_grid_warp_pass(
+                batch_cmd_buf,
+                batch_gwp_framebufs[i],
+                batch_vertex_buf,
+                i * n_vertices * sizeof(glm::vec2)
             );
         }
 
-        // cost pass: descriptor set
+        image_memory_barrier(
+            batch_cmd_buf,
+            batch_warped_img,
+            VK_IMAGE_LAYOUT_GENERAL,
+            VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+            VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            VK_ACCESS_SHADER_READ_BIT
+        );
+        for (uint32_t i = 0; i < batch_size; i++)
         {
-            csp_descriptor_set = bv::DescriptorPool::allocate_set(
-                csp_descriptor_pool,
-                csp_descriptor_set_layout
+            record_cost_pass(batch_cmd_buf, true, batch_fcp_descriptor_sets[i]);
+        }
+
+        record_partial_sums_barrier(batch_cmd_buf);
+        for (uint32_t i = 0; i < batch_size; i++)
+        {
+            record_cost_reduction_pass(
+                batch_cmd_buf,
+                batch_crp_descriptor_sets[i]
             );
+        }
+        record_cost_cache_readback(
+            batch_cmd_buf,
+            std::nullopt,
+            batch_cost_cache_buf,
+            batch_cost_img
+        );
 
-            bv::DescriptorImageInfo difference_img_info{
-                .sampler = sampler,
-                .image_view = difference_imgview,
-                .image_layout = VK_IMAGE_LAYOUT_GENERAL
-            };
+        batch_cmd_buf->end();
 
-            std::vector<bv::WriteDescriptorSet> descriptor_writes;
-            descriptor_writes.push_back({
-                .dst_set = csp_descriptor_set,
-                .dst_binding = 0,
-                .dst_array_element = 0,
-                .descriptor_count = 1,
-                .descriptor_type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-                .image_infos = { difference_img_info },
-                .buffer_infos = {},
-                .texel_buffer_views = {}
-                });
-            bv::DescriptorSet::update_sets(state.device, descriptor_writes, {});
-        }
+        batch_fence = bv::Fence::create(state.device, 0);
+    }
 
-        // cost pass: render pass
-        {
-            bv::Attachment color_attachment{
-                .flags = 0,
-                .format = VK_FORMAT_R32_SFLOAT,
-                .samples = VK_SAMPLE_COUNT_1_BIT,
-                .load_op = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
-                .store_op = VK_ATTACHMENT_STORE_OP_STORE,
-                .stencil_load_op = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
-                .stencil_store_op = VK_ATTACHMENT_STORE_OP_DONT_CARE,
-                .initial_layout = VK_IMAGE_LAYOUT_UNDEFINED,
-                .final_layout = VK_IMAGE_LAYOUT_GENERAL
-            };
+    void GridWarper::create_resident_resources()
+    {
+        // candidate vertices, only touched by the GPU
+        create_buffer(
+            state,
+            n_vertices * sizeof(glm::vec2),
+            VK_BUFFER_USAGE_VERTEX_BUFFER_BIT
+            | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+            resident_candidate_vertex_buf,
+            resident_candidate_vertex_buf_mem
+        );
 
-            bv::AttachmentReference color_attachment_ref{
-                .attachment = 0,
-                .layout = VK_IMAGE_LAYOUT_GENERAL
-            };
+        // displacements, written by the host before every submission
+        create_buffer(
+            state,
+            resident_iters * sizeof(WarpParams),
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
 
-            bv::Subpass subpass{
-                .flags = 0,
-                .pipeline_bind_point = VK_PIPELINE_BIND_POINT_GRAPHICS,
-                .input_attachments = {},
-                .color_attachments = { color_attachment_ref },
-                .resolve_attachments = {},
-                .depth_stencil_attachment = std::nullopt,
-                .preserve_attachment_indices = {}
-            };
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT
+            | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
 
-            bv::SubpassDependency dependency{
-                .src_subpass = VK_SUBPASS_EXTERNAL,
-                .dst_subpass = 0,
-                .src_stage_mask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-                .dst_stage_mask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-                .src_access_mask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
-                .dst_access_mask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
-                .dependency_flags = 0
-            };
+            resident_warp_buf,
+            resident_warp_buf_mem
+        );
+        resident_warp_buf_mapped = (WarpParams*)resident_warp_buf_mem->mapped();
 
-            csp_render_pass = bv::RenderPass::create(
-                state.device,
-                bv::RenderPassConfig{
-                    .flags = 0,
-                    .attachments = { color_attachment },
-                    .subpasses = { subpass },
-                    .dependencies = { dependency }
-                }
-            );
-        }
+        // state, initialized by the host (except last_avg_diff, see below) and
+        // read back after every submission
+        create_buffer(
+            state,
+            sizeof(ResidentState),
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT
+            | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
 
-        // cost pass: framebuffer
-        csp_framebuf = bv::Framebuffer::create(
-            state.device,
-            bv::FramebufferConfig{
-                .flags = 0,
-                .render_pass = csp_render_pass,
-                .attachments = { cost_imgview },
-                .width = cost_img->config().extent.width,
-                .height = cost_img->config().extent.height,
-                .layers = 1
-            }
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT
+            | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+
+            resident_state_buf,
+            resident_state_buf_mem
         );
+        resident_state_buf_mapped =
+            (ResidentState*)resident_state_buf_mem->mapped();
 
-        // cost pass: pipeline layout
+        // cost info for the current candidate, never read by the host
+        create_buffer(
+            state,
+            sizeof(CostInfo),
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT
+            | VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+            resident_cost_info_buf,
+            resident_cost_info_buf_mem
+        );
+
+        // cost after every iteration
+        create_buffer(
+            state,
+            resident_iters * sizeof(float),
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT
+            | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+
+            resident_history_buf,
+            resident_history_buf_mem
+        );
+        resident_history_buf_mapped =
+            (float*)resident_history_buf_mem->mapped();
+
+        // descriptor pool for the cost info pass, the displacement pass, and
+        // the accept pass
         {
-            bv::PushConstantRange frag_push_constant_range{
-                .stage_flags = VK_SHADER_STAGE_FRAGMENT_BIT,
-                .offset = 0,
-                .size = sizeof(CostPassFragPushConstants)
+            // 1 storage image in the cost info pass descriptor set
+            bv::DescriptorPoolSize storage_image_pool_size{
+                .type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+                .descriptor_count = 1
             };
 
-            csp_pipeline_layout = bv::PipelineLayout::create(
+            // 1 + 4 + 3 buffers
+            bv::DescriptorPoolSize buffer_pool_size{
+                .type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                .descriptor_count = 8
+            };
+
+            resident_descriptor_pool = bv::DescriptorPool::create(
                 state.device,
-                bv::PipelineLayoutConfig{
-                    .flags = 0,
-                    .set_layouts = { csp_descriptor_set_layout },
-                    .push_constant_ranges = { frag_push_constant_range }
+                {
+                    .flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT,
+                    .max_sets = 3,
+                    .pool_sizes = { storage_image_pool_size, buffer_pool_size }
                 }
             );
         }
 
-        // cost pass: graphics pipeline
+        resident_cip_descriptor_set = create_cip_descriptor_set(
+            resident_descriptor_pool,
+            cost_imgview,
+            resident_cost_info_buf
+        );
+
+        // displacement pass and accept pass: descriptor sets
         {
-            bv::Viewport viewport{
-                .x = 0.f,
-                .y = 0.f,
-                .width = (float)csp_framebuf->config().width,
-                .height = (float)csp_framebuf->config().height,
-                .min_depth = 0.f,
-                .max_depth = 1.f
-            };
+            dsp_descriptor_set = bv::DescriptorPool::allocate_set(
+                resident_descriptor_pool,
+                dsp_descriptor_set_layout
+            );
+            acp_descriptor_set = bv::DescriptorPool::allocate_set(
+                resident_descriptor_pool,
+                acp_descriptor_set_layout
+            );
 
-            bv::Rect2d scissor{
-                .offset = { 0, 0 },
-                .extent = {
-                    csp_framebuf->config().width,
-                    csp_framebuf->config().height
-                }
+            auto buf_info = [](const bv::BufferPtr& buf)
+            {
+                return bv::DescriptorBufferInfo{
+                    .buffer = buf,
+                    .offset = 0,
+                    .range = VK_WHOLE_SIZE
+                };
             };
 
-            bv::ViewportState viewport_state{
-                .viewports = { viewport },
-                .scissors = { scissor }
-            };
+            std::vector<bv::WriteDescriptorSet> descriptor_writes;
 
-            bv::RasterizationState rasterization_state{
-                .depth_clamp_enable = false,
-                .rasterizer_discard_enable = false,
-                .polygon_mode = VK_POLYGON_MODE_FILL,
-                .cull_mode = VK_CULL_MODE_BACK_BIT,
-                .front_face = VK_FRONT_FACE_CLOCKWISE,
-                .depth_bias_enable = false,
-                .depth_bias_constant_factor = 0.f,
-                .depth_bias_clamp = 0.f,
-                .depth_bias_slope_factor = 0.f,
-                .line_width = 1.f
+            std::vector<std::pair<
+                bv::DescriptorSetPtr,
+                std::vector<bv::BufferPtr>
+                >> sets_and_bufs{
+                {
+                    dsp_descriptor_set,
+                    {
+                        vertex_buf,
+                        resident_candidate_vertex_buf,
+                        resident_warp_buf,
+                        resident_state_buf
+                    }
+                },
+                {
+                    acp_descriptor_set,
+                    {
+                        resident_cost_info_buf,
+                        resident_state_buf,
+                        resident_history_buf
+                    }
+                }
             };
+            for (const auto& [descriptor_set, bufs] : sets_and_bufs)
+            {
+                for (uint32_t i = 0; i < (uint32_t)bufs.size(); i++)
+                {
+                    descriptor_writes.push_back({
+                        .dst_set = descriptor_set,
+                        .dst_binding = i,
+                        .dst_array_element = 0,
+                        .descriptor_count = 1,
+                        .descriptor_type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                        .image_infos = {},
+                        .buffer_infos = { buf_info(bufs[i]) },
+                        .texel_buffer_views = {}
+                        });
+                }
+            }
 
-            bv::MultisampleState multisample_state{
-                .rasterization_samples = VK_SAMPLE_COUNT_1_BIT,
-                .sample_shading_enable = false,
-                .min_sample_shading = 1.f,
-                .sample_mask = {},
-                .alpha_to_coverage_enable = false,
-                .alpha_to_one_enable = false
-            };
+            bv::DescriptorSet::update_sets(
+                state.device,
+                descriptor_writes,
+                {}
+            );
+        }
 
-            bv::DepthStencilState depth_stencil_state{
-                .flags = 0,
-                .depth_test_enable = false,
-                .depth_write_enable = false,
-                .depth_compare_op = VK_COMPARE_OP_LESS,
-                .depth_bounds_test_enable = false,
-                .stencil_test_enable = false,
-                .front = {},
-                .back = {},
-                .min_depth_bounds = 0.f,
-                .max_depth_bounds = 1.f
-            };
+        // record the command buffer. every iteration displaces, renders, and
+        // evaluates a candidate, then the accept pass decides whether the
+        // next displacement pass should copy it to the accepted vertices.
 
-            bv::ColorBlendAttachment color_blend_attachment{
-                .blend_enable = false,
-                .src_color_blend_factor = VK_BLEND_FACTOR_ONE,
-                .dst_color_blend_factor = VK_BLEND_FACTOR_ZERO,
-                .color_blend_op = VK_BLEND_OP_ADD,
-                .src_alpha_blend_factor = VK_BLEND_FACTOR_ONE,
-                .dst_alpha_blend_factor = VK_BLEND_FACTOR_ZERO,
-                .alpha_blend_op = VK_BLEND_OP_ADD,
-                .color_write_mask =
-                VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT
-                | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT
-            };
+        resident_cmd_buf = bv::CommandPool::allocate_buffer(
+            state.cmd_pool(),
+            VK_COMMAND_BUFFER_LEVEL_PRIMARY
+        );
+        resident_cmd_buf->begin(0);
 
-            bv::ColorBlendState color_blend_state{
-                .flags = 0,
-                .logic_op_enable = false,
-                .logic_op = VK_LOGIC_OP_COPY,
-                .attachments = { color_blend_attachment },
-                .blend_constants = { 0.f, 0.f, 0.f, 0.f }
+        // evaluate the accepted vertices first and start from their cost.
+        // the host's last_avg_diff comes from the cost cache tree, which sums
+        // in a different order than the cost info pass the accept pass reads.
+        record_evaluation(
+            resident_cmd_buf,
+            vertex_buf,
+            resident_cip_descriptor_set,
+            false
+        );
+        buffer_memory_barrier(
+            resident_cmd_buf,
+            resident_cost_info_buf,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            VK_ACCESS_SHADER_WRITE_BIT,
+            VK_PIPELINE_STAGE_TRANSFER_BIT,
+            VK_ACCESS_TRANSFER_READ_BIT
+        );
+        {
+            VkBufferCopy copy_region{
+                .srcOffset = offsetof(CostInfo, avg_diff),
+                .dstOffset = offsetof(ResidentState, last_avg_diff),
+                .size = sizeof(float)
             };
+            vkCmdCopyBuffer(
+                resident_cmd_buf->handle(),
+                resident_cost_info_buf->handle(),
+                resident_state_buf->handle(),
+                1, &copy_region
+            );
+        }
+        buffer_memory_barrier(
+            resident_cmd_buf,
+            resident_state_buf,
+            VK_PIPELINE_STAGE_TRANSFER_BIT,
+            VK_ACCESS_TRANSFER_WRITE_BIT,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT
+        );
 
-            csp_graphics_pipeline = bv::GraphicsPipeline::create(
-                state.device,
-                bv::GraphicsPipelineConfig{
-                    .flags = 0,
-                    .stages = {
-                        fullscreen_quad_vert_shader_stage,
-                        csp_frag_shader_stage
-                    },
-                    .vertex_input_state = bv::VertexInputState{
-                        .binding_descriptions = {},
-                        .attribute_descriptions = {}
-                    },
-                    .input_assembly_state = bv::InputAssemblyState{
-                        .topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,
-                        .primitive_restart_enable = false
-                    },
-                    .tessellation_state = std::nullopt,
-                    .viewport_state = viewport_state,
-                    .rasterization_state = rasterization_state,
-                    .multisample_state = multisample_state,
-                    .depth_stencil_state = depth_stencil_state,
-                    .color_blend_state = color_blend_state,
-                    .dynamic_states = {},
-                    .layout = csp_pipeline_layout,
-                    .render_pass = csp_render_pass,
-                    .subpass_index = 0,
-                    .base_pipeline = std::nullopt
-                }
+        for (uint32_t i = 0; i < resident_iters; i++)
+        {
+            // wait for the accept pass (or a previous submission) to write the
+            // state, and for the previous iteration to be done with the
+            // candidate vertices and the images.
+            memory_barrier(
+                resident_cmd_buf,
+                VK_PIPELINE_STAGE_VERTEX_INPUT_BIT
+                | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                VK_ACCESS_SHADER_WRITE_BIT,
+                VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT
+            );
+            record_displacement_pass(resident_cmd_buf, i, false);
+
+            memory_barrier(
+                resident_cmd_buf,
+                VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                VK_ACCESS_SHADER_WRITE_BIT,
+                VK_PIPELINE_STAGE_VERTEX_INPUT_BIT
+                | VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT
+            );
+            record_grid_warp_pass(
+                resident_cmd_buf,
+                gwp_framebuf,
+                resident_candidate_vertex_buf
+            );
+
+            image_memory_barrier(
+                resident_cmd_buf,
+                warped_img,
+                VK_IMAGE_LAYOUT_GENERAL,
+                VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+                VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                VK_ACCESS_SHADER_READ_BIT
+            );
+            record_cost_pass(resident_cmd_buf, true, fcp_descriptor_set);
+            record_partial_sums_barrier(resident_cmd_buf);
+            record_cost_reduction_pass(resident_cmd_buf, crp_descriptor_set);
+            record_cost_info_pass(
+                resident_cmd_buf,
+                cost_img,
+                { resident_cip_descriptor_set }
+            );
+
+            memory_barrier(
+                resident_cmd_buf,
+                VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                VK_ACCESS_SHADER_WRITE_BIT,
+                VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                VK_ACCESS_SHADER_READ_BIT
             );
+            record_accept_pass(resident_cmd_buf, i);
         }
 
-        // cost pass: fence
-        csp_fence = bv::Fence::create(state.device, 0);
+        // copy the last candidate to the accepted vertices if it was kept and
+        // make everything visible to the host
+        memory_barrier(
+            resident_cmd_buf,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            VK_ACCESS_SHADER_WRITE_BIT,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT
+        );
+        record_displacement_pass(resident_cmd_buf, 0, true);
+        memory_barrier(
+            resident_cmd_buf,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            VK_ACCESS_SHADER_WRITE_BIT,
+            VK_PIPELINE_STAGE_HOST_BIT,
+            VK_ACCESS_HOST_READ_BIT
+        );
+
+        resident_cmd_buf->end();
+
+        resident_fence = bv::Fence::create(state.device, 0);
     }
 
-    bv::CommandBufferPtr GridWarper::create_grid_warp_pass_cmd_buf(bool hires)
+    void GridWarper::record_evaluation(
+        const bv::CommandBufferPtr& cmd_buf,
+        const bv::BufferPtr& vertex_buf_to_use,
+        const bv::DescriptorSetPtr& cip_descriptor_set_to_use,
+        bool update_difference_img,
+        const GridWarpPassVertPushConstants& gwp_vert_push_constants
+    )
     {
-        bv::CommandBufferPtr cmd_buf = begin_single_time_commands(state, true);
+        record_grid_warp_pass(
+            cmd_buf,
+            gwp_framebuf,
+            vertex_buf_to_use,
+            0,
+            std::nullopt,
+            gwp_vert_push_constants
+        );
+
+        if (update_difference_img)
+        {
+            // every pass samples what the previous one rendered so we need to
+            // wait for the color attachment writes before the shader reads.
+
+            image_memory_barrier(
+                cmd_buf,
+                warped_img,
+                VK_IMAGE_LAYOUT_GENERAL,
+                VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+                VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                VK_ACCESS_SHADER_READ_BIT
+            );
+
+            record_difference_pass(cmd_buf, dfp_framebuf, dfp_descriptor_set);
+            image_memory_barrier(
+                cmd_buf,
+                difference_img,
+                VK_IMAGE_LAYOUT_GENERAL,
+                VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+                VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                VK_ACCESS_SHADER_READ_BIT
+            );
+
+            record_cost_pass(cmd_buf, false, csp_descriptor_set);
+        }
+        else
+        {
+            image_memory_barrier(
+                cmd_buf,
+                warped_img,
+                VK_IMAGE_LAYOUT_GENERAL,
+                VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+                VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                VK_ACCESS_SHADER_READ_BIT
+            );
+
+            record_cost_pass(cmd_buf, true, fcp_descriptor_set);
+        }
 
+        record_partial_sums_barrier(cmd_buf);
+        record_cost_reduction_pass(cmd_buf, crp_descriptor_set);
+        record_cost_info_pass(cmd_buf, cost_img, { cip_descriptor_set_to_use });
+    }
+
+    void GridWarper::record_grid_warp_pass(
+        const bv::CommandBufferPtr& cmd_buf,
+        const bv::FramebufferPtr& framebuf,
+        const bv::BufferPtr& vertex_buf_to_use,
+        VkDeviceSize vertex_buf_offset,
+        const std::optional<VkRect2D>& dirty_rect,
+        const GridWarpPassVertPushConstants& vert_push_constants,
+        const std::vector<BaseTileDraw>& base_tile_draws
+    )
+    {
         VkClearValue clear_val{};
         clear_val.color = { { 0.f, 0.f, 0.f, 0.f } };
 
-        auto& framebuf = (hires ? gwp_framebuf_hires : gwp_framebuf);
+        VkRect2D render_area = dirty_rect.value_or(VkRect2D{
+            .offset = { 0, 0 },
+            .extent = { framebuf->config().width, framebuf->config().height }
+            });
+
+        // the high-resolution framebuffers might have a different format
+        bool hires =
+            (framebuf == gwp_framebuf_hires || framebuf == gwp_framebuf_tile);
 
         VkRenderPassBeginInfo render_pass_info{
             .sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,
             .pNext = nullptr,
-            .renderPass = gwp_render_pass->handle(),
+            .renderPass = hires
+            ? gwp_render_pass_hires->handle()
+            : dirty_rect
+            ? gwp_render_pass_load->handle()
+            : gwp_render_pass->handle(),
             .framebuffer = framebuf->handle(),
-            .renderArea = VkRect2D{
-                .offset = { 0, 0 },
-                .extent = {
-                    framebuf->config().width,
-                    framebuf->config().height
-                }
-            },
+            .renderArea = render_area,
             .clearValueCount = 1,
             .pClearValues = &clear_val
         };
@@ -1807,20 +5160,49 @@ namespace img_aligner::grid_warp
             VK_SUBPASS_CONTENTS_INLINE
         );
 
+        // the load op doesn't clear in this case so do it manually in the
+        // dirty rectangle only
+        if (dirty_rect)
+        {
+            VkClearAttachment clear_attachment{
+                .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                .colorAttachment = 0,
+                .clearValue = clear_val
+            };
+            VkClearRect clear_rect{
+                .rect = *dirty_rect,
+                .baseArrayLayer = 0,
+                .layerCount = 1
+            };
+            vkCmdClearAttachments(
+                cmd_buf->handle(),
+                1,
+                &clear_attachment,
+                1,
+                &clear_rect
+            );
+        }
+
         vkCmdBindPipeline(
             cmd_buf->handle(),
             VK_PIPELINE_BIND_POINT_GRAPHICS,
-            gwp_graphics_pipeline->handle()
+            hires
+            ? gwp_graphics_pipeline_hires->handle()
+            : gwp_graphics_pipeline->handle()
         );
 
-        VkBuffer vk_vertex_buf = vertex_buf->handle();
-        VkDeviceSize vertex_buf_offset = 0;
+        // warped positions and original positions, see gwp_vertex_bindings
+        VkBuffer vk_vertex_bufs[2]{
+            vertex_buf_to_use->handle(),
+            orig_pos_buf->handle()
+        };
+        VkDeviceSize vertex_buf_offsets[2]{ vertex_buf_offset, 0 };
         vkCmdBindVertexBuffers(
             cmd_buf->handle(),
             0,
-            1,
-            &vk_vertex_buf,
-            &vertex_buf_offset
+            2,
+            vk_vertex_bufs,
+            vertex_buf_offsets
         );
 
         vkCmdBindIndexBuffer(
@@ -1840,63 +5222,88 @@ namespace img_aligner::grid_warp
         };
         vkCmdSetViewport(cmd_buf->handle(), 0, 1, &viewport);
 
-        VkRect2D scissor{
-            .offset = { 0, 0 },
-            .extent = { framebuf->config().width,framebuf->config().height }
-        };
-        vkCmdSetScissor(cmd_buf->handle(), 0, 1, &scissor);
-
-        auto vk_descriptor_set = gwp_descriptor_set->handle();
-        vkCmdBindDescriptorSets(
-            cmd_buf->handle(),
-            VK_PIPELINE_BIND_POINT_GRAPHICS,
-            gwp_pipeline_layout->handle(),
-            0,
-            1,
-            &vk_descriptor_set,
-            0,
-            nullptr
-        );
+        vkCmdSetScissor(cmd_buf->handle(), 0, 1, &render_area);
 
         vkCmdPushConstants(
             cmd_buf->handle(),
             gwp_pipeline_layout->handle(),
-            VK_SHADER_STAGE_FRAGMENT_BIT,
+            VK_SHADER_STAGE_VERTEX_BIT,
             0,
-            sizeof(gwp_frag_push_constants),
-            &gwp_frag_push_constants
+            sizeof(vert_push_constants),
+            &vert_push_constants
         );
 
-        vkCmdDrawIndexed(
-            cmd_buf->handle(),
-            n_triangle_vertices,
-            1,
-            0,
-            0,
-            0
-        );
+        auto record_draw = [&](
+            const bv::DescriptorSetPtr& descriptor_set,
+            const GridWarpPassFragPushConstants& frag_push_constants
+            )
+        {
+            auto vk_descriptor_set = descriptor_set->handle();
+            vkCmdBindDescriptorSets(
+                cmd_buf->handle(),
+                VK_PIPELINE_BIND_POINT_GRAPHICS,
+                gwp_pipeline_layout->handle(),
+                0,
+                1,
+                &vk_descriptor_set,
+                0,
+                nullptr
+            );
 
-        vkCmdEndRenderPass(cmd_buf->handle());
+            vkCmdPushConstants(
+                cmd_buf->handle(),
+                gwp_pipeline_layout->handle(),
+                VK_SHADER_STAGE_FRAGMENT_BIT,
+                sizeof(GridWarpPassVertPushConstants),
+                sizeof(frag_push_constants),
+                &frag_push_constants
+            );
+
+            vkCmdDrawIndexed(
+                cmd_buf->handle(),
+                n_triangle_vertices,
+                1,
+                0,
+                0,
+                0
+            );
+        };
 
-        cmd_buf->end();
+        if (hires && base_tiled_img)
+        {
+            // every tile only writes the fragments it's responsible for
+            for (const auto& draw : base_tile_draws)
+            {
+                record_draw(draw.descriptor_set, draw.frag_push_constants);
+            }
+        }
+        else
+        {
+            record_draw(
+                hires ? gwp_descriptor_set_hires : gwp_descriptor_set,
+                gwp_frag_push_constants
+            );
+        }
 
-        return cmd_buf;
+        vkCmdEndRenderPass(cmd_buf->handle());
     }
 
-    bv::CommandBufferPtr GridWarper::create_difference_pass_cmd_buf()
+    void GridWarper::record_difference_pass(
+        const bv::CommandBufferPtr& cmd_buf,
+        const bv::FramebufferPtr& framebuf,
+        const bv::DescriptorSetPtr& descriptor_set
+    )
     {
-        bv::CommandBufferPtr cmd_buf = begin_single_time_commands(state, true);
-
         VkRenderPassBeginInfo render_pass_info{
             .sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,
             .pNext = nullptr,
             .renderPass = dfp_render_pass->handle(),
-            .framebuffer = dfp_framebuf->handle(),
+            .framebuffer = framebuf->handle(),
             .renderArea = VkRect2D{
                 .offset = { 0, 0 },
                 .extent = {
-                    dfp_framebuf->config().width,
-                    dfp_framebuf->config().height
+                    framebuf->config().width,
+                    framebuf->config().height
                 }
             },
             .clearValueCount = 0,
@@ -1914,7 +5321,7 @@ namespace img_aligner::grid_warp
             dfp_graphics_pipeline->handle()
         );
 
-        auto vk_descriptor_set = dfp_descriptor_set->handle();
+        auto vk_descriptor_set = descriptor_set->handle();
         vkCmdBindDescriptorSets(
             cmd_buf->handle(),
             VK_PIPELINE_BIND_POINT_GRAPHICS,
@@ -1926,15 +5333,6 @@ namespace img_aligner::grid_warp
             nullptr
         );
 
-        vkCmdPushConstants(
-            cmd_buf->handle(),
-            dfp_pipeline_layout->handle(),
-            VK_SHADER_STAGE_FRAGMENT_BIT,
-            0,
-            sizeof(dfp_frag_push_constants),
-            &dfp_frag_push_constants
-        );
-
         vkCmdDraw(
             cmd_buf->handle(),
             6,
@@ -1944,48 +5342,44 @@ namespace img_aligner::grid_warp
         );
 
         vkCmdEndRenderPass(cmd_buf->handle());
-
-        cmd_buf->end();
-
-        return cmd_buf;
     }
 
-    bv::CommandBufferPtr GridWarper::create_cost_pass_cmd_buf()
+    void GridWarper::record_cost_pass(
+        const bv::CommandBufferPtr& cmd_buf,
+        bool fused,
+        const bv::DescriptorSetPtr& descriptor_set,
+        const std::optional<VkRect2D>& cost_region
+    )
     {
-        bv::CommandBufferPtr cmd_buf = begin_single_time_commands(state, true);
+        const auto& pipeline =
+            fused ? fcp_compute_pipeline : csp_compute_pipeline;
+        const auto& pipeline_layout =
+            fused ? fcp_pipeline_layout : csp_pipeline_layout;
 
-        VkRenderPassBeginInfo render_pass_info{
-            .sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,
-            .pNext = nullptr,
-            .renderPass = csp_render_pass->handle(),
-            .framebuffer = csp_framebuf->handle(),
-            .renderArea = VkRect2D{
-                .offset = { 0, 0 },
-                .extent = {
-                    csp_framebuf->config().width,
-                    csp_framebuf->config().height
-                }
-            },
-            .clearValueCount = 0,
-            .pClearValues = nullptr
-        };
-        vkCmdBeginRenderPass(
-            cmd_buf->handle(),
-            &render_pass_info,
-            VK_SUBPASS_CONTENTS_INLINE
-        );
+        auto push_constants = fused ? fcp_push_constants : csp_push_constants;
+        if (cost_region)
+        {
+            push_constants.cost_offset = {
+                cost_region->offset.x,
+                cost_region->offset.y
+            };
+            push_constants.cost_extent = {
+                cost_region->extent.width,
+                cost_region->extent.height
+            };
+        }
 
         vkCmdBindPipeline(
             cmd_buf->handle(),
-            VK_PIPELINE_BIND_POINT_GRAPHICS,
-            csp_graphics_pipeline->handle()
+            VK_PIPELINE_BIND_POINT_COMPUTE,
+            pipeline->handle()
         );
 
-        auto vk_descriptor_set = csp_descriptor_set->handle();
+        auto vk_descriptor_set = descriptor_set->handle();
         vkCmdBindDescriptorSets(
             cmd_buf->handle(),
-            VK_PIPELINE_BIND_POINT_GRAPHICS,
-            csp_pipeline_layout->handle(),
+            VK_PIPELINE_BIND_POINT_COMPUTE,
+            pipeline_layout->handle(),
             0,
             1,
             &vk_descriptor_set,
@@ -1993,89 +5387,326 @@ namespace img_aligner::grid_warp
             nullptr
         );
 
-        csp_frag_push_constants.cost_res = {
-            (int32_t)csp_framebuf->config().width,
-            (int32_t)csp_framebuf->config().height
-        };
         vkCmdPushConstants(
             cmd_buf->handle(),
-            csp_pipeline_layout->handle(),
-            VK_SHADER_STAGE_FRAGMENT_BIT,
+            pipeline_layout->handle(),
+            VK_SHADER_STAGE_COMPUTE_BIT,
             0,
-            sizeof(csp_frag_push_constants),
-            &csp_frag_push_constants
+            sizeof(push_constants),
+            &push_constants
         );
 
-        vkCmdDraw(
+        // one workgroup per chunk of every cost pixel
+        vkCmdDispatch(
             cmd_buf->handle(),
-            6,
+            push_constants.cost_extent.x,
+            push_constants.cost_extent.y,
+            n_cost_chunks
+        );
+    }
+
+    void GridWarper::record_cost_reduction_pass(
+        const bv::CommandBufferPtr& cmd_buf,
+        const bv::DescriptorSetPtr& descriptor_set,
+        const std::optional<VkRect2D>& cost_region
+    )
+    {
+        auto push_constants = csp_push_constants;
+        if (cost_region)
+        {
+            push_constants.cost_offset = {
+                cost_region->offset.x,
+                cost_region->offset.y
+            };
+            push_constants.cost_extent = {
+                cost_region->extent.width,
+                cost_region->extent.height
+            };
+        }
+
+        vkCmdBindPipeline(
+            cmd_buf->handle(),
+            VK_PIPELINE_BIND_POINT_COMPUTE,
+            crp_compute_pipeline->handle()
+        );
+
+        auto vk_descriptor_set = descriptor_set->handle();
+        vkCmdBindDescriptorSets(
+            cmd_buf->handle(),
+            VK_PIPELINE_BIND_POINT_COMPUTE,
+            crp_pipeline_layout->handle(),
+            0,
             1,
+            &vk_descriptor_set,
             0,
-            0
+            nullptr
         );
 
-        vkCmdEndRenderPass(cmd_buf->handle());
+        vkCmdPushConstants(
+            cmd_buf->handle(),
+            crp_pipeline_layout->handle(),
+            VK_SHADER_STAGE_COMPUTE_BIT,
+            0,
+            sizeof(push_constants),
+            &push_constants
+        );
 
-        // memory barrier to wait for the rendering
-        VkImageMemoryBarrier barrier{
-            .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
-            .pNext = nullptr,
-            .srcAccessMask = 0,
-            .dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT,
-            .oldLayout = VK_IMAGE_LAYOUT_GENERAL,
-            .newLayout = VK_IMAGE_LAYOUT_GENERAL,
-            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-            .image = cost_img->handle(),
-            .subresourceRange = VkImageSubresourceRange{
+        // 8x8 cost pixels per workgroup
+        vkCmdDispatch(
+            cmd_buf->handle(),
+            (push_constants.cost_extent.x + 7) / 8,
+            (push_constants.cost_extent.y + 7) / 8,
+            1
+        );
+    }
+
+    void GridWarper::record_partial_sums_barrier(
+        const bv::CommandBufferPtr& cmd_buf
+    )
+    {
+        // global barrier because the batch has a partial sums buffer for
+        // every candidate
+        memory_barrier(
+            cmd_buf,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            VK_ACCESS_SHADER_WRITE_BIT,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            VK_ACCESS_SHADER_READ_BIT
+        );
+    }
+
+    void GridWarper::record_cost_cache_readback(
+        const bv::CommandBufferPtr& cmd_buf,
+        const std::optional<VkRect2D>& cost_region,
+        const bv::BufferPtr& dst_buf,
+        const bv::ImagePtr& src_img
+    )
+    {
+        const bv::BufferPtr& buf = dst_buf ? dst_buf : cost_cache_buf;
+        const bv::ImagePtr& img = src_img ? src_img : cost_img;
+
+        VkRect2D region = cost_region.value_or(VkRect2D{
+            .offset = { 0, 0 },
+            .extent = { cost_res_x, cost_res_y }
+            });
+
+        // memory barrier to wait for the cost reduction pass
+        image_memory_barrier(
+            cmd_buf,
+            img,
+            VK_IMAGE_LAYOUT_GENERAL,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            VK_ACCESS_SHADER_WRITE_BIT,
+            VK_PIPELINE_STAGE_TRANSFER_BIT,
+            VK_ACCESS_TRANSFER_READ_BIT
+        );
+
+        // the buffer has the same layout as the cost image, so the region
+        // goes to the same position in it. the layers go one after another.
+        VkBufferImageCopy copy_region{
+            .bufferOffset =
+            ((VkDeviceSize)region.offset.x
+                + (VkDeviceSize)region.offset.y * cost_res_x)
+            * sizeof(float),
+            .bufferRowLength = cost_res_x,
+            .bufferImageHeight = cost_res_y,
+            .imageSubresource = VkImageSubresourceLayers{
                 .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
-                .baseMipLevel = 0,
-                .levelCount = 1,
+                .mipLevel = 0,
                 .baseArrayLayer = 0,
-                .layerCount = 1
-            }
+                .layerCount = img->config().array_layers
+            },
+            .imageOffset = { region.offset.x, region.offset.y, 0 },
+            .imageExtent = { region.extent.width, region.extent.height, 1 }
         };
-        vkCmdPipelineBarrier(
+        vkCmdCopyImageToBuffer(
             cmd_buf->handle(),
-            VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+            img->handle(),
+            VK_IMAGE_LAYOUT_GENERAL,
+            buf->handle(),
+            1, &copy_region
+        );
+
+        // make the copy visible to the host
+        buffer_memory_barrier(
+            cmd_buf,
+            buf,
             VK_PIPELINE_STAGE_TRANSFER_BIT,
-            0,
-            0, nullptr,
-            0, nullptr,
-            1, &barrier
+            VK_ACCESS_TRANSFER_WRITE_BIT,
+            VK_PIPELINE_STAGE_HOST_BIT,
+            VK_ACCESS_HOST_READ_BIT
+        );
+    }
+
+    void GridWarper::record_cost_info_pass(
+        const bv::CommandBufferPtr& cmd_buf,
+        const bv::ImagePtr& img,
+        const std::vector<bv::DescriptorSetPtr>& descriptor_sets
+    )
+    {
+        // memory barrier to wait for the cost reduction pass
+        image_memory_barrier(
+            cmd_buf,
+            img,
+            VK_IMAGE_LAYOUT_GENERAL,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            VK_ACCESS_SHADER_WRITE_BIT,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            VK_ACCESS_SHADER_READ_BIT
+        );
+
+        vkCmdBindPipeline(
+            cmd_buf->handle(),
+            VK_PIPELINE_BIND_POINT_COMPUTE,
+            cip_compute_pipeline->handle()
         );
 
-        // copy to cost buffer
-        copy_image_to_buffer(cmd_buf, cost_img, cost_buf);
+        for (uint32_t i = 0; i < (uint32_t)descriptor_sets.size(); i++)
+        {
+            auto vk_descriptor_set = descriptor_sets[i]->handle();
+            vkCmdBindDescriptorSets(
+                cmd_buf->handle(),
+                VK_PIPELINE_BIND_POINT_COMPUTE,
+                cip_pipeline_layout->handle(),
+                0,
+                1,
+                &vk_descriptor_set,
+                0,
+                nullptr
+            );
+
+            CostInfoPassCompPushConstants push_constants{ .result_index = i };
+            vkCmdPushConstants(
+                cmd_buf->handle(),
+                cip_pipeline_layout->handle(),
+                VK_SHADER_STAGE_COMPUTE_BIT,
+                0,
+                sizeof(push_constants),
+                &push_constants
+            );
 
-        cmd_buf->end();
+            // a single workgroup goes through the whole cost image
+            vkCmdDispatch(cmd_buf->handle(), 1, 1, 1);
+        }
 
-        return cmd_buf;
+        // make the results visible to the host
+        memory_barrier(
+            cmd_buf,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            VK_ACCESS_SHADER_WRITE_BIT,
+            VK_PIPELINE_STAGE_HOST_BIT,
+            VK_ACCESS_HOST_READ_BIT
+        );
     }
 
-    void GridWarper::make_copy_of_vertices()
+    void GridWarper::record_displacement_pass(
+        const bv::CommandBufferPtr& cmd_buf,
+        uint32_t warp_index,
+        bool apply_only
+    )
     {
-        vertices_copy.resize(n_vertices);
-        std::copy(
-            vertex_buf_mapped,
-            vertex_buf_mapped + n_vertices,
-            vertices_copy.data()
+        vkCmdBindPipeline(
+            cmd_buf->handle(),
+            VK_PIPELINE_BIND_POINT_COMPUTE,
+            dsp_compute_pipeline->handle()
+        );
+
+        auto vk_descriptor_set = dsp_descriptor_set->handle();
+        vkCmdBindDescriptorSets(
+            cmd_buf->handle(),
+            VK_PIPELINE_BIND_POINT_COMPUTE,
+            dsp_pipeline_layout->handle(),
+            0,
+            1,
+            &vk_descriptor_set,
+            0,
+            nullptr
+        );
+
+        auto push_constants = dsp_push_constants;
+        push_constants.warp_index = warp_index;
+        push_constants.apply_only = apply_only ? 1 : 0;
+        vkCmdPushConstants(
+            cmd_buf->handle(),
+            dsp_pipeline_layout->handle(),
+            VK_SHADER_STAGE_COMPUTE_BIT,
+            0,
+            sizeof(push_constants),
+            &push_constants
+        );
+
+        // 64 invocations per workgroup, one per vertex
+        vkCmdDispatch(cmd_buf->handle(), (n_vertices + 63) / 64, 1, 1);
+    }
+
+    void GridWarper::record_accept_pass(
+        const bv::CommandBufferPtr& cmd_buf,
+        uint32_t iter_index
+    )
+    {
+        vkCmdBindPipeline(
+            cmd_buf->handle(),
+            VK_PIPELINE_BIND_POINT_COMPUTE,
+            acp_compute_pipeline->handle()
+        );
+
+        auto vk_descriptor_set = acp_descriptor_set->handle();
+        vkCmdBindDescriptorSets(
+            cmd_buf->handle(),
+            VK_PIPELINE_BIND_POINT_COMPUTE,
+            acp_pipeline_layout->handle(),
+            0,
+            1,
+            &vk_descriptor_set,
+            0,
+            nullptr
+        );
+
+        AcceptPassCompPushConstants push_constants{ .iter_index = iter_index };
+        vkCmdPushConstants(
+            cmd_buf->handle(),
+            acp_pipeline_layout->handle(),
+            VK_SHADER_STAGE_COMPUTE_BIT,
+            0,
+            sizeof(push_constants),
+            &push_constants
         );
+
+        vkCmdDispatch(cmd_buf->handle(), 1, 1, 1);
     }
 
-    void GridWarper::restore_copy_of_vertices()
+    void GridWarper::undo_displacement()
     {
-        if (vertices_copy.size() != n_vertices)
+        for (const auto& entry : undo_journal)
         {
-            throw std::runtime_error(
-                "the vertices copy vector doesn't have the expected size"
-            );
+            vertex_buf_mapped[entry.idx] = entry.warped_pos;
+        }
+        undo_journal.clear();
+    }
+
+    void GridWarper::update_max_vertex_offset()
+    {
+        grid_basis.max_vertex_offset = 0.f;
+
+        glm::vec2 res{ (float)intermediate_res_x, (float)intermediate_res_y };
+        uint32_t stride_y = padded_grid_res_x + 1;
+        for (uint32_t y = 0; y <= padded_grid_res_y; y++)
+        {
+            for (uint32_t x = 0; x <= padded_grid_res_x; x++)
+            {
+                glm::vec2 base_pos =
+                    grid_basis.origin
+                    + (float)x * grid_basis.step_x
+                    + (float)y * grid_basis.step_y;
+                grid_basis.max_vertex_offset = std::max(
+                    grid_basis.max_vertex_offset,
+                    glm::distance(
+                        vertex_buf_mapped[x + y * stride_y] * res,
+                        base_pos
+                    )
+                );
+            }
         }
-        std::copy(
-            vertices_copy.data(),
-            vertices_copy.data() + vertices_copy.size(),
-            vertex_buf_mapped
-        );
     }
 
 }
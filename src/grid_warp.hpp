@@ -8,6 +8,8 @@
 #include "misc/transform2d.hpp"
 #include "misc/vk_utils.hpp"
 #include "misc/hash.hpp"
+#include "misc/sum_max_tree.hpp"
+#include "misc/tiled_image.hpp"
 
 #include "ui_pass.hpp"
 
@@ -16,6 +18,12 @@ namespace img_aligner::grid_warp
 
     static constexpr size_t N_ITERS_TO_CHECK_CHANGE_IN_COST = 200;
 
+    // vertices that would be displaced less than this many pixels (at the
+    // intermediate resolution) in optimize_warp() aren't moved at all. this
+    // keeps the area affected by a displacement finite, see
+    // GridWarper::displace_vertices().
+    static constexpr float MIN_VERTEX_DISPLACEMENT = 1e-4f;
+
     static constexpr auto WARPED_IMAGE_NAME =
         "Warped Image (Intermediate Resolution)";
     static constexpr auto WARPED_HIRES_IMAGE_NAME =
@@ -23,6 +31,8 @@ namespace img_aligner::grid_warp
     static constexpr auto DIFFERENCE_IMAGE_NAME = "Difference Image";
     static constexpr auto COST_IMAGE_NAME = "Cost Image";
 
+    // the GPU gets the two positions from separate vertex buffers, see
+    // GridWarper::get_vertices().
     struct GridVertex
     {
         // the positions below are all normalized in the 0 to 1 range but they
@@ -36,36 +46,142 @@ namespace img_aligner::grid_warp
         // where we'll sample from the base image.
         glm::vec2 orig_pos;
 
-        static const bv::VertexInputBindingDescription binding;
         bool operator==(const GridVertex& other) const;
     };
 
+    // previous position of a vertex moved by GridWarper::displace_vertices()
+    struct VertexUndoEntry
+    {
+        uint32_t idx;
+        glm::vec2 warped_pos;
+    };
+
+    // the grid vertices are generated on an affine grid, so the position of
+    // vertex (x, y) before any warping is origin + x * step_x + y * step_y in
+    // pixel space (at the intermediate resolution). max_vertex_offset is an
+    // upper bound for how far any vertex has moved from there since.
+    struct GridBasis
+    {
+        glm::vec2 origin{ 0.f };
+        glm::vec2 step_x{ 1.f, 0.f };
+        glm::vec2 step_y{ 0.f, 1.f };
+        float max_vertex_offset = 0.f;
+    };
+
+    // affine transform applied to the warped vertex positions (in normalized
+    // space) in the vertex shader, see GridWarper::optimize_transform()
+    struct GridWarpPassVertPushConstants
+    {
+        glm::mat2 transform_mat{ 1.f };
+        glm::vec2 transform_offset{ 0.f };
+    };
+    static_assert(sizeof(GridWarpPassVertPushConstants) == 6 * sizeof(float));
+
+    // comes after GridWarpPassVertPushConstants in the push constant block.
+    // the tile_* members are only used when tiled is 1, see
+    // grid_warp_pass_frag.glsl.
     struct GridWarpPassFragPushConstants
     {
+        glm::vec2 tile_min{ 0.f };
+        glm::vec2 tile_max{ 1.f };
+        glm::vec2 tile_uv_scale{ 1.f };
+        glm::vec2 tile_uv_offset{ 0.f };
         float base_img_mul = 1.f;
+        uint32_t tiled = 0;
     };
+    static_assert(sizeof(GridWarpPassFragPushConstants) == 10 * sizeof(float));
 
-    struct DifferencePassFragPushConstants
+    // values for ResamplePassCompPushConstants::mode, see
+    // resample_pass_comp.glsl
+    static constexpr uint32_t RESAMPLE_MODE_WHOLE = 0;
+    static constexpr uint32_t RESAMPLE_MODE_TILE = 1;
+    static constexpr uint32_t RESAMPLE_MODE_FINALIZE = 2;
+
+    struct ResamplePassCompPushConstants
     {
-        float target_img_mul = 1.f;
+        float mul = 1.f;
+        uint32_t mode = RESAMPLE_MODE_WHOLE;
+        glm::ivec2 src_res{ 1, 1 };
+        glm::ivec2 src_offset{ 0, 0 };
+        glm::ivec2 core_min{ 0, 0 };
+        glm::ivec2 core_max{ 1, 1 };
+        glm::ivec2 dst_offset{ 0, 0 };
+    };
+
+    // shared by the cost pass, the fused cost pass, and the cost reduction
+    // pass
+    struct CostPassCompPushConstants
+    {
+        // the cost pixels to update are in the region starting at
+        // cost_offset with the size of cost_extent.
+        glm::uvec2 cost_res{ 1, 1 };
+        glm::uvec2 cost_offset{ 0, 0 };
+        glm::uvec2 cost_extent{ 1, 1 };
+
+        uint32_t n_chunks = 1;
     };
 
-    struct CostPassFragPushConstants
+    struct CostInfoPassCompPushConstants
     {
-        glm::ivec2 cost_res;
+        uint32_t result_index = 0;
     };
 
+    // written by the cost info pass, see cost_info_pass_comp.glsl
     struct CostInfo
     {
         float avg_diff; // average per-pixel logarithmic difference
         float max_local_diff; // maximum value in the cost image
     };
+    static_assert(sizeof(CostInfo) == 2 * sizeof(float));
+
+    struct DisplacementPassCompPushConstants
+    {
+        glm::uvec2 padded_grid_res{ 1, 1 };
+        glm::vec2 intermediate_res{ 1.f, 1.f };
+        uint32_t n_vertices = 0;
+        uint32_t warp_index = 0;
+        uint32_t apply_only = 0;
+    };
+
+    struct AcceptPassCompPushConstants
+    {
+        uint32_t iter_index = 0;
+    };
+
+    // a random gaussian displacement, see GridWarper::displace_vertices().
+    // the values are in pixel space at the intermediate resolution. also read
+    // by displacement_pass_comp.glsl.
+    struct WarpParams
+    {
+        glm::vec2 center;
+        glm::vec2 direction;
+        float radius; // standard deviation
+        float strength;
+    };
+    static_assert(sizeof(WarpParams) == 6 * sizeof(float));
+
+    // read and written by the accept pass, see accept_pass_comp.glsl
+    struct ResidentState
+    {
+        float last_avg_diff;
+        float max_local_diff_limit;
+        uint32_t accepted; // whether the last candidate was kept
+        uint32_t n_accepted;
+    };
+    static_assert(sizeof(ResidentState) == 4 * sizeof(uint32_t));
 
     struct Params
     {
         bv::ImageViewWPtr base_imgview;
         bv::ImageViewWPtr target_imgview;
 
+        // used instead of base_imgview and target_imgview if set, for images
+        // that don't fit on the GPU as a whole. the warped image can only be
+        // rendered in tiles if the base image is tiled, see
+        // GridWarper::render_warped_hires_tile().
+        std::shared_ptr<TiledImage> base_tiled_img = nullptr;
+        std::shared_ptr<TiledImage> target_tiled_img = nullptr;
+
         float base_img_mul = 1.f;
         float target_img_mul = 1.f;
 
@@ -76,26 +192,103 @@ namespace img_aligner::grid_warp
         uint32_t cost_res_area = 60;
 
         uint32_t rng_seed = 8191;
+
+        // max. number of warp candidates in flight at once when using
+        // GridWarper::optimize_warp_pipelined(). 1 disables pipelining.
+        // batching and resident iterations take priority over it.
+        uint32_t pipeline_depth = 1;
+
+        // number of warp candidates evaluated in one submission when using
+        // GridWarper::optimize_warp_batched(). 1 disables batching.
+        uint32_t batch_size = 1;
+
+        // number of warp iterations run on the GPU in one submission when
+        // using GridWarper::optimize_warp_resident(). 1 disables it.
+        uint32_t resident_iters = 1;
+
+        // store the intermediate warped and difference images as 16-bit
+        // floats to halve their bandwidth. the high-resolution warped image
+        // and the cost are always 32-bit.
+        bool half_precision = false;
+
+        // only compare the luminance of the images during optimization. the
+        // base image is converted to a single-channel luminance image once
+        // and the intermediate warped image only has a single channel. the
+        // high-resolution warped image still has all channels.
+        bool luminance = false;
+    };
+
+    // a warp candidate in the optimization pipeline. every slot has its own
+    // copy of the grid vertices and its own cost buffer so multiple candidates
+    // can be queued at the same time.
+    struct WarpCandidateSlot
+    {
+        // vertex buffer with the warped positions, host-visible and
+        // host-coherent
+        bv::BufferPtr vertex_buf = nullptr;
+        bv::MemoryChunkPtr vertex_buf_mem = nullptr;
+        glm::vec2* vertex_buf_mapped = nullptr;
+
+        // host visible buffer for the cost info pass to write to, and the
+        // descriptor set that points to it
+        bv::BufferPtr cost_info_buf = nullptr;
+        bv::MemoryChunkPtr cost_info_buf_mem = nullptr;
+        CostInfo* cost_info_buf_mapped = nullptr;
+        bv::DescriptorSetPtr cip_descriptor_set = nullptr;
+
+        // host visible copy of the whole cost image, like
+        // GridWarper::cost_cache_buf
+        bv::BufferPtr cost_cache_buf = nullptr;
+        bv::MemoryChunkPtr cost_cache_buf_mem = nullptr;
+        float* cost_cache_buf_mapped = nullptr;
+
+        // runs all passes with the buffers above, signals the fence when done
+        bv::CommandBufferPtr cmd_buf = nullptr;
+        bv::FencePtr fence = nullptr;
+
+        // the hash index this candidate was generated with
+        uint32_t hash_index = 0;
     };
 
-    // there are 3 types of passes in GridWarper:
+    // there are 4 types of passes in GridWarper:
     // 1. grid warp pass
-    //    - samples base_img
+    //    - samples base_interm_img (the base image resampled to the
+    //      intermediate resolution) or base_img for warped_hires_img
     //    - renders to warped_img or warped_hires_img (we make 2
     //      framebuffers and use the appropriate one).
     //    - uses the grid vertex buffer
     // 2. difference pass
-    //    - samples warped_img and target_img
+    //    - samples warped_img and target_log_img (the log of the target
+    //      image at the intermediate resolution)
     //    - calculates the per-pixel logarithmic difference
     //    - renders to difference_img
     //    - does not use a vertex buffer. instead, generates vertices for a
     //      "full-screen" quad in the vertex shader.
     // 3. cost pass
-    //    - samples difference_img using as many texel fetches needed to
-    //      avoid aliasing.
-    //    - renders to the cost image at the cost resolution
-    //    - does not use a vertex buffer. instead, generates vertices for a
-    //      "full-screen" quad in the vertex shader.
+    //    - a compute shader that samples difference_img using as many texel
+    //      fetches needed to avoid aliasing.
+    //    - the footprint of every cost pixel is split into n_cost_chunks
+    //      chunks and every chunk is summed by a separate workgroup with a
+    //      parallel reduction in shared memory. the partial sums are written
+    //      to cost_partial_sums_buf.
+    //    - the cost reduction pass then adds up the partial sums of every
+    //      cost pixel and writes the average to the cost image.
+    // 4. cost info pass
+    //    - a compute shader with a single workgroup that finds the average
+    //      and maximum values in the cost image and writes them to a
+    //      host-visible buffer as a CostInfo. this way we only read 8 bytes
+    //      back to the CPU no matter the cost resolution.
+    //
+    // base_interm_img and target_log_img are filled once by the resample
+    // pass when GridWarper is created, so the passes above never read the
+    // original base and target images except for warped_hires_img.
+    //
+    // during optimization, the difference and cost passes are replaced with
+    // the fused cost pass, the same compute shader except it samples
+    // warped_img and target_log_img and calculates the difference values on the
+    // fly. this way we don't write and read back a full-resolution difference
+    // image in every iteration. the difference image is only rendered when
+    // needed, see evaluate().
 
     class GridWarper
     {
@@ -108,13 +301,50 @@ namespace img_aligner::grid_warp
         );
         ~GridWarper();
 
+        // the high-resolution warped image is only allocated the first time
+        // it's rendered. it can't be rendered as a whole if the base image is
+        // tiled, use render_warped_hires_tile() instead.
         void run_grid_warp_pass(bool hires, const bv::QueuePtr& queue);
 
-        // returns the cost values
-        CostInfo run_difference_and_cost_pass(const bv::QueuePtr& queue);
+        // free the high-resolution warped image until it's rendered again.
+        // the UI pass must be recreated afterwards if it was showing it.
+        void release_warped_hires_img();
+
+        // render a region of the high-resolution warped image on its own
+        // without ever allocating warped_hires_img, so images of any size can
+        // be exported tile by tile. returns the pixels in RGBA F32 format,
+        // optionally flipped vertically. the render target is kept around
+        // for the next tile until release_warped_tile_img() is called. if the
+        // base image is tiled, only the tiles that land in the region are
+        // uploaded and drawn.
+        std::vector<float> render_warped_hires_tile(
+            const bv::QueuePtr& queue,
+            uint32_t x,
+            uint32_t y,
+            uint32_t width,
+            uint32_t height,
+            bool vflip
+        );
+        void release_warped_tile_img();
+
+        // run the grid warp pass (at the intermediate resolution), the
+        // difference pass, and the cost pass in a single submission with
+        // pipeline barriers in between, so we only wait for the GPU once.
+        // returns the cost values. if update_difference_img is false, the
+        // fused cost pass is used instead and the difference image is left
+        // untouched.
+        CostInfo evaluate(
+            const bv::QueuePtr& queue,
+            bool update_difference_img = true
+        );
 
         void add_images_to_ui_pass(UiPass& ui_pass);
 
+        bool has_tiled_base_img() const
+        {
+            return base_tiled_img != nullptr;
+        }
+
         constexpr uint32_t get_img_width() const
         {
             return img_width;
@@ -180,16 +410,18 @@ namespace img_aligner::grid_warp
             return n_vertices;
         }
 
-        const GridVertex* get_vertices() const
-        {
-            return vertex_buf_mapped;
-        }
+        // copy the warped and original positions of the vertices to
+        // out_vertices. during transform optimization, the vertices might not
+        // have the accepted grid transform applied until the next call to
+        // evaluate().
+        void get_vertices(std::vector<GridVertex>& out_vertices) const;
 
         constexpr const bv::ImagePtr& get_warped_img() const
         {
             return warped_img;
         }
 
+        // nullptr if it hasn't been rendered since it was last released
         constexpr const bv::ImagePtr& get_warped_hires_img() const
         {
             return warped_hires_img;
@@ -208,12 +440,16 @@ namespace img_aligner::grid_warp
         void regenerate_grid_vertices(const Transform2d& grid_transform);
 
         // generate a random grid transform jittered around the base transform
-        // and regenerate the grid vertices with that transform. if it caused
-        // the cost (average difference) or the maximum local difference (max
-        // value in the cost image) to increase, we will undo the displacement
-        // and return false, otherwise we'll keep the changes and return true.
-        // out_jittered_transform will only be updated when returning true,
-        // otherwise it'll stay untouched.
+        // and evaluate the grid with that transform. if it caused the cost
+        // (average difference) or the maximum local difference (max value in
+        // the cost image) to increase, we will throw it away and return false,
+        // otherwise we'll keep it and return true. out_jittered_transform
+        // will only be updated when returning true, otherwise it'll stay
+        // untouched. the vertex buffer keeps the untransformed grid while
+        // this is being called and the jittered transform is applied in the
+        // vertex shader, so the cost on the CPU doesn't depend on the grid
+        // resolution. the accepted transform is applied to the vertices once
+        // something else needs them, see bake_grid_transform().
         bool optimize_transform(
             uint32_t hash_index,
             const Transform2d& base_transform,
@@ -226,8 +462,10 @@ namespace img_aligner::grid_warp
 
         // displace the grid vertices using an unnormalized gaussian
         // distribution with randomly generated center point, radius (standard
-        // deviation), displacement direction and strength. the grid warp,
-        // difference, and cost passes will then be run. if the displacement
+        // deviation), displacement direction and strength. the grid warp and
+        // fused cost passes will then be run, only in the area affected by the
+        // displacement when possible, see evaluate_dirty_rect(). if the
+        // displacement
         // caused the cost (average difference) or the maximum local difference
         // (max value in the cost image) to increase, we will undo the
         // displacement and return false, otherwise we'll keep the changes and
@@ -240,20 +478,329 @@ namespace img_aligner::grid_warp
             const bv::QueuePtr& queue
         );
 
+        // same as optimize_warp() but keeps up to pipeline_depth candidates
+        // in flight. while the GPU is evaluating the candidate for hash_index,
+        // the CPU builds the candidates for the next hash indices against the
+        // last accepted state. when a candidate is accepted, the ones queued
+        // after it are stale so they get rebuilt and resubmitted. every
+        // candidate reads back its whole cost image and its cost values come
+        // from a SumMaxTree like in optimize_warp(), so both compare the same
+        // double precision averages when accepting or rejecting candidates.
+        // calc_warp_strength() should return the warp strength for a given
+        // hash index. needs a pipeline depth of at least 2.
+        bool optimize_warp_pipelined(
+            uint32_t hash_index,
+            const std::function<float(uint32_t)>& calc_warp_strength,
+            const bv::QueuePtr& queue
+        );
+
+        // wait for the candidates in flight and throw them away. the other
+        // functions call this themselves before touching the GPU resources,
+        // but you should call it if you need the images to stay untouched,
+        // for example before reading them on a different queue.
+        void drain_pipeline();
+
+        uint32_t get_pipeline_depth() const
+        {
+            return (uint32_t)pipeline_slots.size();
+        }
+
+        // generate batch_size candidates for hash_index, hash_index + 1, and
+        // so on, each displaced from the current vertices like in
+        // optimize_warp(). they're all rendered to their own layers of the
+        // batch images and evaluated in a single submission with a single
+        // readback. among the candidates that didn't increase the cost or the
+        // maximum local difference, the one with the lowest cost is kept and
+        // we return true. if there were none, the vertices stay untouched and
+        // we return false. calc_warp_strength() should return the warp
+        // strength for a given hash index.
+        bool optimize_warp_batched(
+            uint32_t hash_index,
+            const std::function<float(uint32_t)>& calc_warp_strength,
+            const bv::QueuePtr& queue
+        );
+
+        constexpr uint32_t get_batch_size() const
+        {
+            return batch_size;
+        }
+
+        // run resident_iters iterations of optimize_warp() for hash_index,
+        // hash_index + 1, and so on, entirely on the GPU in a single
+        // submission. the displacement parameters are generated up front and
+        // the displacement, evaluation, and the decision to keep or undo
+        // every candidate all happen on the GPU, so we only wait for the GPU
+        // once. the current vertices are evaluated on the GPU first so every
+        // candidate is compared to a cost from the cost info pass.
+        // out_cost_history will have the cost after every iteration.
+        // returns the number of candidates that were kept.
+        // calc_warp_strength() should return the warp strength for a given
+        // hash index.
+        uint32_t optimize_warp_resident(
+            uint32_t hash_index,
+            const std::function<float(uint32_t)>& calc_warp_strength,
+            const bv::QueuePtr& queue,
+            std::vector<float>& out_cost_history
+        );
+
+        constexpr uint32_t get_resident_iters() const
+        {
+            return resident_iters;
+        }
+
+        constexpr bool is_half_precision() const
+        {
+            return half_precision;
+        }
+
     private:
         void create_vertex_and_index_buffer_and_generate_vertices(
             const Transform2d& grid_transform,
             const bv::QueuePtr& queue
         );
         void create_sampler_and_images(const bv::QueuePtr& queue);
+
+        // also makes the framebuffer and records the command buffer for it
+        void create_warped_hires_img(const bv::QueuePtr& queue);
+
+        // render target for render_warped_hires_tile()
+        void create_warped_tile_img(uint32_t width, uint32_t height);
+
+        // create base_interm_img and target_log_img and run the resample pass
+        // once to fill each of them
+        void create_base_interm_img(const bv::QueuePtr& queue);
+        void create_target_log_img(
+            const bv::QueuePtr& queue,
+            float target_img_mul
+        );
+
+        // run a variant of the resample pass once to box filter src_imgview
+        // (binding 0) into dst_img (storage image, binding 1) with one
+        // invocation per pixel in 8x8 workgroups. dst_img goes from
+        // VK_IMAGE_LAYOUT_UNDEFINED to VK_IMAGE_LAYOUT_GENERAL and the writes
+        // are made visible to the given stages. if src_tiled_img is given,
+        // it's used instead of src_imgview and the tiles are uploaded and
+        // resampled one at a time, see resample_pass_comp.glsl.
+        void run_resample_pass(
+            const bv::QueuePtr& queue,
+            const std::filesystem::path& shader_path,
+            const bv::ImageViewWPtr& src_imgview,
+            VkImageLayout src_layout,
+            const std::shared_ptr<TiledImage>& src_tiled_img,
+            const bv::ImagePtr& dst_img,
+            const bv::ImageViewPtr& dst_imgview,
+            float mul,
+            VkPipelineStageFlags next_stage_mask,
+            VkAccessFlags next_stage_access_mask
+        );
+
         void create_passes();
+        void create_pipeline_slots(uint32_t pipeline_depth);
+
+        // allocate and update a descriptor set for the fused cost pass
+        bv::DescriptorSetPtr create_fcp_descriptor_set(
+            const bv::DescriptorPoolPtr& pool,
+            const bv::ImageViewPtr& warped_imgview_to_use,
+            const bv::BufferPtr& partial_sums_buf
+        );
+
+        // create a descriptor pool for n_sets cost info pass descriptor sets
+        bv::DescriptorPoolPtr create_cip_descriptor_pool(uint32_t n_sets);
 
-        bv::CommandBufferPtr create_grid_warp_pass_cmd_buf(bool hires);
-        bv::CommandBufferPtr create_difference_pass_cmd_buf();
-        bv::CommandBufferPtr create_cost_pass_cmd_buf();
+        // allocate and update a descriptor set for the cost info pass
+        bv::DescriptorSetPtr create_cip_descriptor_set(
+            const bv::DescriptorPoolPtr& pool,
+            const bv::ImageViewPtr& cost_imgview_to_use,
+            const bv::BufferPtr& cost_info_buf_to_use
+        );
+
+        // allocate and update a descriptor set for the cost reduction pass
+        bv::DescriptorSetPtr create_crp_descriptor_set(
+            const bv::DescriptorPoolPtr& pool,
+            const bv::BufferPtr& partial_sums_buf,
+            const bv::ImageViewPtr& cost_imgview_to_use
+        );
+        void create_batch_resources(const bv::QueuePtr& queue);
+        void create_resident_resources();
+
+        // the command buffers for every pass are only recorded once and
+        // resubmitted in every iteration because only the contents of the
+        // vertex buffer change and they're read at execution time anyway.
+        void create_cmd_bufs();
+
+        // a draw in the grid warp pass that samples one tile of a tiled base
+        // image instead of the whole image
+        struct BaseTileDraw
+        {
+            bv::DescriptorSetPtr descriptor_set;
+            GridWarpPassFragPushConstants frag_push_constants;
+        };
+
+        // if the base image is tiled, the high-resolution grid is drawn once
+        // for every element in base_tile_draws instead of once with
+        // gwp_frag_push_constants.
+        void record_grid_warp_pass(
+            const bv::CommandBufferPtr& cmd_buf,
+            const bv::FramebufferPtr& framebuf,
+            const bv::BufferPtr& vertex_buf_to_use,
+            VkDeviceSize vertex_buf_offset = 0,
+            const std::optional<VkRect2D>& dirty_rect = std::nullopt,
+            const GridWarpPassVertPushConstants& vert_push_constants = {},
+            const std::vector<BaseTileDraw>& base_tile_draws = {}
+        );
+
+        // indices of the tiles of base_tiled_img that the warped grid might
+        // sample in the given region of the high-resolution warped image,
+        // based on the bounding boxes of the grid cells.
+        std::vector<size_t> find_base_tiles_in_region(
+            uint32_t x,
+            uint32_t y,
+            uint32_t width,
+            uint32_t height
+        ) const;
+        void record_difference_pass(
+            const bv::CommandBufferPtr& cmd_buf,
+            const bv::FramebufferPtr& framebuf,
+            const bv::DescriptorSetPtr& descriptor_set
+        );
 
-        void make_copy_of_vertices();
-        void restore_copy_of_vertices();
+        // record the cost pass, or the fused cost pass if fused is true. the
+        // input images must already be synchronized with a barrier. if
+        // cost_region is given, only the cost pixels in it are updated.
+        void record_cost_pass(
+            const bv::CommandBufferPtr& cmd_buf,
+            bool fused,
+            const bv::DescriptorSetPtr& descriptor_set,
+            const std::optional<VkRect2D>& cost_region = std::nullopt
+        );
+
+        // the partial sums must already be synchronized with a barrier, see
+        // record_partial_sums_barrier().
+        void record_cost_reduction_pass(
+            const bv::CommandBufferPtr& cmd_buf,
+            const bv::DescriptorSetPtr& descriptor_set,
+            const std::optional<VkRect2D>& cost_region = std::nullopt
+        );
+        void record_partial_sums_barrier(const bv::CommandBufferPtr& cmd_buf);
+
+        // copy the cost pixels in cost_region (or all of them) from every
+        // layer of src_img (cost_img if nullptr) to the same positions in
+        // dst_buf (cost_cache_buf if nullptr), one layer after another.
+        void record_cost_cache_readback(
+            const bv::CommandBufferPtr& cmd_buf,
+            const std::optional<VkRect2D>& cost_region = std::nullopt,
+            const bv::BufferPtr& dst_buf = nullptr,
+            const bv::ImagePtr& src_img = nullptr
+        );
+
+        // average and maximum values from cost_cache_tree
+        CostInfo cost_info_from_cache() const;
+
+        // average and maximum values from any tree over the cost image
+        CostInfo cost_info_from_tree(const SumMaxTree& tree) const;
+
+        // wait for the cost reduction pass to write to img, then run the cost
+        // info pass once for every descriptor set and make the results visible
+        // to the host. the i-th run writes the i-th CostInfo in its buffer.
+        void record_cost_info_pass(
+            const bv::CommandBufferPtr& cmd_buf,
+            const bv::ImagePtr& img,
+            const std::vector<bv::DescriptorSetPtr>& descriptor_sets
+        );
+
+        // record the grid warp pass (at the intermediate resolution) and
+        // either the difference and cost passes or the fused cost pass,
+        // followed by the cost reduction pass, with barriers in between.
+        void record_evaluation(
+            const bv::CommandBufferPtr& cmd_buf,
+            const bv::BufferPtr& vertex_buf_to_use,
+            const bv::DescriptorSetPtr& cip_descriptor_set_to_use,
+            bool update_difference_img,
+            const GridWarpPassVertPushConstants& gwp_vert_push_constants = {}
+        );
+
+        // record the displacement pass for warp_index in resident_warp_buf,
+        // see displacement_pass_comp.glsl.
+        void record_displacement_pass(
+            const bv::CommandBufferPtr& cmd_buf,
+            uint32_t warp_index,
+            bool apply_only
+        );
+
+        // record the accept pass, see accept_pass_comp.glsl
+        void record_accept_pass(
+            const bv::CommandBufferPtr& cmd_buf,
+            uint32_t iter_index
+        );
+
+        // generate the random gaussian displacement for hash_index
+        WarpParams gen_warp_params(
+            uint32_t hash_index,
+            float warp_strength
+        ) const;
+
+        // apply the random gaussian displacement for hash_index to the given
+        // warped positions, see optimize_warp(). only the vertices in the
+        // window that can be displaced by at least MIN_VERTEX_DISPLACEMENT are
+        // visited. if out_dirty_rect isn't null, it will be set to the pixels
+        // (at the intermediate resolution) covered by the triangles that were
+        // affected, which might be empty. if out_undo_journal isn't null, the
+        // previous positions of the moved vertices are appended to it.
+        void displace_vertices(
+            glm::vec2* warped_positions,
+            uint32_t hash_index,
+            float warp_strength,
+            VkRect2D* out_dirty_rect = nullptr,
+            std::vector<VertexUndoEntry>* out_undo_journal = nullptr
+        );
+
+        // move the vertices in undo_journal back to their previous positions
+        void undo_displacement();
+
+        // find grid_basis.max_vertex_offset from scratch, needed when the
+        // vertices were moved on the GPU.
+        void update_max_vertex_offset();
+
+        // like evaluate(queue, false) except the grid warp pass only renders
+        // the pixels in dirty_rect and the fused cost pass only updates the
+        // cost pixels that overlap it. everything else is kept from the
+        // previous evaluation, so this can only be used when
+        // dirty_rect_state_valid is true. only the updated cost pixels are
+        // read back and the cost values are derived from cost_cache_tree.
+        CostInfo evaluate_dirty_rect(
+            VkRect2D dirty_rect,
+            const bv::QueuePtr& queue
+        );
+
+        // build the candidate for hash_index in a free slot on top of the
+        // current (accepted) vertices and submit it.
+        void submit_pipeline_candidate(
+            uint32_t hash_index,
+            float warp_strength,
+            const bv::QueuePtr& queue
+        );
+
+        // fill the vertex buffer with the grid transformed by grid_transform
+        // without changing current_grid_transform
+        void generate_grid_vertices(const Transform2d& grid_transform);
+
+        // apply current_grid_transform to the vertices if they don't have it
+        // yet, see optimize_transform().
+        void bake_grid_transform();
+
+        // the affine transform (in normalized space) that
+        // generate_grid_vertices() would apply to the untransformed grid
+        GridWarpPassVertPushConstants calc_gwp_vert_push_constants(
+            const Transform2d& grid_transform
+        ) const;
+
+        // like evaluate(queue, false) but the grid warp pass applies the given
+        // transform to the vertices. the command buffer is recorded again
+        // every time like in evaluate_dirty_rect().
+        CostInfo evaluate_transformed(
+            const GridWarpPassVertPushConstants& gwp_vert_push_constants,
+            const bv::QueuePtr& queue
+        );
 
     private:
         AppState& state;
@@ -263,6 +810,10 @@ namespace img_aligner::grid_warp
         bv::ImageViewWPtr base_imgview;
         bv::ImageViewWPtr target_imgview;
 
+        // nullptr unless the images are tiled, see Params
+        std::shared_ptr<TiledImage> base_tiled_img = nullptr;
+        std::shared_ptr<TiledImage> target_tiled_img = nullptr;
+
         // size of the base and target images
         uint32_t img_width = 1;
         uint32_t img_height = 1;
@@ -279,20 +830,44 @@ namespace img_aligner::grid_warp
         uint32_t cost_res_x = 1;
         uint32_t cost_res_y = 1;
 
+        // formats of warped_img and difference_img, see Params::half_precision
+        // and Params::luminance
+        bool half_precision = false;
+        bool luminance = false;
+        VkFormat warped_img_format = VK_FORMAT_R32G32B32A32_SFLOAT;
+        VkFormat difference_img_format = VK_FORMAT_R32_SFLOAT;
+
         // used for optimization
         std::optional<float> last_avg_diff;
         std::optional<float> initial_max_local_diff;
 
-        // vertex buffer for the grid vertices, host-visible and host-coherent
-        // because we'll keep moving the vertices in every iteration.
+        // vertex buffer for the warped positions of the grid vertices,
+        // host-visible and host-coherent because we'll keep moving the
+        // vertices in every iteration.
         uint32_t n_vertices = 0;
         bv::BufferPtr vertex_buf = nullptr;
         bv::MemoryChunkPtr vertex_buf_mem = nullptr;
-        GridVertex* vertex_buf_mapped = nullptr;
+        glm::vec2* vertex_buf_mapped = nullptr;
+
+        // vertex buffer for the original positions of the grid vertices. they
+        // never change so they're only uploaded once to device-local memory,
+        // and we keep a copy on the host.
+        bv::BufferPtr orig_pos_buf = nullptr;
+        bv::MemoryChunkPtr orig_pos_buf_mem = nullptr;
+        std::vector<glm::vec2> orig_positions;
 
-        // vector to contain a copy of the vertices, ONLY used when undoing
-        // grid displacement in case it increased the cost.
-        std::vector<GridVertex> vertices_copy;
+        // the grid transform the vertices are supposed to have. if
+        // grid_transform_baked is false, the vertex buffer has the
+        // untransformed grid instead, see optimize_transform().
+        Transform2d current_grid_transform;
+        bool grid_transform_baked = true;
+
+        // see GridBasis. updated when the vertices are regenerated or moved.
+        GridBasis grid_basis;
+
+        // previous positions of the vertices moved in optimize_warp(), used to
+        // undo the displacement in case it increased the cost.
+        std::vector<VertexUndoEntry> undo_journal;
 
         // index buffer for the grid vertices
         uint32_t n_triangle_vertices = 0;
@@ -309,40 +884,105 @@ namespace img_aligner::grid_warp
         bv::ImageViewPtr warped_imgview = nullptr;
 
         // grid warped image at original resolution. this will only be updated
-        // after optimization is stopped.
+        // after optimization is stopped and it's only allocated while needed
+        // because it's by far the largest image we make.
         bv::ImagePtr warped_hires_img = nullptr;
         bv::MemoryChunkPtr warped_hires_img_mem = nullptr;
         bv::ImageViewPtr warped_hires_imgview = nullptr;
 
+        // a region of warped_hires_img when it's rendered in tiles. see
+        // render_warped_hires_tile().
+        bv::ImagePtr warped_tile_img = nullptr;
+        bv::MemoryChunkPtr warped_tile_img_mem = nullptr;
+        bv::ImageViewPtr warped_tile_imgview = nullptr;
+
         // difference image (per-pixel logarithmic difference between the warped
         // image and the target image).
         bv::ImagePtr difference_img = nullptr;
         bv::MemoryChunkPtr difference_img_mem = nullptr;
         bv::ImageViewPtr difference_imgview = nullptr;
 
+        // log of the target image at the intermediate resolution with the
+        // target image multiplier applied. the target image never changes so
+        // this is only calculated once, see create_target_log_img().
+        bv::ImagePtr target_log_img = nullptr;
+        bv::MemoryChunkPtr target_log_img_mem = nullptr;
+        bv::ImageViewPtr target_log_imgview = nullptr;
+
+        // base image box filtered to the intermediate resolution, or its
+        // luminance in luminance mode. the grid warp pass samples this one
+        // at the intermediate resolution instead of the original base image.
+        // the mirrored repeat sampler takes care of the grid padding just like
+        // with the original image. see create_base_interm_img().
+        bv::ImagePtr base_interm_img = nullptr;
+        bv::MemoryChunkPtr base_interm_img_mem = nullptr;
+        bv::ImageViewPtr base_interm_imgview = nullptr;
+
         // cost image. this is just a downscaled version of the difference
         // image.
         bv::ImagePtr cost_img = nullptr;
         bv::MemoryChunkPtr cost_img_mem = nullptr;
         bv::ImageViewPtr cost_imgview = nullptr;
 
-        // host visible buffer to copy the cost image's pixels to the CPU
-        bv::BufferPtr cost_buf = nullptr;
-        bv::MemoryChunkPtr cost_buf_mem = nullptr;
-        float* cost_buf_mapped = nullptr;
+        // partial sums of the cost pass, (sum, weight) pairs for every chunk
+        // of every cost pixel, see create_passes().
+        uint32_t n_cost_chunks = 1;
+        bv::BufferPtr cost_partial_sums_buf = nullptr;
+        bv::MemoryChunkPtr cost_partial_sums_buf_mem = nullptr;
+
+        // host visible buffer for the cost info pass to write to
+        bv::BufferPtr cost_info_buf = nullptr;
+        bv::MemoryChunkPtr cost_info_buf_mem = nullptr;
+        CostInfo* cost_info_buf_mapped = nullptr;
+
+        // copy of the cost image on the host for the fused cost pass, and a
+        // segment tree over it. after a full evaluation, the whole cost image
+        // is read back and the tree is rebuilt. after a dirty rectangle
+        // evaluation, only the updated cost pixels are read back and changed
+        // in the tree, so the average and maximum values are found in
+        // O(changed pixels * log(cost pixels)).
+        bv::BufferPtr cost_cache_buf = nullptr;
+        bv::MemoryChunkPtr cost_cache_buf_mem = nullptr;
+        float* cost_cache_buf_mapped = nullptr;
+        SumMaxTree cost_cache_tree;
+
+        // tree over the cost image of the pipelined candidate being checked.
+        // it's swapped with cost_cache_tree if the candidate is accepted.
+        SumMaxTree pipeline_cost_tree;
 
         // grid warp pass: descriptor stuff
         bv::DescriptorSetLayoutPtr gwp_descriptor_set_layout = nullptr;
         bv::DescriptorPoolPtr gwp_descriptor_pool = nullptr;
         bv::DescriptorSetPtr gwp_descriptor_set;
 
+        // samples the original base image for the high-resolution warped
+        // image. nullptr if the base image is tiled.
+        bv::DescriptorSetPtr gwp_descriptor_set_hires;
+
+        // one for every tile of a tiled base image, updated whenever the tile
+        // is used in render_warped_hires_tile()
+        bv::DescriptorPoolPtr gwp_tile_descriptor_pool = nullptr;
+        std::vector<bv::DescriptorSetPtr> gwp_tile_descriptor_sets;
+
         // grid warp pass
         bv::RenderPassPtr gwp_render_pass = nullptr;
+        bv::RenderPassPtr gwp_render_pass_load = nullptr; // for dirty rects
         bv::FramebufferPtr gwp_framebuf = nullptr;
         bv::FramebufferPtr gwp_framebuf_hires = nullptr;
+        bv::FramebufferPtr gwp_framebuf_tile = nullptr;
         bv::PipelineLayoutPtr gwp_pipeline_layout = nullptr;
         bv::GraphicsPipelinePtr gwp_graphics_pipeline = nullptr;
+
+        // the high-resolution warped image is always 32-bit RGBA so it needs
+        // its own render pass and pipeline in half precision or luminance
+        // mode. otherwise these are the same as the ones above.
+        bv::RenderPassPtr gwp_render_pass_hires = nullptr;
+        bv::GraphicsPipelinePtr gwp_graphics_pipeline_hires = nullptr;
+
         GridWarpPassFragPushConstants gwp_frag_push_constants;
+        bv::CommandBufferPtr gwp_cmd_buf = nullptr;
+        bv::CommandPoolPtr gwp_cmd_pool_hires = nullptr;
+        bv::CommandBufferPtr gwp_cmd_buf_hires = nullptr;
         bv::FencePtr gwp_fence = nullptr;
 
         // difference pass: descriptor stuff
@@ -355,8 +995,6 @@ namespace img_aligner::grid_warp
         bv::FramebufferPtr dfp_framebuf = nullptr;
         bv::PipelineLayoutPtr dfp_pipeline_layout = nullptr;
         bv::GraphicsPipelinePtr dfp_graphics_pipeline = nullptr;
-        DifferencePassFragPushConstants dfp_frag_push_constants;
-        bv::FencePtr dfp_fence = nullptr;
 
         // cost pass: descriptor stuff
         bv::DescriptorSetLayoutPtr csp_descriptor_set_layout = nullptr;
@@ -364,12 +1002,147 @@ namespace img_aligner::grid_warp
         bv::DescriptorSetPtr csp_descriptor_set;
 
         // cost pass
-        bv::RenderPassPtr csp_render_pass = nullptr;
-        bv::FramebufferPtr csp_framebuf = nullptr;
         bv::PipelineLayoutPtr csp_pipeline_layout = nullptr;
-        bv::GraphicsPipelinePtr csp_graphics_pipeline = nullptr;
-        CostPassFragPushConstants csp_frag_push_constants;
-        bv::FencePtr csp_fence = nullptr;
+        bv::ComputePipelinePtr csp_compute_pipeline = nullptr;
+        CostPassCompPushConstants csp_push_constants;
+
+        // fused cost pass and cost reduction pass: descriptor stuff
+        bv::DescriptorSetLayoutPtr fcp_descriptor_set_layout = nullptr;
+        bv::DescriptorSetLayoutPtr crp_descriptor_set_layout = nullptr;
+        bv::DescriptorPoolPtr fcp_crp_descriptor_pool = nullptr;
+        bv::DescriptorSetPtr fcp_descriptor_set;
+        bv::DescriptorSetPtr crp_descriptor_set;
+
+        // fused cost pass
+        bv::PipelineLayoutPtr fcp_pipeline_layout = nullptr;
+        bv::ComputePipelinePtr fcp_compute_pipeline = nullptr;
+        CostPassCompPushConstants fcp_push_constants;
+
+        // cost reduction pass
+        bv::PipelineLayoutPtr crp_pipeline_layout = nullptr;
+        bv::ComputePipelinePtr crp_compute_pipeline = nullptr;
+
+        // cost info pass: descriptor stuff
+        bv::DescriptorSetLayoutPtr cip_descriptor_set_layout = nullptr;
+        bv::DescriptorPoolPtr cip_descriptor_pool = nullptr;
+        bv::DescriptorSetPtr cip_descriptor_set;
+
+        // cost info pass
+        bv::PipelineLayoutPtr cip_pipeline_layout = nullptr;
+        bv::ComputePipelinePtr cip_compute_pipeline = nullptr;
+
+        // displacement pass
+        bv::DescriptorSetLayoutPtr dsp_descriptor_set_layout = nullptr;
+        bv::PipelineLayoutPtr dsp_pipeline_layout = nullptr;
+        bv::ComputePipelinePtr dsp_compute_pipeline = nullptr;
+        DisplacementPassCompPushConstants dsp_push_constants;
+
+        // accept pass
+        bv::DescriptorSetLayoutPtr acp_descriptor_set_layout = nullptr;
+        bv::PipelineLayoutPtr acp_pipeline_layout = nullptr;
+        bv::ComputePipelinePtr acp_compute_pipeline = nullptr;
+
+        // grid warp, difference, and cost passes all recorded in one command
+        // buffer, and the same with the fused cost pass. see evaluate().
+        bv::CommandBufferPtr eval_cmd_buf = nullptr;
+        bv::CommandBufferPtr eval_fused_cmd_buf = nullptr;
+        bv::FencePtr eval_fence = nullptr;
+
+        // dirty rectangle evaluation, see evaluate_dirty_rect(). the command
+        // buffer is recorded again every time so it has its own pool that
+        // allows resetting it. evaluate_transformed() uses it too.
+        // dirty_rect_state_valid means warped_img, the partial sums, and the
+        // cost image match the current vertices except in pending_dirty_rect,
+        // which is where a rejected displacement was rendered.
+        bv::CommandPoolPtr dirty_cmd_pool = nullptr;
+        bv::CommandBufferPtr dirty_cmd_buf = nullptr;
+        bool dirty_rect_state_valid = false;
+        std::optional<VkRect2D> pending_dirty_rect;
+
+        // pipelined warp optimization, see optimize_warp_pipelined().
+        // pipeline_in_flight has indices of the submitted slots in submission
+        // order and pipeline_free_slots has the rest.
+        // the slots only exist if pipelining will be used, see the
+        // constructor.
+        std::vector<WarpCandidateSlot> pipeline_slots;
+        std::deque<uint32_t> pipeline_in_flight;
+        std::vector<uint32_t> pipeline_free_slots;
+        bv::DescriptorPoolPtr pipeline_descriptor_pool = nullptr;
+
+        // batched warp optimization, see optimize_warp_batched(). the batch
+        // images have batch_size layers, one for every candidate, and we make
+        // a separate image view, framebuffer, partial sums buffer, and
+        // descriptor sets for every layer. the vertex buffer and the cost
+        // cache buffer have batch_size regions one after another. the
+        // candidates always use the fused cost pass so there's no batch
+        // difference image.
+
+        uint32_t batch_size = 1;
+
+        bv::BufferPtr batch_vertex_buf = nullptr;
+        bv::MemoryChunkPtr batch_vertex_buf_mem = nullptr;
+        glm::vec2* batch_vertex_buf_mapped = nullptr;
+
+        bv::ImagePtr batch_warped_img = nullptr;
+        bv::MemoryChunkPtr batch_warped_img_mem = nullptr;
+        std::vector<bv::ImageViewPtr> batch_warped_imgviews;
+
+        bv::ImagePtr batch_cost_img = nullptr;
+        bv::MemoryChunkPtr batch_cost_img_mem = nullptr;
+        std::vector<bv::ImageViewPtr> batch_cost_imgviews;
+
+        // the tree of the accepted candidate is swapped with cost_cache_tree
+        bv::BufferPtr batch_cost_cache_buf = nullptr;
+        bv::MemoryChunkPtr batch_cost_cache_buf_mem = nullptr;
+        float* batch_cost_cache_buf_mapped = nullptr;
+        std::vector<SumMaxTree> batch_cost_trees;
+
+        std::vector<bv::BufferPtr> batch_partial_sums_bufs;
+        std::vector<bv::MemoryChunkPtr> batch_partial_sums_buf_mems;
+
+        bv::DescriptorPoolPtr batch_descriptor_pool = nullptr;
+        std::vector<bv::DescriptorSetPtr> batch_fcp_descriptor_sets;
+        std::vector<bv::DescriptorSetPtr> batch_crp_descriptor_sets;
+
+        std::vector<bv::FramebufferPtr> batch_gwp_framebufs;
+
+        bv::CommandBufferPtr batch_cmd_buf = nullptr;
+        bv::FencePtr batch_fence = nullptr;
+
+        // GPU-resident warp optimization, see optimize_warp_resident(). the
+        // accepted warped positions stay in vertex_buf and every candidate is
+        // written to resident_candidate_vertex_buf and rendered to
+        // warped_img. the
+        // warp buffer has resident_iters WarpParams's and the history buffer
+        // has resident_iters floats, both host-visible.
+
+        uint32_t resident_iters = 1;
+
+        bv::BufferPtr resident_candidate_vertex_buf = nullptr;
+        bv::MemoryChunkPtr resident_candidate_vertex_buf_mem = nullptr;
+
+        bv::BufferPtr resident_warp_buf = nullptr;
+        bv::MemoryChunkPtr resident_warp_buf_mem = nullptr;
+        WarpParams* resident_warp_buf_mapped = nullptr;
+
+        bv::BufferPtr resident_state_buf = nullptr;
+        bv::MemoryChunkPtr resident_state_buf_mem = nullptr;
+        ResidentState* resident_state_buf_mapped = nullptr;
+
+        bv::BufferPtr resident_cost_info_buf = nullptr;
+        bv::MemoryChunkPtr resident_cost_info_buf_mem = nullptr;
+
+        bv::BufferPtr resident_history_buf = nullptr;
+        bv::MemoryChunkPtr resident_history_buf_mem = nullptr;
+        float* resident_history_buf_mapped = nullptr;
+
+        bv::DescriptorPoolPtr resident_descriptor_pool = nullptr;
+        bv::DescriptorSetPtr resident_cip_descriptor_set;
+        bv::DescriptorSetPtr dsp_descriptor_set;
+        bv::DescriptorSetPtr acp_descriptor_set;
+
+        bv::CommandBufferPtr resident_cmd_buf = nullptr;
+        bv::FencePtr resident_fence = nullptr;
 
     };
 
@@ -3,7 +3,7 @@
 namespace img_aligner
 {
 
-    const bv::CommandPoolPtr& AppState::cmd_pool(bool transient)
+    const bv::CommandPoolPtr& AppState::cmd_pool()
     {
         if (!device)
         {
@@ -12,27 +12,75 @@ namespace img_aligner
             );
         }
 
-        std::unordered_map<std::thread::id, bv::CommandPoolPtr>& pools =
-            transient ? transient_cmd_pools : cmd_pools;
-
         auto thread_id = std::this_thread::get_id();
-        if (!pools.contains(thread_id))
+        if (!cmd_pools.contains(thread_id))
         {
-            VkCommandPoolCreateFlags flags = 0;
-            if (transient)
-            {
-                flags |= VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
-            }
-
-            pools[thread_id] = bv::CommandPool::create(
+            cmd_pools[thread_id] = bv::CommandPool::create(
                 device,
                 {
-                    .flags = flags,
+                    .flags = 0,
                     .queue_family_index = queue_main->queue_family_index()
                 }
             );
         }
-        return pools[thread_id];
+        return cmd_pools[thread_id];
+    }
+
+    SingleTimeCmdPool& AppState::single_time_cmd_pool()
+    {
+        if (!device)
+        {
+            throw std::runtime_error(
+                "single time command pool requested before device creation"
+            );
+        }
+
+        std::scoped_lock lock(single_time_cmd_pools_mutex);
+
+        auto& pool = single_time_cmd_pools[std::this_thread::get_id()];
+        if (!pool)
+        {
+            pool = std::make_unique<SingleTimeCmdPool>(
+                device,
+                queue_main->queue_family_index()
+            );
+        }
+        return *pool;
+    }
+
+    void AppState::release_single_time_cmd_pool()
+    {
+        std::scoped_lock lock(single_time_cmd_pools_mutex);
+        single_time_cmd_pools.erase(std::this_thread::get_id());
+    }
+
+    StagingRing& AppState::staging_ring(
+        const bv::QueuePtr& queue,
+        bool readback
+    )
+    {
+        if (!device)
+        {
+            throw std::runtime_error(
+                "staging ring requested before device creation"
+            );
+        }
+
+        std::scoped_lock lock(staging_rings_mutex);
+
+        std::unordered_map<VkQueue, std::unique_ptr<StagingRing>>& rings =
+            readback ? readback_staging_rings : upload_staging_rings;
+
+        auto& ring = rings[queue->handle()];
+        if (!ring)
+        {
+            ring = std::make_unique<StagingRing>(
+                *this,
+                STAGING_RING_SIZE,
+                readback
+            );
+        }
+        return *ring;
     }
 
 }
@@ -1,6 +1,8 @@
 #pragma once
 
 #include "common.hpp"
+#include "single_time_cmd_pool.hpp"
+#include "staging_ring.hpp"
 
 namespace img_aligner
 {
@@ -26,12 +28,34 @@ namespace img_aligner
 
         // command pools for every thread
         std::unordered_map<std::thread::id, bv::CommandPoolPtr> cmd_pools;
-        std::unordered_map<std::thread::id, bv::CommandPoolPtr>
-            transient_cmd_pools;
 
         // lazy initialize the command pools so they are created on the right
         // thread based on std::this_thread::get_id().
-        const bv::CommandPoolPtr& cmd_pool(bool transient);
+        const bv::CommandPoolPtr& cmd_pool();
+
+        // recycled command buffers and fences for one-time commands on every
+        // thread
+        std::unordered_map<std::thread::id, std::unique_ptr<SingleTimeCmdPool>>
+            single_time_cmd_pools;
+        std::mutex single_time_cmd_pools_mutex;
+
+        // lazy initialize the single time command pools like the command
+        // pools
+        SingleTimeCmdPool& single_time_cmd_pool();
+
+        // destroy this thread's single time command pool. worker threads
+        // should call this before they exit.
+        void release_single_time_cmd_pool();
+
+        // persistent staging memory for uploads and readbacks on every queue
+        std::unordered_map<VkQueue, std::unique_ptr<StagingRing>>
+            upload_staging_rings;
+        std::unordered_map<VkQueue, std::unique_ptr<StagingRing>>
+            readback_staging_rings;
+        std::mutex staging_rings_mutex;
+
+        // lazy initialize the staging rings like the command pools
+        StagingRing& staging_ring(const bv::QueuePtr& queue, bool readback);
 
         bv::DescriptorPoolPtr imgui_descriptor_pool = nullptr;
         uint32_t imgui_swapchain_min_image_count = 0;
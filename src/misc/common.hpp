@@ -5,12 +5,14 @@
 #include <filesystem>
 #include <string>
 #include <vector>
+#include <deque>
 #include <array>
 #include <span>
 #include <memory>
 #include <mutex>
 #include <shared_mutex>
 #include <thread>
+#include <future>
 #include <atomic>
 #include <unordered_map>
 #include <set>
@@ -45,6 +47,7 @@
 #define GLM_ENABLE_EXPERIMENTAL
 #include "glm/glm.hpp"
 #include "glm/gtc/matrix_transform.hpp"
+#include "glm/gtc/packing.hpp"
 
 #include "stb/stb_image.h"
 #include "stb/stb_image_write.h"
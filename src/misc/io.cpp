@@ -1,9 +1,13 @@
 #include "io.hpp"
 
 #include "OpenEXR/ImfRgbaFile.h"
+#include "OpenEXR/ImfInputFile.h"
 #include "OpenEXR/ImfOutputFile.h"
+#include "OpenEXR/ImfTiledOutputFile.h"
 #include "OpenEXR/ImfArray.h"
 #include "OpenEXR/ImfChannelList.h"
+#include "OpenEXR/ImfCompressor.h"
+#include "OpenEXR/ImfThreading.h"
 
 #ifdef WINDOWS
 #define NOMINMAX
@@ -84,12 +88,292 @@ namespace img_aligner
 #endif
     }
 
-    void load_image(
-        AppState& state,
+    static Imf::Compression to_imf_compression(ExrCompression v)
+    {
+        switch (v)
+        {
+        case ExrCompression::None:
+            return Imf::Compression::NO_COMPRESSION;
+        case ExrCompression::Zip:
+            return Imf::Compression::ZIP_COMPRESSION;
+        case ExrCompression::Zips:
+            return Imf::Compression::ZIPS_COMPRESSION;
+        case ExrCompression::Piz:
+            return Imf::Compression::PIZ_COMPRESSION;
+        case ExrCompression::Dwaa:
+            return Imf::Compression::DWAA_COMPRESSION;
+        case ExrCompression::Dwab:
+            return Imf::Compression::DWAB_COMPRESSION;
+        default:
+            throw std::invalid_argument("invalid OpenEXR compression");
+        }
+    }
+
+    const char* ExrCompression_to_str(ExrCompression v)
+    {
+        switch (v)
+        {
+        case ExrCompression::None:
+            return "None";
+        case ExrCompression::Zip:
+            return "ZIP";
+        case ExrCompression::Zips:
+            return "ZIPS";
+        case ExrCompression::Piz:
+            return "PIZ";
+        case ExrCompression::Dwaa:
+            return "DWAA";
+        case ExrCompression::Dwab:
+            return "DWAB";
+        default:
+            return "Invalid";
+        }
+    }
+
+    const char* ExrPixelType_to_str(ExrPixelType v)
+    {
+        switch (v)
+        {
+        case ExrPixelType::Half:
+            return "Half";
+        case ExrPixelType::Float:
+            return "Float";
+        default:
+            return "Invalid";
+        }
+    }
+
+    void set_exr_thread_count(uint32_t n_threads)
+    {
+        Imf::setGlobalThreadCount((int)n_threads);
+    }
+
+    // the frame buffers are always RGBA F32, OpenEXR converts to the pixel
+    // type in the header while writing.
+    static Imf::Header make_rgba_exr_header(
+        uint32_t width,
+        uint32_t height,
+        const ExrOptions& exr_options
+    )
+    {
+        Imf::Header header(
+            (int)width,
+            (int)height,
+            1.f,
+            { 0.f, 0.f },
+            1.f,
+            Imf::LineOrder::INCREASING_Y,
+            to_imf_compression(exr_options.compression)
+        );
+
+        Imf::PixelType pixel_type =
+            exr_options.pixel_type == ExrPixelType::Half
+            ? Imf::PixelType::HALF
+            : Imf::PixelType::FLOAT;
+        header.channels().insert("R", Imf::Channel(pixel_type));
+        header.channels().insert("G", Imf::Channel(pixel_type));
+        header.channels().insert("B", Imf::Channel(pixel_type));
+        header.channels().insert("A", Imf::Channel(pixel_type));
+        return header;
+    }
+
+    // pixels is a width x height block of RGBA F32 pixels whose top left
+    // corner is at origin in the file
+    static Imf::FrameBuffer make_rgbaf32_exr_frame_buffer(
+        float* pixels,
+        const Imath::V2i& origin,
+        uint32_t width,
+        uint32_t height
+    )
+    {
+        Imf::FrameBuffer fb;
+        const char* channel_names[4]{ "R", "G", "B", "A" };
+        for (size_t i = 0; i < 4; i++)
+        {
+            fb.insert(
+                channel_names[i],
+                Imf::Slice::Make(
+                    Imf::FLOAT,
+                    pixels + i,
+                    origin,
+                    width,
+                    height,
+                    4 * sizeof(float),
+                    width * 4 * sizeof(float)
+                )
+            );
+        }
+        return fb;
+    }
+
+    static VkFormat texture_format(bool half_precision)
+    {
+        return half_precision
+            ? VK_FORMAT_R16G16B16A16_SFLOAT
+            : VK_FORMAT_R32G32B32A32_SFLOAT;
+    }
+
+    // the decoders below pass the image to a sink along with a function that
+    // writes rows of pixels in the texture format, bottom row first, so the
+    // pixels can go straight to where they're needed. fill_rows is only valid
+    // during the call.
+    using DecodedImageSink = std::function<void(
+        uint32_t width,
+        uint32_t height,
+        VkFormat format,
+        size_t row_size_bytes,
+        const std::function<void(
+            uint32_t first_row,
+            uint32_t n_rows,
+            uint8_t* dst
+            )>& fill_rows
+        )>;
+
+    // fallback for EXR files without RGB channels
+    static void decode_exr_image_rgba_half(
         const std::filesystem::path& path,
-        bv::ImagePtr& img,
-        bv::MemoryChunkPtr& img_mem,
-        bv::ImageViewPtr& imgview
+        bool half_precision,
+        const DecodedImageSink& sink
+    )
+    {
+        Imf::RgbaInputFile f(path.string().c_str());
+        Imath::Box2i dw = f.dataWindow();
+        int32_t width = dw.max.x - dw.min.x + 1;
+        int32_t height = dw.max.y - dw.min.y + 1;
+
+        // only the requested rows are read, then flipped vertically while
+        // converting from half float to float unless the texture is half
+        // float too
+        std::vector<Imf::Rgba> pixels;
+        size_t channel_size_bytes =
+            half_precision ? sizeof(uint16_t) : sizeof(float);
+        sink(
+            width,
+            height,
+            texture_format(half_precision),
+            width * 4 * channel_size_bytes,
+            [&](uint32_t first_row, uint32_t n_rows, uint8_t* dst)
+            {
+                int32_t last_scanline = dw.max.y - (int32_t)first_row;
+                int32_t first_scanline = last_scanline - (int32_t)n_rows + 1;
+
+                pixels.resize((size_t)width * n_rows);
+                f.setFrameBuffer(
+                    pixels.data() - dw.min.x
+                    - ((ptrdiff_t)first_scanline * width),
+                    1,
+                    width
+                );
+                f.readPixels(first_scanline, last_scanline);
+
+                for (uint32_t y = 0; y < n_rows; y++)
+                {
+                    const Imf::Rgba* src_row = pixels.data()
+                        + ((size_t)(n_rows - y - 1) * width);
+
+                    if (half_precision)
+                    {
+                        // Imf::Rgba is 4 halfs in RGBA order
+                        std::copy(
+                            (const uint8_t*)src_row,
+                            (const uint8_t*)(src_row + width),
+                            dst + ((size_t)y * width * sizeof(Imf::Rgba))
+                        );
+                        continue;
+                    }
+
+                    float* dst_f32 = (float*)dst;
+                    for (int32_t x = 0; x < width; x++)
+                    {
+                        size_t dst_red_idx = ((size_t)y * width + x) * 4;
+                        dst_f32[dst_red_idx + 0] = (float)src_row[x].r;
+                        dst_f32[dst_red_idx + 1] = (float)src_row[x].g;
+                        dst_f32[dst_red_idx + 2] = (float)src_row[x].b;
+                        dst_f32[dst_red_idx + 3] = (float)src_row[x].a;
+                    }
+                }
+            }
+        );
+    }
+
+    // decodes the EXR file straight into the sink's memory (like the staging
+    // memory that uploads a texture), in 32-bit or 16-bit float (see
+    // half_precision) regardless of the pixel type in the file. the first row
+    // is the file's last scanline so the slices walk the memory backwards
+    // with a negative y stride.
+    static void decode_exr_image(
+        const std::filesystem::path& path,
+        bool half_precision,
+        const DecodedImageSink& sink
+    )
+    {
+        Imf::InputFile f(path.string().c_str());
+        const Imath::Box2i& dw = f.header().dataWindow();
+        int32_t width = dw.max.x - dw.min.x + 1;
+        int32_t height = dw.max.y - dw.min.y + 1;
+
+        // luminance and luminance/chroma files need RgbaInputFile to convert
+        // them to RGB
+        const Imf::ChannelList& channels = f.header().channels();
+        if (channels.findChannel("R") == nullptr
+            && channels.findChannel("G") == nullptr
+            && channels.findChannel("B") == nullptr)
+        {
+            decode_exr_image_rgba_half(path, half_precision, sink);
+            return;
+        }
+
+        Imf::PixelType slice_type =
+            half_precision ? Imf::PixelType::HALF : Imf::PixelType::FLOAT;
+        size_t channel_size_bytes =
+            half_precision ? sizeof(uint16_t) : sizeof(float);
+        size_t pixel_size_bytes = 4 * channel_size_bytes;
+        size_t row_size_bytes = width * pixel_size_bytes;
+        sink(
+            width,
+            height,
+            texture_format(half_precision),
+            row_size_bytes,
+            [&](uint32_t first_row, uint32_t n_rows, uint8_t* dst)
+            {
+                // scanline dw.max.y - first_row goes to the start of dst and
+                // every scanline above it goes one row further
+                int32_t last_scanline = dw.max.y - (int32_t)first_row;
+                int32_t first_scanline = last_scanline - (int32_t)n_rows + 1;
+                char* base =
+                    (char*)dst
+                    - ((ptrdiff_t)dw.min.x * (ptrdiff_t)pixel_size_bytes)
+                    + ((ptrdiff_t)last_scanline * (ptrdiff_t)row_size_bytes);
+
+                Imf::FrameBuffer fb;
+                const char* channel_names[4]{ "R", "G", "B", "A" };
+                for (size_t i = 0; i < 4; i++)
+                {
+                    // missing channels are filled with 0 except alpha which
+                    // is opaque
+                    fb.insert(
+                        channel_names[i],
+                        Imf::Slice(
+                            slice_type,
+                            base + (i * channel_size_bytes),
+                            pixel_size_bytes,
+                            (size_t)(-(ptrdiff_t)row_size_bytes),
+                            1,
+                            1,
+                            i == 3 ? 1. : 0.
+                        )
+                    );
+                }
+                f.setFrameBuffer(fb);
+                f.readPixels(first_scanline, last_scanline);
+            }
+        );
+    }
+
+    static void decode_image(
+        const std::filesystem::path& path,
+        bool half_precision,
+        const DecodedImageSink& sink
     )
     {
         if (!std::filesystem::exists(path))
@@ -103,45 +387,12 @@ namespace img_aligner
             );
         }
 
-        int32_t width = 0, height = 0;
-        std::vector<float> pixels_rgbaf32;
-
         // get the file extension
         std::string file_ext = lowercase(path.extension().string());
 
         if (file_ext == ".exr")
         {
-            Imf::RgbaInputFile f(path.string().c_str());
-            Imath::Box2i dw = f.dataWindow();
-            width = dw.max.x - dw.min.x + 1;
-            height = dw.max.y - dw.min.y + 1;
-
-            std::vector<Imf::Rgba> pixels(width * height);
-
-            f.setFrameBuffer(pixels.data(), 1, width);
-            f.readPixels(dw.min.y, dw.max.y);
-
-            // copy pixels by pixels while flipping vertically and converting
-            // from half float to float.
-            pixels_rgbaf32.resize(width * height * 4);
-            for (int32_t y = 0; y < height; y++)
-            {
-                for (int32_t x = 0; x < width; x++)
-                {
-                    // flip vertically
-                    int32_t src_pixel_idx = x + (height - y - 1) * width;
-                    int32_t dst_red_idx = (x + (y * width)) * 4;
-
-                    pixels_rgbaf32[dst_red_idx + 0] =
-                        (float)pixels[src_pixel_idx].r;
-                    pixels_rgbaf32[dst_red_idx + 1] =
-                        (float)pixels[src_pixel_idx].g;
-                    pixels_rgbaf32[dst_red_idx + 2] =
-                        (float)pixels[src_pixel_idx].b;
-                    pixels_rgbaf32[dst_red_idx + 3] =
-                        (float)pixels[src_pixel_idx].a;
-                }
-            }
+            decode_exr_image(path, half_precision, sink);
         }
         else if (file_ext == ".png"
             || file_ext == ".jpg"
@@ -149,6 +400,7 @@ namespace img_aligner
         {
             // this will perform the necessary conversions from sRGB 2.2 to
             // Linear BT.709 I-D65 if needed.
+            int32_t width = 0, height = 0;
             float* pixels = stbi_loadf_throw(
                 path.string().c_str(),
                 &width,
@@ -157,19 +409,56 @@ namespace img_aligner
                 4 // RGBA
             );
 
-            // copy row by row while flipping vertically
-            pixels_rgbaf32.resize(width * height * 4);
-            for (int32_t y = 0; y < height; y++)
+            // copy row by row into the sink's memory while flipping
+            // vertically, converting to half float if needed
+            size_t channel_size_bytes =
+                half_precision ? sizeof(uint16_t) : sizeof(float);
+            size_t row_size_bytes = width * 4 * channel_size_bytes;
+            try
             {
-                int32_t src_red_idx = ((height - y - 1) * width) * 4;
-                int32_t dst_red_idx = (y * width) * 4;
-
-                std::copy(
-                    pixels + src_red_idx,
-                    pixels + src_red_idx + (width * 4),
-                    pixels_rgbaf32.data() + dst_red_idx
+                sink(
+                    width,
+                    height,
+                    texture_format(half_precision),
+                    row_size_bytes,
+                    [pixels, width, height, half_precision](
+                        uint32_t first_row,
+                        uint32_t n_rows,
+                        uint8_t* dst
+                        )
+                    {
+                        for (uint32_t y = 0; y < n_rows; y++)
+                        {
+                            const float* src_row = pixels
+                                + ((size_t)(height - (first_row + y) - 1)
+                                    * width * 4);
+                            size_t dst_red_idx = (size_t)y * width * 4;
+
+                            if (half_precision)
+                            {
+                                uint16_t* dst_f16 = (uint16_t*)dst;
+                                for (size_t i = 0; i < (size_t)width * 4; i++)
+                                {
+                                    dst_f16[dst_red_idx + i] =
+                                        glm::packHalf1x16(src_row[i]);
+                                }
+                                continue;
+                            }
+
+                            std::copy(
+                                src_row,
+                                src_row + (width * 4),
+                                (float*)dst + dst_red_idx
+                            );
+                        }
+                    }
                 );
             }
+            catch (const std::exception&)
+            {
+                stbi_image_free(pixels);
+                throw;
+            }
 
             stbi_image_free(pixels);
         }
@@ -179,19 +468,126 @@ namespace img_aligner
                 "unsupported file extension for loading images"
             );
         }
+    }
 
-        create_texture(
-            state,
-            state.queue_main,
-            width,
-            height,
-            VK_FORMAT_R32G32B32A32_SFLOAT,
-            pixels_rgbaf32.data(),
-            pixels_rgbaf32.size() * sizeof(pixels_rgbaf32[0]),
-            true,
-            img,
-            img_mem,
-            imgview
+    void load_image(
+        AppState& state,
+        const bv::QueuePtr& queue,
+        const std::filesystem::path& path,
+        bool half_precision,
+        bv::ImagePtr& img,
+        bv::MemoryChunkPtr& img_mem,
+        bv::ImageViewPtr& imgview
+    )
+    {
+        decode_image(
+            path,
+            half_precision,
+            [&](
+                uint32_t width,
+                uint32_t height,
+                VkFormat format,
+                size_t row_size_bytes,
+                const std::function<void(
+                    uint32_t first_row,
+                    uint32_t n_rows,
+                    uint8_t* dst
+                    )>& fill_rows
+                )
+            {
+                create_texture(
+                    state,
+                    queue,
+                    width,
+                    height,
+                    format,
+                    row_size_bytes,
+                    fill_rows,
+                    true,
+                    img,
+                    img_mem,
+                    imgview
+                );
+            }
+        );
+    }
+
+    std::shared_ptr<TiledImage> load_tiled_image(
+        const std::filesystem::path& path,
+        bool half_precision,
+        uint32_t tile_size
+    )
+    {
+        std::shared_ptr<TiledImage> tiled_img = nullptr;
+        decode_image(
+            path,
+            half_precision,
+            [&](
+                uint32_t width,
+                uint32_t height,
+                VkFormat format,
+                [[maybe_unused]] size_t row_size_bytes,
+                const std::function<void(
+                    uint32_t first_row,
+                    uint32_t n_rows,
+                    uint8_t* dst
+                    )>& fill_rows
+                )
+            {
+                tiled_img = std::make_shared<TiledImage>(
+                    width,
+                    height,
+                    format,
+                    tile_size
+                );
+                tiled_img->store(fill_rows);
+            }
+        );
+        return tiled_img;
+    }
+
+    std::future<LoadedImage> load_image_async(
+        AppState& state,
+        const bv::QueuePtr& queue,
+        const std::filesystem::path& path,
+        bool half_precision,
+        uint32_t tile_size
+    )
+    {
+        return std::async(
+            std::launch::async,
+            [&state, queue, path, half_precision, tile_size]()
+            {
+                // tiled images are only decoded here, they're uploaded when
+                // they're used
+                LoadedImage result;
+                if (tile_size > 0)
+                {
+                    result.tiled_img =
+                        load_tiled_image(path, half_precision, tile_size);
+                    return result;
+                }
+
+                try
+                {
+                    load_image(
+                        state,
+                        queue,
+                        path,
+                        half_precision,
+                        result.img,
+                        result.img_mem,
+                        result.imgview
+                    );
+                }
+                catch (const std::exception&)
+                {
+                    state.release_single_time_cmd_pool();
+                    throw;
+                }
+                state.release_single_time_cmd_pool();
+                return result;
+            }
         );
     }
 
@@ -199,7 +595,8 @@ namespace img_aligner
         AppState& state,
         const bv::ImagePtr& img,
         const std::filesystem::path& path,
-        float mul
+        float mul,
+        const ExrOptions& exr_options
     )
     {
         std::vector<float> pixels_rgbaf32 =
@@ -243,61 +640,29 @@ namespace img_aligner
 
         if (file_ext == ".exr")
         {
-            Imf::Header header(
-                (int)width,
-                (int)height,
-                1.f,
-                { 0.f, 0.f },
-                1.f,
-                Imf::LineOrder::INCREASING_Y,
-                Imf::Compression::DWAB_COMPRESSION
-            );
-            header.channels().insert("R", Imf::Channel(Imf::PixelType::FLOAT));
-            header.channels().insert("G", Imf::Channel(Imf::PixelType::FLOAT));
-            header.channels().insert("B", Imf::Channel(Imf::PixelType::FLOAT));
-            header.channels().insert("A", Imf::Channel(Imf::PixelType::FLOAT));
-
-            Imf::FrameBuffer fb;
-            fb.insert(
-                "R",
-                Imf::Slice(
-                    Imf::FLOAT,
-                    (char*)pixels_rgbaf32.data(),
-                    4 * sizeof(float),
-                    width * 4 * sizeof(float)
-                )
-            );
-            fb.insert(
-                "G",
-                Imf::Slice(
-                    Imf::FLOAT,
-                    (char*)(pixels_rgbaf32.data() + 1),
-                    4 * sizeof(float),
-                    width * 4 * sizeof(float)
-                )
-            );
-            fb.insert(
-                "B",
-                Imf::Slice(
-                    Imf::FLOAT,
-                    (char*)(pixels_rgbaf32.data() + 2),
-                    4 * sizeof(float),
-                    width * 4 * sizeof(float)
-                )
-            );
-            fb.insert(
-                "A",
-                Imf::Slice(
-                    Imf::FLOAT,
-                    (char*)(pixels_rgbaf32.data() + 3),
-                    4 * sizeof(float),
-                    width * 4 * sizeof(float)
-                )
+            Imf::Header header =
+                make_rgba_exr_header(width, height, exr_options);
+            Imf::FrameBuffer fb = make_rgbaf32_exr_frame_buffer(
+                pixels_rgbaf32.data(),
+                { 0, 0 },
+                width,
+                height
             );
 
             Imf::OutputFile f(path.string().c_str(), header);
             f.setFrameBuffer(fb);
-            f.writePixels(height);
+
+            // write in blocks that give every OpenEXR thread a whole line
+            // buffer (the number of scanlines the compression works on at
+            // once) so they compress in parallel
+            uint32_t lines_per_block = (uint32_t)(
+                Imf::numLinesInBuffer(header.compression())
+                * std::max(Imf::globalThreadCount(), 1)
+                );
+            for (uint32_t y = 0; y < height; y += lines_per_block)
+            {
+                f.writePixels((int)std::min(lines_per_block, height - y));
+            }
         }
         else if (file_ext == ".png")
         {
@@ -345,4 +710,79 @@ namespace img_aligner
         }
     }
 
+    void save_image_tiled(
+        const std::filesystem::path& path,
+        uint32_t width,
+        uint32_t height,
+        uint32_t tile_size,
+        const std::function<std::vector<float>(
+            uint32_t x,
+            uint32_t y,
+            uint32_t tile_width,
+            uint32_t tile_height
+            )>& render_tile,
+        float mul,
+        const ExrOptions& exr_options
+    )
+    {
+        if (lowercase(path.extension().string()) != ".exr")
+        {
+            throw std::invalid_argument(
+                "only OpenEXR images can be saved in tiles"
+            );
+        }
+        if (tile_size < 1)
+        {
+            throw std::invalid_argument("tile size must be at least 1");
+        }
+
+        Imf::Header header = make_rgba_exr_header(width, height, exr_options);
+        header.setTileDescription(
+            Imf::TileDescription(tile_size, tile_size, Imf::ONE_LEVEL)
+        );
+        Imf::TiledOutputFile f(path.string().c_str(), header);
+
+        // render a whole row of tiles and write it in one go so OpenEXR can
+        // compress the tiles in parallel. go in the same order as the line
+        // order in the header so the tiles don't have to be buffered by
+        // OpenEXR.
+        std::vector<float> row_pixels_rgbaf32;
+        for (uint32_t y = 0; y < height; y += tile_size)
+        {
+            uint32_t tile_height = std::min(tile_size, height - y);
+            row_pixels_rgbaf32.resize((size_t)width * tile_height * 4);
+
+            for (uint32_t x = 0; x < width; x += tile_size)
+            {
+                uint32_t tile_width = std::min(tile_size, width - x);
+
+                std::vector<float> pixels_rgbaf32 =
+                    render_tile(x, y, tile_width, tile_height);
+
+                // copy to the row while applying the multiplier, skip the
+                // alpha channel
+                for (uint32_t ty = 0; ty < tile_height; ty++)
+                {
+                    const float* src =
+                        pixels_rgbaf32.data() + ((size_t)ty * tile_width * 4);
+                    float* dst = row_pixels_rgbaf32.data()
+                        + (((size_t)ty * width + x) * 4);
+                    for (size_t i = 0; i < tile_width * 4; i++)
+                    {
+                        dst[i] = (i % 4 != 3) ? src[i] * mul : src[i];
+                    }
+                }
+            }
+
+            f.setFrameBuffer(make_rgbaf32_exr_frame_buffer(
+                row_pixels_rgbaf32.data(),
+                { 0, (int)y },
+                width,
+                tile_height
+            ));
+            int dy = (int)(y / tile_size);
+            f.writeTiles(0, f.numXTiles() - 1, dy, dy);
+        }
+    }
+
 }
@@ -2,6 +2,7 @@
 
 #include "common.hpp"
 #include "app_state.hpp"
+#include "tiled_image.hpp"
 
 namespace img_aligner
 {
@@ -90,19 +91,106 @@ namespace img_aligner
         );
     }
 
+    // OpenEXR output settings. these mirror the OpenEXR enums so the OpenEXR
+    // headers are only needed in io.cpp.
+    enum class ExrCompression
+    {
+        None,
+        Zip,
+        Zips,
+        Piz,
+        Dwaa,
+        Dwab
+    };
+
+    enum class ExrPixelType
+    {
+        Half,
+        Float
+    };
+
+    struct ExrOptions
+    {
+        ExrCompression compression = ExrCompression::Dwab;
+        ExrPixelType pixel_type = ExrPixelType::Float;
+    };
+
+    const char* ExrCompression_to_str(ExrCompression v);
+    const char* ExrPixelType_to_str(ExrPixelType v);
+
+    // number of worker threads OpenEXR uses to decode and encode files
+    // (globally). 0 disables threading.
+    void set_exr_thread_count(uint32_t n_threads);
+
+    // if half_precision is true, the texture will be R16G16B16A16_SFLOAT
+    // instead of R32G32B32A32_SFLOAT. half float EXR files are uploaded as-is
+    // in that case.
     void load_image(
         AppState& state,
+        const bv::QueuePtr& queue,
         const std::filesystem::path& path,
+        bool half_precision,
         bv::ImagePtr& img,
         bv::MemoryChunkPtr& img_mem,
         bv::ImageViewPtr& imgview
     );
 
+    // like load_image() but the image is decoded in bands into the temporary
+    // file of a TiledImage and uploaded to the GPU in tiles of tile_size when
+    // they're needed. PNG and JPEG images are still decoded as a whole first.
+    std::shared_ptr<TiledImage> load_tiled_image(
+        const std::filesystem::path& path,
+        bool half_precision,
+        uint32_t tile_size
+    );
+
+    struct LoadedImage
+    {
+        bv::ImagePtr img = nullptr;
+        bv::MemoryChunkPtr img_mem = nullptr;
+        bv::ImageViewPtr imgview = nullptr;
+
+        // set instead of the others when loading in tiles
+        std::shared_ptr<TiledImage> tiled_img = nullptr;
+    };
+
+    // load_image() on a worker thread so multiple images can be decoded and
+    // uploaded at the same time. a queue can't be used by multiple threads at
+    // once so give every load that runs at the same time its own queue. if
+    // tile_size isn't 0, load_tiled_image() is used instead.
+    std::future<LoadedImage> load_image_async(
+        AppState& state,
+        const bv::QueuePtr& queue,
+        const std::filesystem::path& path,
+        bool half_precision,
+        uint32_t tile_size = 0
+    );
+
     void save_image(
         AppState& state,
         const bv::ImagePtr& img,
         const std::filesystem::path& path,
-        float mul = 1.f
+        float mul = 1.f,
+        const ExrOptions& exr_options = {}
+    );
+
+    // write a tiled OpenEXR file one row of tiles at a time so the whole
+    // image never has to be in memory. render_tile is called for every tile in
+    // order and should return its pixels in RGBA F32 format, top row first
+    // like the file. x and y are the top left corner of the tile in the file.
+    void save_image_tiled(
+        const std::filesystem::path& path,
+        uint32_t width,
+        uint32_t height,
+        uint32_t tile_size,
+        const std::function<std::vector<float>(
+            uint32_t x,
+            uint32_t y,
+            uint32_t tile_width,
+            uint32_t tile_height
+            )>& render_tile,
+        float mul = 1.f,
+        const ExrOptions& exr_options = {}
     );
 
 }
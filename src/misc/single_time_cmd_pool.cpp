@@ -0,0 +1,121 @@
+#include "single_time_cmd_pool.hpp"
+
+namespace img_aligner
+{
+
+    bool SubmitTicket::is_done() const
+    {
+        return !slot || slot->fence->is_signaled();
+    }
+
+    void SubmitTicket::wait() const
+    {
+        if (slot)
+        {
+            slot->fence->wait();
+        }
+    }
+
+    SingleTimeCmdPool::SingleTimeCmdPool(
+        const bv::DevicePtr& device,
+        uint32_t queue_family_index
+    )
+        : device(device)
+    {
+        cmd_pool = bv::CommandPool::create(
+            device,
+            {
+                .flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT
+                | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
+                .queue_family_index = queue_family_index
+            }
+        );
+    }
+
+    SingleTimeCmdPool::~SingleTimeCmdPool()
+    {
+        for (auto& slot : slots)
+        {
+            if (slot->submitted)
+            {
+                slot->fence->wait();
+            }
+        }
+    }
+
+    bv::CommandBufferPtr SingleTimeCmdPool::acquire()
+    {
+        // find a slot that isn't being recorded, has no tickets, and whose
+        // last submission (if any) is done
+        std::shared_ptr<SingleTimeCmdSlot> slot = nullptr;
+        for (auto& s : slots)
+        {
+            if (s->recording || s.use_count() > 1)
+            {
+                continue;
+            }
+            if (s->submitted && !s->fence->is_signaled())
+            {
+                continue;
+            }
+            slot = s;
+            break;
+        }
+
+        if (slot)
+        {
+            if (slot->submitted)
+            {
+                slot->fence->reset();
+                slot->cmd_buf->reset(0);
+                slot->submitted = false;
+            }
+        }
+        else
+        {
+            slot = std::make_shared<SingleTimeCmdSlot>();
+            slot->cmd_buf = bv::CommandPool::allocate_buffer(
+                cmd_pool,
+                VK_COMMAND_BUFFER_LEVEL_PRIMARY
+            );
+            slot->fence = bv::Fence::create(device, 0);
+            slots.push_back(slot);
+        }
+
+        slot->cmd_buf->begin(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+        slot->recording = true;
+        return slot->cmd_buf;
+    }
+
+    SubmitTicket SingleTimeCmdPool::submit(
+        const bv::CommandBufferPtr& cmd_buf,
+        const bv::QueuePtr& queue
+    )
+    {
+        auto it = std::find_if(
+            slots.begin(),
+            slots.end(),
+            [&cmd_buf](const auto& s)
+            {
+                return s->cmd_buf == cmd_buf;
+            }
+        );
+        if (it == slots.end() || !(*it)->recording)
+        {
+            throw std::invalid_argument(
+                "command buffer wasn't acquired from this pool"
+            );
+        }
+        auto& slot = *it;
+
+        cmd_buf->end();
+        queue->submit({}, {}, { cmd_buf }, {}, slot->fence);
+        slot->recording = false;
+        slot->submitted = true;
+
+        SubmitTicket ticket;
+        ticket.slot = slot;
+        return ticket;
+    }
+
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "common.hpp"
+
+namespace img_aligner
+{
+
+    // a command buffer and the fence for its submission, recycled by
+    // SingleTimeCmdPool
+    struct SingleTimeCmdSlot
+    {
+        bv::CommandBufferPtr cmd_buf = nullptr;
+        bv::FencePtr fence = nullptr;
+        bool recording = false;
+        bool submitted = false;
+    };
+
+    // waitable handle for a submission made by SingleTimeCmdPool::submit().
+    // the command buffer and fence aren't recycled while a ticket (or a copy
+    // of it) is alive, so waiting on a ticket always waits for the right
+    // submission. a default constructed ticket is always done.
+    class SubmitTicket
+    {
+    public:
+        SubmitTicket() = default;
+
+        bool is_done() const;
+        void wait() const;
+
+    private:
+        std::shared_ptr<SingleTimeCmdSlot> slot = nullptr;
+
+        friend class SingleTimeCmdPool;
+
+    };
+
+    // hands out command buffers for one-time commands and recycles them along
+    // with their fences once their submissions are done, instead of
+    // allocating a command buffer and waiting for the whole queue every time.
+    // like command pools, this must only be used on the thread that created
+    // it, but tickets can be waited on from anywhere.
+    class SingleTimeCmdPool
+    {
+    public:
+        SingleTimeCmdPool(
+            const bv::DevicePtr& device,
+            uint32_t queue_family_index
+        );
+
+        // waits for the submissions that are still running
+        ~SingleTimeCmdPool();
+
+        SingleTimeCmdPool(const SingleTimeCmdPool&) = delete;
+        SingleTimeCmdPool& operator=(const SingleTimeCmdPool&) = delete;
+
+        // a command buffer in the recording state
+        bv::CommandBufferPtr acquire();
+
+        // end and submit a command buffer from acquire() without waiting
+        SubmitTicket submit(
+            const bv::CommandBufferPtr& cmd_buf,
+            const bv::QueuePtr& queue
+        );
+
+    private:
+        bv::DevicePtr device;
+        bv::CommandPoolPtr cmd_pool;
+        std::vector<std::shared_ptr<SingleTimeCmdSlot>> slots;
+
+    };
+
+}
@@ -0,0 +1,318 @@
+#include "staging_ring.hpp"
+
+#include "app_state.hpp"
+
+namespace img_aligner
+{
+
+    static VkDeviceSize align_up(VkDeviceSize v, VkDeviceSize alignment)
+    {
+        return ((v + alignment - 1) / alignment) * alignment;
+    }
+
+    // first memory type that has all the required properties and none of the
+    // avoided ones
+    static std::optional<uint32_t> find_staging_memory_type_idx(
+        const bv::PhysicalDeviceMemoryProperties& mem_props,
+        uint32_t supported_type_bits,
+        VkMemoryPropertyFlags required_properties,
+        VkMemoryPropertyFlags avoided_properties
+    )
+    {
+        for (uint32_t i = 0; i < mem_props.memory_types.size(); i++)
+        {
+            VkMemoryPropertyFlags flags =
+                mem_props.memory_types[i].property_flags;
+
+            if ((supported_type_bits & (1 << i))
+                && (flags & required_properties) == required_properties
+                && (flags & avoided_properties) == 0)
+            {
+                return i;
+            }
+        }
+        return std::nullopt;
+    }
+
+    StagingAllocation::StagingAllocation(StagingAllocation&& other) noexcept
+    {
+        *this = std::move(other);
+    }
+
+    StagingAllocation& StagingAllocation::operator=(
+        StagingAllocation&& other
+        ) noexcept
+    {
+        if (this != &other)
+        {
+            release();
+
+            ring = other.ring;
+            id = other.id;
+            _buffer = std::move(other._buffer);
+            memory = std::move(other.memory);
+            _offset = other._offset;
+            _size = other._size;
+            aligned_size = other.aligned_size;
+            _mapped = other._mapped;
+            ticket = std::move(other.ticket);
+
+            other.ring = nullptr;
+            other._mapped = nullptr;
+        }
+        return *this;
+    }
+
+    StagingAllocation::~StagingAllocation()
+    {
+        release();
+    }
+
+    void StagingAllocation::flush()
+    {
+        memory->flush_mapped_range(_offset, aligned_size);
+    }
+
+    void StagingAllocation::invalidate()
+    {
+        memory->invalidate_mapped_range(_offset, aligned_size);
+    }
+
+    void StagingAllocation::set_ticket(const SubmitTicket& ticket)
+    {
+        this->ticket = ticket;
+    }
+
+    void StagingAllocation::release()
+    {
+        if (ring != nullptr)
+        {
+            ring->release(id, ticket);
+            ring = nullptr;
+        }
+
+        _buffer = nullptr;
+        memory = nullptr;
+        _mapped = nullptr;
+        ticket = {};
+    }
+
+    StagingRing::StagingRing(
+        AppState& state,
+        VkDeviceSize capacity,
+        bool readback
+    )
+        : state(state), readback(readback)
+    {
+        const auto& limits = state.physical_device.value().properties().limits;
+        alignment = std::max(
+            alignment,
+            (VkDeviceSize)limits.non_coherent_atom_size
+        );
+
+        _capacity = align_up(std::max(capacity, (VkDeviceSize)1), alignment);
+        create_mapped_buffer(_capacity, buf, buf_mem, buf_mapped);
+    }
+
+    StagingAllocation StagingRing::allocate(VkDeviceSize size)
+    {
+        if (size < 1)
+        {
+            throw std::invalid_argument(
+                "staging allocation size must be at least 1 byte"
+            );
+        }
+
+        StagingAllocation alloc;
+        alloc._size = size;
+        alloc.aligned_size = align_up(size, alignment);
+
+        if (alloc.aligned_size <= _capacity)
+        {
+            std::scoped_lock lock(mutex);
+
+            // drop the finished allocations first so the space they had
+            // doesn't have to wait for the ring to fill up
+            while (!entries.empty()
+                && entries.front().released
+                && entries.front().ticket.is_done())
+            {
+                entries.pop_front();
+            }
+            if (entries.empty())
+            {
+                head = 0;
+            }
+
+            while (true)
+            {
+                auto offset = find_space(alloc.aligned_size);
+                if (offset)
+                {
+                    entries.push_back(Entry{
+                        .id = next_id++,
+                        .offset = *offset,
+                        .size = alloc.aligned_size,
+                        .released = false,
+                        .ticket = {}
+                        });
+                    head = *offset + alloc.aligned_size;
+
+                    alloc.ring = this;
+                    alloc.id = entries.back().id;
+                    alloc._buffer = buf;
+                    alloc.memory = buf_mem;
+                    alloc._offset = *offset;
+                    alloc._mapped = buf_mapped + *offset;
+                    return alloc;
+                }
+
+                // reclaim the oldest allocation if its owner is done with it,
+                // waiting for the GPU if needed. otherwise give up on the
+                // ring.
+                if (entries.empty() || !entries.front().released)
+                {
+                    break;
+                }
+                entries.front().ticket.wait();
+                entries.pop_front();
+                if (entries.empty())
+                {
+                    head = 0;
+                }
+            }
+        }
+
+        // the ring is too small or everything in it is still in use
+        create_mapped_buffer(
+            alloc.aligned_size,
+            alloc._buffer,
+            alloc.memory,
+            alloc._mapped
+        );
+        return alloc;
+    }
+
+    VkBufferUsageFlags StagingRing::buffer_usage() const
+    {
+        return readback
+            ? VK_BUFFER_USAGE_TRANSFER_DST_BIT
+            : VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+    }
+
+    std::optional<VkDeviceSize> StagingRing::find_space(
+        VkDeviceSize size
+    ) const
+    {
+        if (entries.empty())
+        {
+            return 0;
+        }
+
+        VkDeviceSize tail = entries.front().offset;
+        if (head > tail)
+        {
+            // the live allocations are in [tail, head). try the end first,
+            // then wrap around.
+            if (_capacity - head >= size)
+            {
+                return head;
+            }
+            if (tail >= size)
+            {
+                return 0;
+            }
+            return std::nullopt;
+        }
+
+        // the live allocations wrap around so the free space is [head, tail)
+        if (tail - head >= size)
+        {
+            return head;
+        }
+        return std::nullopt;
+    }
+
+    void StagingRing::create_mapped_buffer(
+        VkDeviceSize size,
+        bv::BufferPtr& out_buffer,
+        bv::DeviceMemoryPtr& out_memory,
+        uint8_t*& out_mapped
+    )
+    {
+        out_buffer = bv::Buffer::create(
+            state.device,
+            {
+                .flags = 0,
+                .size = size,
+                .usage = buffer_usage(),
+                .sharing_mode = VK_SHARING_MODE_EXCLUSIVE,
+                .queue_family_indices = {}
+            }
+        );
+
+        // the memory bank would happily give us any host-visible memory, but
+        // we want write-combined memory for uploads and cached memory for
+        // readbacks, so the ring and dedicated allocations get their own
+        // memory.
+        const auto& mem_props = state.physical_device->memory_properties();
+        const auto& requirements = out_buffer->memory_requirements();
+
+        std::optional<uint32_t> memory_type_idx = readback
+            ? find_staging_memory_type_idx(
+                mem_props,
+                requirements.memory_type_bits,
+                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT
+                | VK_MEMORY_PROPERTY_HOST_CACHED_BIT,
+                0
+            )
+            : find_staging_memory_type_idx(
+                mem_props,
+                requirements.memory_type_bits,
+                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT
+                | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                VK_MEMORY_PROPERTY_HOST_CACHED_BIT
+            );
+        if (!memory_type_idx)
+        {
+            memory_type_idx = find_staging_memory_type_idx(
+                mem_props,
+                requirements.memory_type_bits,
+                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT
+                | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                0
+            );
+        }
+        if (!memory_type_idx)
+        {
+            throw std::runtime_error(
+                "failed to find a suitable memory type for staging"
+            );
+        }
+
+        out_memory = bv::DeviceMemory::allocate(
+            state.device,
+            {
+                .allocation_size = requirements.size,
+                .memory_type_index = *memory_type_idx
+            }
+        );
+        out_buffer->bind_memory(out_memory, 0);
+        out_mapped = (uint8_t*)out_memory->map(0, VK_WHOLE_SIZE);
+    }
+
+    void StagingRing::release(uint64_t id, const SubmitTicket& ticket)
+    {
+        std::scoped_lock lock(mutex);
+        for (auto& entry : entries)
+        {
+            if (entry.id == id)
+            {
+                entry.released = true;
+                entry.ticket = ticket;
+                return;
+            }
+        }
+    }
+
+}
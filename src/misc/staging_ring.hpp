@@ -0,0 +1,158 @@
+#pragma once
+
+#include "common.hpp"
+#include "single_time_cmd_pool.hpp"
+
+namespace img_aligner
+{
+
+    struct AppState;
+    class StagingRing;
+
+    // capacity of the staging rings in AppState
+    static constexpr VkDeviceSize STAGING_RING_SIZE = 64 * 1024 * 1024;
+
+    // a piece of a StagingRing (or a dedicated buffer if the ring was too
+    // small or full). the space goes back to the ring when this is destroyed
+    // but the ring won't reuse it until the ticket, if any, is done.
+    class StagingAllocation
+    {
+    public:
+        StagingAllocation(const StagingAllocation&) = delete;
+        StagingAllocation& operator=(const StagingAllocation&) = delete;
+
+        StagingAllocation(StagingAllocation&& other) noexcept;
+        StagingAllocation& operator=(StagingAllocation&& other) noexcept;
+
+        ~StagingAllocation();
+
+        constexpr const bv::BufferPtr& buffer() const
+        {
+            return _buffer;
+        }
+
+        constexpr VkDeviceSize offset() const
+        {
+            return _offset;
+        }
+
+        constexpr VkDeviceSize size() const
+        {
+            return _size;
+        }
+
+        constexpr uint8_t* mapped() const
+        {
+            return _mapped;
+        }
+
+        // call after writing to the allocation on the CPU
+        void flush();
+
+        // call before reading from the allocation on the CPU, after the GPU
+        // has written to it
+        void invalidate();
+
+        // the submission that uses the allocation, see the class comment
+        void set_ticket(const SubmitTicket& ticket);
+
+    private:
+        // nullptr for dedicated allocations
+        StagingRing* ring = nullptr;
+        uint64_t id = 0;
+
+        // the memory is bound to the whole buffer so offsets are the same
+        bv::BufferPtr _buffer = nullptr;
+        bv::DeviceMemoryPtr memory = nullptr;
+        VkDeviceSize _offset = 0;
+        VkDeviceSize _size = 0;
+        VkDeviceSize aligned_size = 0; // for flushing and invalidating
+        uint8_t* _mapped = nullptr;
+        SubmitTicket ticket;
+
+        StagingAllocation() = default;
+
+        void release();
+
+        friend class StagingRing;
+
+    };
+
+    // a persistent host-visible buffer that staging memory for uploads or
+    // readbacks is carved out of in a ring, so we don't create and destroy a
+    // buffer every time. uploads use write-combined (uncached) memory while
+    // readbacks use cached memory if the GPU has it because the CPU reads
+    // from uncached memory very slowly.
+    class StagingRing
+    {
+    public:
+        StagingRing(AppState& state, VkDeviceSize capacity, bool readback);
+
+        StagingRing(const StagingRing&) = delete;
+        StagingRing& operator=(const StagingRing&) = delete;
+
+        constexpr VkDeviceSize capacity() const
+        {
+            return _capacity;
+        }
+
+        constexpr bool is_readback() const
+        {
+            return readback;
+        }
+
+        // if there's no room for size bytes even after reclaiming the space
+        // released by previous allocations, the allocation gets its own
+        // buffer instead.
+        StagingAllocation allocate(VkDeviceSize size);
+
+    private:
+        struct Entry
+        {
+            uint64_t id;
+            VkDeviceSize offset;
+            VkDeviceSize size;
+            bool released;
+            SubmitTicket ticket;
+        };
+
+        AppState& state;
+        VkDeviceSize _capacity;
+        bool readback;
+
+        // offsets and sizes are multiples of this so they're fine for texel
+        // copies and for flushing and invalidating non-coherent memory
+        VkDeviceSize alignment = 256;
+
+        bv::BufferPtr buf = nullptr;
+        bv::DeviceMemoryPtr buf_mem = nullptr;
+        uint8_t* buf_mapped = nullptr;
+
+        std::mutex mutex;
+
+        // live allocations from oldest to newest. the oldest one's offset is
+        // the tail of the ring.
+        std::deque<Entry> entries;
+        VkDeviceSize head = 0;
+        uint64_t next_id = 1;
+
+        VkBufferUsageFlags buffer_usage() const;
+
+        std::optional<VkDeviceSize> find_space(VkDeviceSize size) const;
+
+        // allocates dedicated memory of the preferred type for uploads or
+        // readbacks and maps it
+        void create_mapped_buffer(
+            VkDeviceSize size,
+            bv::BufferPtr& out_buffer,
+            bv::DeviceMemoryPtr& out_memory,
+            uint8_t*& out_mapped
+        );
+
+        void release(uint64_t id, const SubmitTicket& ticket);
+
+        friend class StagingAllocation;
+
+    };
+
+}
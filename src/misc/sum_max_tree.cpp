@@ -0,0 +1,58 @@
+#include "sum_max_tree.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace img_aligner
+{
+
+    SumMaxTree::SumMaxTree(size_t n_leaves)
+        : n_leaves(n_leaves)
+    {
+        n_leaves_pow2 = 1;
+        while (n_leaves_pow2 < n_leaves)
+        {
+            n_leaves_pow2 <<= 1;
+        }
+
+        sums.resize(2 * n_leaves_pow2, 0.);
+        maxs.resize(2 * n_leaves_pow2, 0.f);
+    }
+
+    void SumMaxTree::build(const float* values)
+    {
+        for (size_t i = 0; i < n_leaves; i++)
+        {
+            sums[n_leaves_pow2 + i] = (double)values[i];
+            maxs[n_leaves_pow2 + i] = values[i];
+        }
+        for (size_t node = n_leaves_pow2 - 1; node >= 1; node--)
+        {
+            update_node(node);
+        }
+    }
+
+    void SumMaxTree::set(size_t idx, float value)
+    {
+        if (idx >= n_leaves)
+        {
+            throw std::out_of_range("segment tree index out of range");
+        }
+
+        size_t node = n_leaves_pow2 + idx;
+        sums[node] = (double)value;
+        maxs[node] = value;
+
+        for (node /= 2; node >= 1; node /= 2)
+        {
+            update_node(node);
+        }
+    }
+
+    void SumMaxTree::update_node(size_t node)
+    {
+        sums[node] = sums[2 * node] + sums[2 * node + 1];
+        maxs[node] = std::max(maxs[2 * node], maxs[2 * node + 1]);
+    }
+
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+namespace img_aligner
+{
+
+    // segment tree that keeps the sum and the maximum of an array of
+    // non-negative values. changing a value takes O(log n) and reading the
+    // sum or the maximum of the whole array takes O(1). sums are kept in
+    // double precision so they don't drift after many updates.
+    class SumMaxTree
+    {
+    public:
+        SumMaxTree() = default;
+        SumMaxTree(size_t n_leaves);
+
+        constexpr size_t size() const
+        {
+            return n_leaves;
+        }
+
+        // replace all values and rebuild the tree in O(n)
+        void build(const float* values);
+
+        void set(size_t idx, float value);
+
+        constexpr double sum() const
+        {
+            return sums.empty() ? 0. : sums[1];
+        }
+
+        constexpr float max() const
+        {
+            return maxs.empty() ? 0.f : maxs[1];
+        }
+
+    private:
+        size_t n_leaves = 0;
+
+        // number of leaves rounded up to a power of 2. node i has children
+        // 2i and 2i + 1, the root is node 1 and the leaves start at node
+        // n_leaves_pow2. unused leaves are 0.
+        size_t n_leaves_pow2 = 0;
+
+        std::vector<double> sums;
+        std::vector<float> maxs;
+
+        void update_node(size_t node);
+
+    };
+
+}
@@ -0,0 +1,283 @@
+#include "tiled_image.hpp"
+
+#include "app_state.hpp"
+#include "vk_utils.hpp"
+
+namespace img_aligner
+{
+
+    TiledImage::TiledImage(
+        uint32_t width,
+        uint32_t height,
+        VkFormat format,
+        uint32_t tile_size,
+        VkDeviceSize gpu_budget
+    )
+        : _width(width),
+        _height(height),
+        _format(format),
+        _tile_size(tile_size),
+        gpu_budget(gpu_budget)
+    {
+        if (width < 1 || height < 1)
+        {
+            throw std::invalid_argument(
+                "tiled image size must be at least 1 in each dimension"
+            );
+        }
+        if (tile_size < 1)
+        {
+            throw std::invalid_argument("tile size must be at least 1");
+        }
+
+        switch (format)
+        {
+        case VK_FORMAT_R32G32B32A32_SFLOAT:
+            pixel_size_bytes = 4 * sizeof(float);
+            break;
+        case VK_FORMAT_R16G16B16A16_SFLOAT:
+            pixel_size_bytes = 4 * sizeof(uint16_t);
+            break;
+        default:
+            throw std::invalid_argument(fmt::format(
+                "unsupported tiled image format: {}",
+                VkFormat_to_str(format)
+            ).c_str());
+        }
+
+        _n_tiles_x = (width + tile_size - 1) / tile_size;
+        _n_tiles_y = (height + tile_size - 1) / tile_size;
+        _tiles.reserve((size_t)_n_tiles_x * _n_tiles_y);
+        for (uint32_t ty = 0; ty < _n_tiles_y; ty++)
+        {
+            for (uint32_t tx = 0; tx < _n_tiles_x; tx++)
+            {
+                Tile tile{
+                    .x = tx * tile_size,
+                    .y = ty * tile_size,
+                    .width = std::min(tile_size, width - tx * tile_size),
+                    .height = std::min(tile_size, height - ty * tile_size)
+                };
+
+                tile.tex_x = tile.x > 0 ? tile.x - 1 : 0;
+                tile.tex_y = tile.y > 0 ? tile.y - 1 : 0;
+                tile.tex_width =
+                    std::min(tile.x + tile.width + 1, width) - tile.tex_x;
+                tile.tex_height =
+                    std::min(tile.y + tile.height + 1, height) - tile.tex_y;
+
+                _tiles.push_back(tile);
+            }
+        }
+
+        tile_offsets.reserve(_tiles.size());
+        uint64_t offset = 0;
+        for (const auto& tile : _tiles)
+        {
+            tile_offsets.push_back(offset);
+            offset += texture_size_bytes(tile);
+        }
+
+        textures.resize(_tiles.size());
+        last_used.resize(_tiles.size(), 0);
+
+        // random file name so multiple images and instances don't collide
+        std::random_device rd;
+        store_path = std::filesystem::temp_directory_path() / fmt::format(
+            "img-aligner-{:08x}{:08x}.tiles",
+            rd(),
+            rd()
+        );
+        store_file.open(
+            store_path,
+            std::ios::in | std::ios::out | std::ios::binary | std::ios::trunc
+        );
+        if (!store_file.is_open())
+        {
+            throw std::runtime_error(fmt::format(
+                "failed to create temporary file \"{}\" for a tiled image",
+                store_path.string()
+            ).c_str());
+        }
+    }
+
+    TiledImage::~TiledImage()
+    {
+        store_file.close();
+
+        // ignore errors, there's nothing to do about them here
+        std::error_code ec;
+        std::filesystem::remove(store_path, ec);
+    }
+
+    void TiledImage::store(
+        const std::function<void(
+            uint32_t first_row,
+            uint32_t n_rows,
+            uint8_t* dst
+            )>& fill_rows
+    )
+    {
+        size_t row_size_bytes = (size_t)_width * pixel_size_bytes;
+        uint32_t max_band_rows = (uint32_t)std::clamp<size_t>(
+            TILED_IMAGE_STORE_BAND_SIZE / row_size_bytes,
+            1,
+            (size_t)_tile_size + 2
+        );
+        std::vector<uint8_t> band((size_t)max_band_rows * row_size_bytes);
+
+        // every row of tiles needs its texture rows, which overlap the rows
+        // of the neighbouring tiles by one row
+        for (uint32_t ty = 0; ty < _n_tiles_y; ty++)
+        {
+            const Tile& first_tile = _tiles[(size_t)ty * _n_tiles_x];
+            for (uint32_t band_y = 0;
+                band_y < first_tile.tex_height;
+                band_y += max_band_rows)
+            {
+                uint32_t n_rows =
+                    std::min(max_band_rows, first_tile.tex_height - band_y);
+                fill_rows(first_tile.tex_y + band_y, n_rows, band.data());
+
+                for (uint32_t tx = 0; tx < _n_tiles_x; tx++)
+                {
+                    size_t tile_idx = (size_t)ty * _n_tiles_x + tx;
+                    const Tile& tile = _tiles[tile_idx];
+                    size_t tex_row_size_bytes =
+                        (size_t)tile.tex_width * pixel_size_bytes;
+
+                    store_file.seekp((std::streamoff)(
+                        tile_offsets[tile_idx]
+                        + ((uint64_t)band_y * tex_row_size_bytes)
+                    ));
+                    for (uint32_t y = 0; y < n_rows; y++)
+                    {
+                        store_file.write(
+                            (const char*)band.data()
+                            + ((size_t)y * row_size_bytes)
+                            + ((size_t)tile.tex_x * pixel_size_bytes),
+                            (std::streamsize)tex_row_size_bytes
+                        );
+                    }
+                }
+            }
+        }
+
+        store_file.flush();
+        if (!store_file)
+        {
+            throw std::runtime_error(fmt::format(
+                "failed to write temporary file \"{}\" for a tiled image",
+                store_path.string()
+            ).c_str());
+        }
+    }
+
+    TiledImage::TexturePtr TiledImage::upload_tile(
+        AppState& state,
+        const bv::QueuePtr& queue,
+        size_t tile_idx
+    )
+    {
+        if (tile_idx >= _tiles.size())
+        {
+            throw std::invalid_argument(fmt::format(
+                "tile index {} is out of range, the image has {} tiles",
+                tile_idx,
+                _tiles.size()
+            ).c_str());
+        }
+
+        last_used[tile_idx] = ++use_counter;
+        if (textures[tile_idx])
+        {
+            return textures[tile_idx];
+        }
+
+        const Tile& tile = _tiles[tile_idx];
+        VkDeviceSize size_bytes = texture_size_bytes(tile);
+
+        // make room for the new texture. the textures that are still in use
+        // stay alive through the pointers their users are holding.
+        while (resident_size_bytes > 0
+            && resident_size_bytes + size_bytes > gpu_budget)
+        {
+            size_t lru_idx = tile_idx;
+            for (size_t i = 0; i < textures.size(); i++)
+            {
+                if (textures[i] && (lru_idx == tile_idx
+                    || last_used[i] < last_used[lru_idx]))
+                {
+                    lru_idx = i;
+                }
+            }
+            if (lru_idx == tile_idx)
+            {
+                break;
+            }
+
+            textures[lru_idx] = nullptr;
+            resident_size_bytes -= texture_size_bytes(_tiles[lru_idx]);
+        }
+
+        // read the rows of the texture from the temporary file straight into
+        // staging memory
+        auto texture = std::make_shared<Texture>();
+        uint64_t tile_offset = tile_offsets[tile_idx];
+        size_t tex_row_size_bytes = (size_t)tile.tex_width * pixel_size_bytes;
+        create_texture(
+            state,
+            queue,
+            tile.tex_width,
+            tile.tex_height,
+            _format,
+            tex_row_size_bytes,
+            [this, tile_offset, tex_row_size_bytes](
+                uint32_t first_row,
+                uint32_t n_rows,
+                uint8_t* dst
+                )
+            {
+                store_file.seekg((std::streamoff)(
+                    tile_offset + ((uint64_t)first_row * tex_row_size_bytes)
+                ));
+                store_file.read(
+                    (char*)dst,
+                    (std::streamsize)((size_t)n_rows * tex_row_size_bytes)
+                );
+                if (!store_file)
+                {
+                    throw std::runtime_error(fmt::format(
+                        "failed to read temporary file \"{}\" for a tiled "
+                        "image",
+                        store_path.string()
+                    ).c_str());
+                }
+            },
+            false,
+            texture->img,
+            texture->img_mem,
+            texture->imgview
+        );
+
+        textures[tile_idx] = texture;
+        resident_size_bytes += size_bytes;
+        return texture;
+    }
+
+    void TiledImage::release_textures()
+    {
+        for (auto& texture : textures)
+        {
+            texture = nullptr;
+        }
+        resident_size_bytes = 0;
+    }
+
+    VkDeviceSize TiledImage::texture_size_bytes(const Tile& tile) const
+    {
+        return (VkDeviceSize)tile.tex_width * tile.tex_height
+            * pixel_size_bytes;
+    }
+
+}
@@ -0,0 +1,156 @@
+#pragma once
+
+#include "common.hpp"
+
+namespace img_aligner
+{
+
+    struct AppState;
+
+    // GPU memory a TiledImage can keep uploaded tiles in before it starts
+    // releasing the least recently used ones
+    static constexpr VkDeviceSize TILED_IMAGE_GPU_BUDGET = 512 * 1024 * 1024;
+
+    // host memory a TiledImage uses for the rows it's storing at once
+    static constexpr size_t TILED_IMAGE_STORE_BAND_SIZE = 64 * 1024 * 1024;
+
+    // an image whose tiles are kept in a temporary file and are uploaded to
+    // the GPU one at a time when they're needed, so it doesn't have to fit in
+    // host memory, GPU memory, or within the GPU's image size limits. rows go
+    // bottom row first like in the textures from load_image().
+    class TiledImage
+    {
+    public:
+        struct Tile
+        {
+            // the pixels this tile is responsible for
+            uint32_t x = 0;
+            uint32_t y = 0;
+            uint32_t width = 0;
+            uint32_t height = 0;
+
+            // the pixels in its texture, which has an extra pixel on every
+            // side where the image has one so linear filtering near the edges
+            // of the tile gives the same results as the whole image.
+            uint32_t tex_x = 0;
+            uint32_t tex_y = 0;
+            uint32_t tex_width = 0;
+            uint32_t tex_height = 0;
+        };
+
+        // in VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, without mipmaps
+        struct Texture
+        {
+            bv::ImagePtr img = nullptr;
+            bv::MemoryChunkPtr img_mem = nullptr;
+            bv::ImageViewPtr imgview = nullptr;
+        };
+        using TexturePtr = std::shared_ptr<const Texture>;
+
+        // format must be R32G32B32A32_SFLOAT or R16G16B16A16_SFLOAT
+        TiledImage(
+            uint32_t width,
+            uint32_t height,
+            VkFormat format,
+            uint32_t tile_size,
+            VkDeviceSize gpu_budget = TILED_IMAGE_GPU_BUDGET
+        );
+
+        TiledImage(const TiledImage&) = delete;
+        TiledImage& operator=(const TiledImage&) = delete;
+
+        // deletes the temporary file
+        ~TiledImage();
+
+        constexpr uint32_t width() const
+        {
+            return _width;
+        }
+
+        constexpr uint32_t height() const
+        {
+            return _height;
+        }
+
+        constexpr VkFormat format() const
+        {
+            return _format;
+        }
+
+        constexpr uint32_t tile_size() const
+        {
+            return _tile_size;
+        }
+
+        constexpr uint32_t n_tiles_x() const
+        {
+            return _n_tiles_x;
+        }
+
+        constexpr uint32_t n_tiles_y() const
+        {
+            return _n_tiles_y;
+        }
+
+        // tiles go left to right and then bottom to top
+        constexpr const std::vector<Tile>& tiles() const
+        {
+            return _tiles;
+        }
+
+        // write the pixels of every tile to the temporary file. fill_rows
+        // writes n_rows rows starting at first_row (bottom row first) to dst
+        // in the image's format. it's called with bands of at most
+        // TILED_IMAGE_STORE_BAND_SIZE bytes (or a single row), in order except
+        // for the two rows that neighbouring tiles share.
+        void store(
+            const std::function<void(
+                uint32_t first_row,
+                uint32_t n_rows,
+                uint8_t* dst
+                )>& fill_rows
+        );
+
+        // the texture for a tile, uploaded unless it's still on the GPU from
+        // an earlier call. the least recently used textures are released to
+        // stay within the GPU budget, but the returned pointer keeps its
+        // texture alive for as long as the caller needs it.
+        TexturePtr upload_tile(
+            AppState& state,
+            const bv::QueuePtr& queue,
+            size_t tile_idx
+        );
+
+        // release the textures of all tiles
+        void release_textures();
+
+    private:
+        uint32_t _width;
+        uint32_t _height;
+        VkFormat _format;
+        size_t pixel_size_bytes;
+        uint32_t _tile_size;
+        VkDeviceSize gpu_budget;
+
+        uint32_t _n_tiles_x;
+        uint32_t _n_tiles_y;
+        std::vector<Tile> _tiles;
+
+        // the texture pixels of every tile one after another, starting at
+        // tile_offsets[tile_idx]
+        std::filesystem::path store_path;
+        std::fstream store_file;
+        std::vector<uint64_t> tile_offsets;
+
+        // uploaded textures (nullptr if not uploaded) and when they were last
+        // used, for every tile
+        std::vector<TexturePtr> textures;
+        std::vector<uint64_t> last_used;
+        uint64_t use_counter = 0;
+        VkDeviceSize resident_size_bytes = 0;
+
+        VkDeviceSize texture_size_bytes(const Tile& tile) const;
+
+    };
+
+}
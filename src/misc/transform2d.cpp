@@ -10,14 +10,20 @@ namespace img_aligner
             && offset == glm::vec2(0);
     }
 
-    glm::vec2 Transform2d::apply(const glm::vec2& p) const
+    glm::mat2 Transform2d::linear_part() const
     {
         float angle_rad = glm::radians(rotation);
         float c = std::cos(angle_rad);
         float s = std::sin(angle_rad);
 
+        // scale, then rotate
+        return glm::mat2(c, -s, s, c) * glm::mat2(scale.x, 0, 0, scale.y);
+    }
+
+    glm::vec2 Transform2d::apply(const glm::vec2& p) const
+    {
         // scale, rotate, offset
-        return glm::mat2(c, -s, s, c) * (p * scale) + offset;
+        return linear_part() * p + offset;
     }
 
 }
@@ -12,6 +12,7 @@ namespace img_aligner
         glm::vec2 offset{ 0.f };
 
         bool is_identity() const;
+        glm::mat2 linear_part() const; // scale and rotation
         glm::vec2 apply(const glm::vec2& p) const;
     };
 
@@ -3,33 +3,29 @@
 namespace img_aligner
 {
 
-    bv::CommandBufferPtr begin_single_time_commands(
-        AppState& state,
-        bool use_transient_pool
-    )
+    bv::CommandBufferPtr begin_single_time_commands(AppState& state)
     {
-        auto cmd_buf = bv::CommandPool::allocate_buffer(
-            state.cmd_pool(use_transient_pool),
-            VK_COMMAND_BUFFER_LEVEL_PRIMARY
-        );
-        cmd_buf->begin(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
-        return cmd_buf;
+        return state.single_time_cmd_pool().acquire();
     }
 
     void end_single_time_commands(
+        AppState& state,
         bv::CommandBufferPtr& cmd_buf,
-        const bv::QueuePtr& queue,
-        const bv::FencePtr& fence
+        const bv::QueuePtr& queue
     )
     {
-        cmd_buf->end();
+        submit_single_time_commands(state, cmd_buf, queue).wait();
+    }
 
-        queue->submit({}, {}, { cmd_buf }, {}, fence);
-        if (fence == nullptr)
-        {
-            queue->wait_idle();
-            cmd_buf = nullptr;
-        }
+    SubmitTicket submit_single_time_commands(
+        AppState& state,
+        bv::CommandBufferPtr& cmd_buf,
+        const bv::QueuePtr& queue
+    )
+    {
+        auto ticket = state.single_time_cmd_pool().submit(cmd_buf, queue);
+        cmd_buf = nullptr;
+        return ticket;
     }
 
     uint32_t find_memory_type_idx(
@@ -81,7 +77,8 @@ namespace img_aligner
         VkImageUsageFlags usage,
         VkMemoryPropertyFlags memory_properties,
         bv::ImagePtr& out_image,
-        bv::MemoryChunkPtr& out_memory_chunk
+        bv::MemoryChunkPtr& out_memory_chunk,
+        uint32_t array_layers
     )
     {
         bv::Extent3d extent{
@@ -97,7 +94,7 @@ namespace img_aligner
                 .format = format,
                 .extent = extent,
                 .mip_levels = mip_levels,
-                .array_layers = 1,
+                .array_layers = array_layers,
                 .samples = num_samples,
                 .tiling = tiling,
                 .usage = usage,
@@ -195,7 +192,7 @@ namespace img_aligner
                 .baseMipLevel = 0,
                 .levelCount = mip_levels,
                 .baseArrayLayer = 0,
-                .layerCount = 1
+                .layerCount = image->config().array_layers
         }
         };
 
@@ -210,13 +207,123 @@ namespace img_aligner
         );
     }
 
+    void image_memory_barrier(
+        const bv::CommandBufferPtr& cmd_buf,
+        const bv::ImagePtr& image,
+        VkImageLayout layout,
+        VkPipelineStageFlags src_stage_mask,
+        VkAccessFlags src_access_mask,
+        VkPipelineStageFlags dst_stage_mask,
+        VkAccessFlags dst_access_mask
+    )
+    {
+        VkImageMemoryBarrier barrier{
+            .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+            .pNext = nullptr,
+            .srcAccessMask = src_access_mask,
+            .dstAccessMask = dst_access_mask,
+            .oldLayout = layout,
+            .newLayout = layout,
+            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .image = image->handle(),
+            .subresourceRange = VkImageSubresourceRange{
+                .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                .baseMipLevel = 0,
+                .levelCount = image->config().mip_levels,
+                .baseArrayLayer = 0,
+                .layerCount = image->config().array_layers
+        }
+        };
+
+        vkCmdPipelineBarrier(
+            cmd_buf->handle(),
+            src_stage_mask,
+            dst_stage_mask,
+            0,
+            0, nullptr,
+            0, nullptr,
+            1, &barrier
+        );
+    }
+
+    void memory_barrier(
+        const bv::CommandBufferPtr& cmd_buf,
+        VkPipelineStageFlags src_stage_mask,
+        VkAccessFlags src_access_mask,
+        VkPipelineStageFlags dst_stage_mask,
+        VkAccessFlags dst_access_mask
+    )
+    {
+        VkMemoryBarrier barrier{
+            .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+            .pNext = nullptr,
+            .srcAccessMask = src_access_mask,
+            .dstAccessMask = dst_access_mask
+        };
+
+        vkCmdPipelineBarrier(
+            cmd_buf->handle(),
+            src_stage_mask,
+            dst_stage_mask,
+            0,
+            1, &barrier,
+            0, nullptr,
+            0, nullptr
+        );
+    }
+
+    void buffer_memory_barrier(
+        const bv::CommandBufferPtr& cmd_buf,
+        const bv::BufferPtr& buffer,
+        VkPipelineStageFlags src_stage_mask,
+        VkAccessFlags src_access_mask,
+        VkPipelineStageFlags dst_stage_mask,
+        VkAccessFlags dst_access_mask
+    )
+    {
+        VkBufferMemoryBarrier barrier{
+            .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+            .pNext = nullptr,
+            .srcAccessMask = src_access_mask,
+            .dstAccessMask = dst_access_mask,
+            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .buffer = buffer->handle(),
+            .offset = 0,
+            .size = VK_WHOLE_SIZE
+        };
+
+        vkCmdPipelineBarrier(
+            cmd_buf->handle(),
+            src_stage_mask,
+            dst_stage_mask,
+            0,
+            0, nullptr,
+            1, &barrier,
+            0, nullptr
+        );
+    }
+
     void copy_buffer_to_image(
         const bv::CommandBufferPtr& cmd_buf,
         const bv::BufferPtr& buffer,
         const bv::ImagePtr& image,
-        VkDeviceSize buffer_offset
+        VkDeviceSize buffer_offset,
+        uint32_t first_row,
+        uint32_t n_rows
     )
     {
+        VkExtent3D extent = bv::Extent3d_to_vk(image->config().extent);
+        if (n_rows > 0)
+        {
+            extent.height = n_rows;
+        }
+        else
+        {
+            first_row = 0;
+        }
+
         VkBufferImageCopy region{
             .bufferOffset = buffer_offset,
             .bufferRowLength = 0,
@@ -227,8 +334,8 @@ namespace img_aligner
                 .baseArrayLayer = 0,
                 .layerCount = 1
         },
-            .imageOffset = { 0, 0, 0 },
-            .imageExtent = bv::Extent3d_to_vk(image->config().extent)
+            .imageOffset = { 0, (int32_t)first_row, 0 },
+            .imageExtent = extent
         };
 
         vkCmdCopyBufferToImage(
@@ -256,7 +363,7 @@ namespace img_aligner
                 .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
                 .mipLevel = 0,
                 .baseArrayLayer = 0,
-                .layerCount = 1
+                .layerCount = image->config().array_layers
             },
             .imageOffset = { 0, 0, 0 },
             .imageExtent = bv::Extent3d_to_vk(image->config().extent)
@@ -296,6 +403,16 @@ namespace img_aligner
             n_bytes_per_channel = sizeof(float);
             break;
 
+        case VK_FORMAT_R16G16B16A16_SFLOAT:
+            n_channels = 4;
+            n_bytes_per_channel = sizeof(uint16_t);
+            break;
+
+        case VK_FORMAT_R16_SFLOAT:
+            n_channels = 1;
+            n_bytes_per_channel = sizeof(uint16_t);
+            break;
+
         default:
             throw std::invalid_argument(fmt::format(
                 "image format ({}) not supported for read back",
@@ -307,32 +424,39 @@ namespace img_aligner
         VkDeviceSize size_bytes =
             width * height * n_channels * n_bytes_per_channel;
 
-        // buffer to copy to
-        bv::BufferPtr buf = nullptr;
-        bv::MemoryChunkPtr buf_mem = nullptr;
-        create_buffer(
-            state,
-            size_bytes,
-            VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        // copy to staging memory (cached if possible, so the CPU can read it
+        // quickly below)
+        StagingAllocation staging =
+            state.staging_ring(queue, true).allocate(size_bytes);
 
-            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT
-            | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-
-            buf,
-            buf_mem
+        auto cmd_buf = begin_single_time_commands(state);
+        copy_image_to_buffer(
+            cmd_buf,
+            image,
+            staging.buffer(),
+            staging.offset()
         );
-        float* buf_mapped = (float*)buf_mem->mapped();
-
-        // copy to buffer
-        auto fence = bv::Fence::create(state.device, 0);
-        auto cmd_buf = begin_single_time_commands(state, true);
-        copy_image_to_buffer(cmd_buf, image, buf);
-        end_single_time_commands(cmd_buf, queue, fence);
-        fence->wait();
+        end_single_time_commands(state, cmd_buf, queue);
+        staging.invalidate();
+
+        // widen half floats to 32-bit first so the code below only deals with
+        // 32-bit floats
+        const float* buf_mapped = (float*)staging.mapped();
+        std::vector<float> widened;
+        if (n_bytes_per_channel == sizeof(uint16_t))
+        {
+            const uint16_t* halves = (uint16_t*)staging.mapped();
+            widened.resize(width * height * n_channels);
+            for (size_t i = 0; i < widened.size(); i++)
+            {
+                widened[i] = glm::unpackHalf1x16(halves[i]);
+            }
+            buf_mapped = widened.data();
+        }
 
         // convert to RGBA F32 and flip if needed, then store in a vector
         std::vector<float> pixels_rgbaf32(width * height * 4);
-        if (image->config().format == VK_FORMAT_R32G32B32A32_SFLOAT)
+        if (n_channels == 4)
         {
             if (vflip)
             {
@@ -359,7 +483,7 @@ namespace img_aligner
                 );
             }
         }
-        else if (image->config().format == VK_FORMAT_R32_SFLOAT)
+        else if (n_channels == 1)
         {
             if (vflip)
             {
@@ -557,14 +681,15 @@ namespace img_aligner
         const bv::ImagePtr& image,
         VkFormat format,
         VkImageAspectFlags aspect_flags,
-        uint32_t mip_levels
+        uint32_t mip_levels,
+        uint32_t base_array_layer
     )
     {
         bv::ImageSubresourceRange subresource_range{
             .aspect_mask = aspect_flags,
             .base_mip_level = 0,
             .level_count = mip_levels,
-            .base_array_layer = 0,
+            .base_array_layer = base_array_layer,
             .layer_count = 1
         };
 
@@ -612,11 +737,12 @@ namespace img_aligner
         const bv::CommandBufferPtr& cmd_buf,
         bv::BufferPtr src,
         bv::BufferPtr dst,
-        VkDeviceSize size
+        VkDeviceSize size,
+        VkDeviceSize src_offset
     )
     {
         VkBufferCopy copy_region{
-            .srcOffset = 0,
+            .srcOffset = src_offset,
             .dstOffset = 0,
             .size = size
         };
@@ -643,39 +769,76 @@ namespace img_aligner
         bv::ImageViewPtr& out_imgview
     )
     {
-        if (width < 1 || height < 1)
+        if (height < 1)
         {
             throw std::invalid_argument(
                 "texture size must be at least 1 in each dimension"
             );
         }
-        if (size_bytes < 1)
+        if (size_bytes % height != 0)
         {
             throw std::invalid_argument(
-                "texture pixel data size must be at least 1 byte"
+                "texture pixel data size must be a multiple of the height"
             );
         }
 
-        // create staging buffer and upload pixel data to it
-        bv::BufferPtr staging_buf;
-        bv::MemoryChunkPtr staging_buf_mem;
-        create_buffer(
+        size_t row_size_bytes = size_bytes / height;
+        create_texture(
             state,
-            size_bytes,
-            VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-
-            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT
-            | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-
-            staging_buf,
-            staging_buf_mem
-        );
-        std::copy(
-            (uint8_t*)pixels,
-            (uint8_t*)pixels + size_bytes,
-            (uint8_t*)staging_buf_mem->mapped()
+            queue,
+            width,
+            height,
+            format,
+            row_size_bytes,
+            [pixels, row_size_bytes](
+                uint32_t first_row,
+                uint32_t n_rows,
+                uint8_t* dst
+                )
+            {
+                std::copy(
+                    (uint8_t*)pixels + (first_row * row_size_bytes),
+                    (uint8_t*)pixels + ((first_row + n_rows) * row_size_bytes),
+                    dst
+                );
+            },
+            mipmapped,
+            out_img,
+            out_img_mem,
+            out_imgview
         );
-        staging_buf_mem->flush();
+    }
+
+    void create_texture(
+        AppState& state,
+        const bv::QueuePtr& queue,
+        uint32_t width,
+        uint32_t height,
+        VkFormat format,
+        size_t row_size_bytes,
+        const std::function<void(
+            uint32_t first_row,
+            uint32_t n_rows,
+            uint8_t* dst
+            )>& fill_rows,
+        bool mipmapped,
+        bv::ImagePtr& out_img,
+        bv::MemoryChunkPtr& out_img_mem,
+        bv::ImageViewPtr& out_imgview
+    )
+    {
+        if (width < 1 || height < 1)
+        {
+            throw std::invalid_argument(
+                "texture size must be at least 1 in each dimension"
+            );
+        }
+        if (row_size_bytes < 1)
+        {
+            throw std::invalid_argument(
+                "texture row size must be at least 1 byte"
+            );
+        }
 
         // base and target images use the original resolution with mipmapping
 
@@ -709,8 +872,17 @@ namespace img_aligner
             mip_levels
         );
 
-        auto cmd_buf = begin_single_time_commands(state, true);
+        // upload the pixels in bands of rows through the staging ring. every
+        // band is submitted on its own without waiting so the ring can reuse
+        // its space while we fill the next bands.
+        uint32_t rows_per_band = (uint32_t)std::clamp(
+            TEXTURE_UPLOAD_BAND_SIZE / row_size_bytes,
+            (size_t)1,
+            (size_t)height
+        );
+        StagingRing& staging_ring = state.staging_ring(queue, false);
 
+        auto cmd_buf = begin_single_time_commands(state);
         transition_image_layout(
             cmd_buf,
             out_img,
@@ -719,13 +891,37 @@ namespace img_aligner
             mip_levels
         );
 
-        copy_buffer_to_image(
-            cmd_buf,
-            staging_buf,
-            out_img,
-            0
-        );
+        for (uint32_t first_row = 0; first_row < height;
+            first_row += rows_per_band)
+        {
+            uint32_t n_rows = std::min(rows_per_band, height - first_row);
+
+            if (first_row > 0)
+            {
+                cmd_buf = begin_single_time_commands(state);
+            }
 
+            StagingAllocation staging =
+                staging_ring.allocate(n_rows * row_size_bytes);
+            fill_rows(first_row, n_rows, staging.mapped());
+            staging.flush();
+
+            copy_buffer_to_image(
+                cmd_buf,
+                staging.buffer(),
+                out_img,
+                staging.offset(),
+                first_row,
+                n_rows
+            );
+
+            staging.set_ticket(
+                submit_single_time_commands(state, cmd_buf, queue)
+            );
+        }
+
+        // this waits for the bands above too
+        cmd_buf = begin_single_time_commands(state);
         if (mipmapped)
         {
             // generate mipmaps which will also transitions the image to
@@ -750,10 +946,7 @@ namespace img_aligner
             );
         }
 
-        end_single_time_commands(cmd_buf, queue);
-
-        staging_buf = nullptr;
-        staging_buf_mem = nullptr;
+        end_single_time_commands(state, cmd_buf, queue);
     }
 
     const char* VkPhysicalDeviceType_to_str(VkPhysicalDeviceType v)
@@ -7,22 +7,25 @@
 namespace img_aligner
 {
 
-    // if use_transfer_pool is true, the command buffer will be allocated
-    // from transfer_cmd_pool instead of cmd_pool. transfer_cmd_pool has the
-    // VK_COMMAND_POOL_CREATE_TRANSIENT_BIT flag enabled which might be of
-    // interest.
-    bv::CommandBufferPtr begin_single_time_commands(
+    // the command buffer comes from this thread's SingleTimeCmdPool in
+    // AppState and is reused once its submission is done.
+    bv::CommandBufferPtr begin_single_time_commands(AppState& state);
+
+    // end and submit one-time command buffer and wait for it (and everything
+    // submitted to the queue before it) to finish. cmd_buf will be nullptr.
+    void end_single_time_commands(
         AppState& state,
-        bool use_transient_pool
+        bv::CommandBufferPtr& cmd_buf,
+        const bv::QueuePtr& queue
     );
 
-    // end and submit one-time command buffer. if no fence is provided,
-    // Queue::wait_idle() will be used. if a fence is provided you'll be in
-    // charge of synchronization (like waiting on the fence).
-    void end_single_time_commands(
+    // end and submit one-time command buffer without waiting. you'll be in
+    // charge of synchronization through the returned ticket. cmd_buf will be
+    // nullptr.
+    SubmitTicket submit_single_time_commands(
+        AppState& state,
         bv::CommandBufferPtr& cmd_buf,
-        const bv::QueuePtr& queue,
-        const bv::FencePtr& fence = nullptr
+        const bv::QueuePtr& queue
     );
 
     uint32_t find_memory_type_idx(
@@ -44,7 +47,8 @@ namespace img_aligner
         VkImageUsageFlags usage,
         VkMemoryPropertyFlags memory_properties,
         bv::ImagePtr& out_image,
-        bv::MemoryChunkPtr& out_memory_chunk
+        bv::MemoryChunkPtr& out_memory_chunk,
+        uint32_t array_layers = 1
     );
 
     void transition_image_layout(
@@ -55,13 +59,51 @@ namespace img_aligner
         uint32_t mip_levels
     );
 
+    // pipeline barrier for an image that stays in the same layout. this is
+    // mostly useful to make a pass wait for a previous pass that wrote to the
+    // image when they're both recorded in the same command buffer.
+    void image_memory_barrier(
+        const bv::CommandBufferPtr& cmd_buf,
+        const bv::ImagePtr& image,
+        VkImageLayout layout,
+        VkPipelineStageFlags src_stage_mask,
+        VkAccessFlags src_access_mask,
+        VkPipelineStageFlags dst_stage_mask,
+        VkAccessFlags dst_access_mask
+    );
+
+    // global pipeline barrier for all resources
+    void memory_barrier(
+        const bv::CommandBufferPtr& cmd_buf,
+        VkPipelineStageFlags src_stage_mask,
+        VkAccessFlags src_access_mask,
+        VkPipelineStageFlags dst_stage_mask,
+        VkAccessFlags dst_access_mask
+    );
+
+    // pipeline barrier for the whole range of a buffer
+    void buffer_memory_barrier(
+        const bv::CommandBufferPtr& cmd_buf,
+        const bv::BufferPtr& buffer,
+        VkPipelineStageFlags src_stage_mask,
+        VkAccessFlags src_access_mask,
+        VkPipelineStageFlags dst_stage_mask,
+        VkAccessFlags dst_access_mask
+    );
+
+    // if n_rows is 0 the whole image is copied. otherwise only the rows
+    // [first_row, first_row + n_rows) are copied from a buffer that only
+    // contains those rows.
     void copy_buffer_to_image(
         const bv::CommandBufferPtr& cmd_buf,
         const bv::BufferPtr& buffer,
         const bv::ImagePtr& image,
-        VkDeviceSize buffer_offset = 0
+        VkDeviceSize buffer_offset = 0,
+        uint32_t first_row = 0,
+        uint32_t n_rows = 0
     );
 
+    // all array layers are copied, tightly packed one after another
     void copy_image_to_buffer(
         const bv::CommandBufferPtr& cmd_buf,
         const bv::ImagePtr& image,
@@ -96,12 +138,14 @@ namespace img_aligner
         VkAccessFlags next_stage_access_mask
     );
 
+    // the view will only include one array layer (base_array_layer)
     bv::ImageViewPtr create_image_view(
         AppState& state,
         const bv::ImagePtr& image,
         VkFormat format,
         VkImageAspectFlags aspect_flags,
-        uint32_t mip_levels
+        uint32_t mip_levels,
+        uint32_t base_array_layer = 0
     );
 
     void create_buffer(
@@ -117,7 +161,38 @@ namespace img_aligner
         const bv::CommandBufferPtr& cmd_buf,
         bv::BufferPtr src,
         bv::BufferPtr dst,
-        VkDeviceSize size
+        VkDeviceSize size,
+        VkDeviceSize src_offset = 0
+    );
+
+    // a few bands fit in the staging ring at once so the CPU can fill the
+    // next ones while the GPU copies the previous ones
+    static constexpr size_t TEXTURE_UPLOAD_BAND_SIZE = STAGING_RING_SIZE / 4;
+
+    // the pixels are uploaded in bands of rows of at most
+    // TEXTURE_UPLOAD_BAND_SIZE bytes through the upload staging ring of the
+    // queue.
+    // like the other create_texture() but instead of copying from a pixel
+    // buffer, fill_rows is called to write n_rows rows starting at first_row
+    // straight into mapped staging memory. this saves a copy of the whole
+    // image when the pixels come from a decoder. row_size_bytes is the size
+    // of one row in the texture format.
+    void create_texture(
+        AppState& state,
+        const bv::QueuePtr& queue,
+        uint32_t width,
+        uint32_t height,
+        VkFormat format,
+        size_t row_size_bytes,
+        const std::function<void(
+            uint32_t first_row,
+            uint32_t n_rows,
+            uint8_t* dst
+            )>& fill_rows,
+        bool mipmapped,
+        bv::ImagePtr& out_img,
+        bv::MemoryChunkPtr& out_img_mem,
+        bv::ImageViewPtr& out_imgview
     );
 
     void create_texture(
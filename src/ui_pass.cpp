@@ -78,7 +78,7 @@ namespace img_aligner
             VK_IMAGE_ASPECT_COLOR_BIT,
             1
         );
-        auto cmd_buf = begin_single_time_commands(state, true);
+        auto cmd_buf = begin_single_time_commands(state);
         transition_image_layout(
             cmd_buf,
             display_img,
@@ -86,7 +86,7 @@ namespace img_aligner
             VK_IMAGE_LAYOUT_GENERAL,
             1
         );
-        end_single_time_commands(cmd_buf, queue);
+        end_single_time_commands(state, cmd_buf, queue);
 
         // create descriptor set for ImGui::Image()
         imgui_descriptor_set = ImGui_ImplVulkan_AddTexture(
@@ -360,16 +360,12 @@ namespace img_aligner
                 }
             );
         }
-
-        // fence
-        fence = bv::Fence::create(state.device, 0);
     }
 
     UiPass::~UiPass()
     {
         clear_images();
 
-        fence = nullptr;
         graphics_pipeline = nullptr;
         pipeline_layout = nullptr;
         framebuf = nullptr;
@@ -471,11 +467,7 @@ namespace img_aligner
             );
         }
 
-        bv::CommandBufferPtr cmd_buf = bv::CommandPool::allocate_buffer(
-            state.cmd_pool(false),
-            VK_COMMAND_BUFFER_LEVEL_PRIMARY
-        );
-        cmd_buf->begin(0);
+        auto cmd_buf = begin_single_time_commands(state);
 
         VkClearValue clear_val{};
         clear_val.color = { { 0.f, 0.f, 0.f, 0.f } };
@@ -571,11 +563,7 @@ namespace img_aligner
             1, &display_img_memory_barrier
         );
 
-        cmd_buf->end();
-
-        queue->submit({}, {}, { cmd_buf }, {}, fence);
-        fence->wait();
-        fence->reset();
+        end_single_time_commands(state, cmd_buf, queue);
     }
 
     void UiPass::draw_imgui_image(
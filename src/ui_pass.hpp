@@ -148,7 +148,6 @@ namespace img_aligner
         bv::FramebufferPtr framebuf;
         bv::PipelineLayoutPtr pipeline_layout = nullptr;
         bv::GraphicsPipelinePtr graphics_pipeline = nullptr;
-        bv::FencePtr fence = nullptr;
 
         // a list of images we wanna display by rendering to the display image
         std::vector<UiImageInfo> _images;